@@ -18,10 +18,7 @@ void dumpTexture(const tpGxResTexture* tex) {
         return;
     }
 
-    std::vector<std::byte> pixel_data = std::vector<std::byte>(
-        static_cast<std::byte*>(tex->texData),
-        static_cast<std::byte*>(tex->texData) + tex->texDataSize
-    );
+    std::span<const std::byte> pixel_data(static_cast<const std::byte*>(tex->texData), static_cast<size_t>(tex->texDataSize));
 
     auto rawHeader = reinterpret_cast<replicant::raw::RawTexHeader*>(tex->bxonAssetHeader);
 
@@ -46,12 +43,6 @@ void dumpTexture(const tpGxResTexture* tex) {
         return;
 	}
 
-    auto dds_file_result = replicant::dds::DDSFile::CreateFromGameData(*game_tex, pixel_data);
-    if (!dds_file_result) {
-        Logger::Log(Error) << "Failed to create DDS from game texture '" << tex->name << "': " << dds_file_result.error().message;
-        return;
-    }
-
     std::filesystem::path out_path("LunarTear/dump/textures/");
     std::filesystem::path tex_filename(tex->name);
     out_path /= tex_filename.replace_extension(".dds");
@@ -60,7 +51,8 @@ void dumpTexture(const tpGxResTexture* tex) {
         std::filesystem::create_directories(out_path.parent_path());
     }
 
-    auto save_result = dds_file_result->Save(out_path);
+    // Written straight from the game's buffer, no copy is made unless the layout needs repacking
+    auto save_result = replicant::dds::DDSFile::SaveGameData(*game_tex, pixel_data, out_path);
     if (!save_result) {
         Logger::Log(Error) << "Failed to save dumped texture '" << tex->name << "' to '" << out_path.string() << "': " << save_result.error().message;
         return;
@@ -93,6 +93,10 @@ public:
     bool autoBackups;
     int maxBackups;
 
+    bool ConsolidateModArchives;
+
+    bool TraceFileAccess;
+
     static Settings& Instance() {
         static std::unique_ptr<Settings> instance = [] {
             auto s = std::make_unique<Settings>();
@@ -126,6 +130,10 @@ public:
         registerSetting("SaveBackups", true, &Settings::autoBackups, "Automatically make save backups on launch");
         registerSetting("MaxBackups", 100, &Settings::maxBackups, "Eliminate old backups if there are more than this (per steam id)");
 
+        registerSetting("ConsolidateModArchives", false, &Settings::ConsolidateModArchives, "Copies the files of all archive mods into a few archives in the LunarTear folder. Needed for very large mod lists, uses extra disk space");
+
+        registerSetting("TraceFileAccess", false, &Settings::TraceFileAccess, "Records the archives, textures and tables the game loads to LunarTear/trace.bin, for tuning archive layouts with UnsealedVerses");
+
     }
 
     // Returns: 0 = success, 1 = used defaults (corrupt file), 2 = used defaults (created new file)
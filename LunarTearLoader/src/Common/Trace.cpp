@@ -0,0 +1,148 @@
+#include "Trace.h"
+#include "Settings.h"
+#include "Logger.h"
+#include "Game/Globals.h"
+#include "Game/Types.h"
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using enum Logger::LogCategory;
+
+bool Trace::Detail::s_enabled = false;
+
+namespace
+{
+    const char* TracePath = "LunarTear/trace.bin";
+    constexpr auto FlushInterval = std::chrono::milliseconds(250);
+
+    // Game names are short, longer ones are cut
+    constexpr size_t MaxNameLength = 119;
+    constexpr size_t MaxPhaseLength = sizeof(PlayerSaveData::current_phase);
+    constexpr size_t RingCapacity = 4096;  // Records, a power of two
+
+    struct TraceRecord {
+        int64_t ticks;
+        replicant::archive::TraceEvent event;
+        uint8_t nameLength;
+        char phase[MaxPhaseLength];
+        char name[MaxNameLength];
+    };
+
+    // Single producer (the owning thread), single consumer (the flush thread)
+    struct ThreadRing {
+        std::array<TraceRecord, RingCapacity> records;
+        std::atomic<size_t> head = 0;   // Next slot written, only advanced by the producer
+        std::atomic<size_t> tail = 0;   // Next slot read, only advanced by the consumer
+    };
+
+    // Rings outlive their threads, a thread's last records are still flushed after it exits
+    std::mutex s_rings_mutex;
+    std::vector<std::unique_ptr<ThreadRing>> s_rings;
+
+    std::atomic<uint64_t> s_dropped = 0;
+    std::chrono::steady_clock::time_point s_start;
+
+    ThreadRing& ThisThreadRing() {
+        thread_local ThreadRing* ring = [] {
+            auto owned = std::make_unique<ThreadRing>();
+            ThreadRing* raw = owned.get();
+            std::lock_guard lock(s_rings_mutex);
+            s_rings.push_back(std::move(owned));
+            return raw;
+        }();
+        return *ring;
+    }
+
+    void Drain(ThreadRing& ring, replicant::archive::TraceEncoder& encoder, std::vector<std::byte>& out) {
+        size_t tail = ring.tail.load(std::memory_order_relaxed);
+        size_t head = ring.head.load(std::memory_order_acquire);
+
+        for (; tail != head; ++tail) {
+            const TraceRecord& record = ring.records[tail % RingCapacity];
+            auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::duration(record.ticks) - s_start.time_since_epoch());
+
+            encoder.encode(out, record.event, static_cast<uint64_t>(std::max<int64_t>(time.count(), 0)),
+                std::string_view(record.phase, strnlen(record.phase, MaxPhaseLength)),
+                std::string_view(record.name, record.nameLength));
+        }
+        ring.tail.store(tail, std::memory_order_release);
+    }
+
+    // Rings are drained one after the other, so the file is only in time order per thread. AccessTrace sorts on load
+    void FlushLoop(std::ofstream file) {
+        replicant::archive::TraceEncoder encoder;
+        std::vector<std::byte> out;
+        uint64_t reportedDrops = 0;
+
+        while (true) {
+            std::this_thread::sleep_for(FlushInterval);
+
+            std::vector<ThreadRing*> rings;
+            {
+                std::lock_guard lock(s_rings_mutex);
+                for (const auto& ring : s_rings) rings.push_back(ring.get());
+            }
+
+            out.clear();
+            for (ThreadRing* ring : rings) Drain(*ring, encoder, out);
+            if (out.empty()) continue;
+
+            file.write(reinterpret_cast<const char*>(out.data()), out.size());
+            file.flush();
+
+            uint64_t dropped = s_dropped.load(std::memory_order_relaxed);
+            if (dropped != reportedDrops) {
+                Logger::Log(Warning) << "Trace ring full, " << (dropped - reportedDrops) << " records dropped";
+                reportedDrops = dropped;
+            }
+        }
+    }
+}
+
+void Trace::Detail::Record(replicant::archive::TraceEvent event, std::string_view name) {
+    ThreadRing& ring = ThisThreadRing();
+
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= RingCapacity) {
+        s_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    TraceRecord& record = ring.records[head % RingCapacity];
+    record.ticks = std::chrono::steady_clock::now().time_since_epoch().count();
+    record.event = event;
+    record.nameLength = static_cast<uint8_t>(std::min(name.size(), MaxNameLength));
+    std::memcpy(record.name, name.data(), record.nameLength);
+    std::memcpy(record.phase, playerSaveData->current_phase, MaxPhaseLength);
+
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void Trace::Init() {
+    if (!Settings::Instance().TraceFileAccess) return;
+
+    std::ofstream file(TracePath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        Logger::Log(Error) << "Failed to open " << TracePath << ", file access will not be traced";
+        return;
+    }
+
+    auto header = replicant::archive::TraceEncoder::Header();
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+    s_start = std::chrono::steady_clock::now();
+
+    // Detached, joining it on unload would deadlock in DllMain. At most one interval of records is lost on exit
+    std::thread(FlushLoop, std::move(file)).detach();
+
+    Detail::s_enabled = true;
+    Logger::Log(Info) << "Tracing file access to " << TracePath;
+}
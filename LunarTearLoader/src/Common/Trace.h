@@ -0,0 +1,24 @@
+#pragma once
+#include <replicant/accessTrace.h>
+#include <string_view>
+
+// Records what the game loads, with timestamps and the current phase, to LunarTear/trace.bin (read with
+// replicant::archive::AccessTrace, e.g. by UnsealedVerses trace or archive --layout-trace).
+// Hooks push fixed size records into a lock-free ring owned by their thread; a background thread drains the
+// rings and appends to the file, so recording never waits on IO. A full ring drops records instead of blocking
+namespace Trace
+{
+    namespace Detail {
+        extern bool s_enabled;
+        void Record(replicant::archive::TraceEvent event, std::string_view name);
+    }
+
+    // Starts recording if TraceFileAccess is set. Call once, before hooks are installed
+    void Init();
+
+    inline bool IsActive() { return Detail::s_enabled; }
+
+    inline void Record(replicant::archive::TraceEvent event, std::string_view name) {
+        if (Detail::s_enabled) Detail::Record(event, name);
+    }
+}
@@ -4,6 +4,7 @@
 #include "Common/Settings.h"
 #include "Game/Globals.h"
 #include "Common/Logger.h"
+#include "Common/Trace.h"
 #include "Common/Dump.h"
 #include <string>
 #include <MinHook.h>
@@ -30,6 +31,7 @@ void GameTableStub() {}
 
 extern "C" void* HandleSettbllHook(char* stbl_filename, void* STBL_data) {
     Logger::Log(FileInfo) << "Hooked Table: " << stbl_filename;
+    Trace::Record(replicant::archive::TraceEvent::Table, stbl_filename);
 
     if (Settings::Instance().DumpTables) {
         dumpTable(std::string(stbl_filename), (char*)STBL_data);
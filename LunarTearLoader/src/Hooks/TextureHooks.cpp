@@ -5,6 +5,7 @@
 #include "Common/Settings.h"
 #include "Common/Dump.h"
 #include "Common/Logger.h"
+#include "Common/Trace.h"
 #include "Game/Globals.h"
 #include <crc32c/crc32c.h>
 #include <MinHook.h>
@@ -37,6 +38,8 @@ namespace {
 
 uint64_t TexHook_detoured(tpGxResTexture* tex, void* param_2, void* param_3) {
 
+    Trace::Record(replicant::archive::TraceEvent::Texture, tex->name);
+
     if (Logger::IsActive(FileInfo)) Logger::Log(FileInfo) << "Hooked texture: " << std::string(tex->name)
         << " | Original Format: " << XonFormatToString(tex->bxonAssetHeader->format)
         << " | Original Mipmap Count: " << tex->bxonAssetHeader->mipCount;
@@ -51,14 +54,13 @@ uint64_t TexHook_detoured(tpGxResTexture* tex, void* param_2, void* param_3) {
     std::filesystem::path tex_path(tex->name);
     tex_path.replace_extension(".dds");
 
-    size_t ddsFileSize = 0;
-    void* ddsFileData = LoadLooseTexture(tex_path.string().c_str(), ddsFileSize);
+    const replicant::dds::CatalogTexture* texture = FindLooseTexture(tex_path.string().c_str());
 
-    bool foundByHash = false;
     std::string hashed_filename;
 
     // If not found, try loading by CRC32c hash (older mods based on SpecialK injection use this)
-    if (!ddsFileData) {
+    // Only worth hashing LOD0 when some mod ships hash named textures at all
+    if (!texture && HasHashNamedTextures()) {
         uintptr_t offsetFieldAddr = reinterpret_cast<uintptr_t>(&tex->bxonAssetHeader->offsetToSubresources);
         uintptr_t mipTableAddr = offsetFieldAddr + tex->bxonAssetHeader->offsetToSubresources;
 
@@ -75,35 +77,26 @@ uint64_t TexHook_detoured(tpGxResTexture* tex, void* param_2, void* param_3) {
             hashed_filename = ss.str();
             Logger::Log(Verbose) << "Could not find texture by name. Trying SpecialK hash: " << hashed_filename;
 
-            ddsFileData = LoadLooseTexture(hashed_filename.c_str(), ddsFileSize);
-            if (ddsFileData) {
-                foundByHash = true;
-            }
+            texture = FindLooseTexture(hashed_filename.c_str());
         }
     }
 
-    if (!ddsFileData) {
+    if (!texture) {
         return TexHook_original(tex, param_2, param_3);
     }
 
-    if (foundByHash) {
+    if (!hashed_filename.empty()) {
         Logger::Log(Info) << "Found loose texture file: " << tex_path.string() << " (" << hashed_filename << ")";
     }
     else {
         Logger::Log(Info) << "Found loose texture file: " << tex_path.string();
     }
 
-    std::span<const std::byte> ddsSpan(reinterpret_cast<const std::byte*>(ddsFileData), ddsFileSize);
-    auto dds_result = replicant::dds::DDSFile::LoadFromMemory(ddsSpan);
-    if (!dds_result) {
-        Logger::Log(Error) << " | Failed to parse loose DDS file with libreplicant: " << dds_result.error().message;
-        return TexHook_original(tex, param_2, param_3);
-	}
-
-    const auto& dds_file = *dds_result;
+    // The header was probed during the mod scan, only the pixel data is handed to the game
+    const auto& probe = texture->header;
 
     auto raw_original_format = (replicant::raw::RawSurfaceFormat)tex->bxonAssetHeader->format;
-    auto raw_mod_format = dds_file.getFormat();
+    auto raw_mod_format = probe.format;
 
 
     bool format_ok = (raw_original_format.resourceFormat == raw_mod_format);
@@ -123,32 +116,31 @@ uint64_t TexHook_detoured(tpGxResTexture* tex, void* param_2, void* param_3) {
         return TexHook_original(tex, param_2, param_3);
     }
 
-    if (tex->bxonAssetHeader->width != dds_file.getWidth() || tex->bxonAssetHeader->height != dds_file.getHeight()) {
+    if (tex->bxonAssetHeader->width != probe.width || tex->bxonAssetHeader->height != probe.height) {
         Logger::Log(Error) << " | Resolution mismatch. Original is " << tex->bxonAssetHeader->width << "x" << tex->bxonAssetHeader->height
-            << ", but mod is " << dds_file.getWidth() << "x" << dds_file.getHeight() << ". Texture not replaced.";
+            << ", but mod is " << probe.width << "x" << probe.height << ". Texture not replaced.";
         return TexHook_original(tex, param_2, param_3);
     }
-    if (tex->bxonAssetHeader->depth != dds_file.getDepth()) {
+    if (tex->bxonAssetHeader->depth != probe.depth) {
         Logger::Log(Error) << " | Depth mismatch (Volumetric). Original is " << tex->bxonAssetHeader->depth
-            << ", but mod is " << dds_file.getDepth() << ". Texture not replaced.";
+            << ", but mod is " << probe.depth << ". Texture not replaced.";
         return TexHook_original(tex, param_2, param_3);
     }
-    if (tex->bxonAssetHeader->mipCount != dds_file.getMipLevels()) {
+    if (tex->bxonAssetHeader->mipCount != probe.mipLevels) {
         Logger::Log(Error) << " | Mipmap count mismatch. Original has " << tex->bxonAssetHeader->mipCount
-            << " mips, but mod has " << dds_file.getMipLevels() << ". Texture not replaced.";
+            << " mips, but mod has " << probe.mipLevels << ". Texture not replaced.";
         return TexHook_original(tex, param_2, param_3);
     }
 
 
-    size_t headerSize = 128;
-    const uint32_t* raw_uints = static_cast<const uint32_t*>(ddsFileData);
-    if (raw_uints[21] == 0x30315844) { // "DX10"
-        headerSize = 148;
+    auto pixels = LoadLooseTexturePixels(*texture);
+    if (!pixels) {
+        Logger::Log(Error) << " | Failed to read loose DDS file: " << pixels.error().message;
+        return TexHook_original(tex, param_2, param_3);
     }
-    
 
-    tex->texData = static_cast<char*>(ddsFileData) + headerSize;
-    tex->texDataSize = ddsFileSize - headerSize;
+    tex->texData = const_cast<char*>(reinterpret_cast<const char*>(pixels->data()));
+    tex->texDataSize = pixels->size();
     tex->bxonAssetHeader->size = static_cast<int32_t>(tex->texDataSize);
 
     Logger::Log(Verbose) << " | Successfully replaced texture data for " << tex->name;
@@ -2,6 +2,7 @@
 #include "Hooks/Hooks.h"
 #include "Game/Globals.h"
 #include "Common/Logger.h"
+#include "Common/Trace.h"
 #include "VFS/ArchivePatcher.h"
 #include "ModLoader.h"
 #include <string>
@@ -30,6 +31,8 @@ void decompressArchive_detoured(tpFndTextFormat256* basePath, const char* archiv
     std::string archiveNameStr(archiveName);
     std::string basePathStr(basePath->buffer);
 
+    if (Trace::IsActive()) Trace::Record(replicant::archive::TraceEvent::Archive, basePathStr + archiveNameStr);
+
     if (basePathStr + archiveNameStr == "data/info.arc") {
 
         if (!patching_attempted) {
@@ -3,6 +3,7 @@
 #include "Game/Globals.h"
 #include "Game/Functions.h"
 #include "Common/Settings.h"
+#include "Common/Trace.h"
 #include "Game/d3d11.h"
 #include "ModLoader.h"
 #include "Hooks/Hooks.h"
@@ -57,6 +58,8 @@ DWORD WINAPI Initialize(LPVOID) {
             return FALSE;
         }
 
+        Trace::Init();
+
         InstallTextureHooks();
         InstallScriptInjectHooks();
         InstallTableHooks();
@@ -4,6 +4,9 @@
 #include "API/api.h"
 #include "VFS/ArchivePatcher.h"
 #include "Common/Json.h"
+#include <replicant/textureCatalog.h>
+#include <replicant/textureHashIndex.h>
+#include <replicant/core/io.h>
 
 #include <map>
 #include <set>
@@ -36,7 +39,7 @@ namespace {
     std::map<std::string, Mod> s_mods;
 
     // Last one wins 
-    std::map<std::string, std::filesystem::path> s_resolvedTexturesMap;
+    replicant::dds::TextureCatalog s_textureCatalog;
     std::map<std::string, std::filesystem::path> s_resolvedTablesMap;
 
     // Run all
@@ -60,6 +63,58 @@ namespace {
         return out;
     }
 
+    // SpecialK names replacements by the CRC32C of the texture they replace. With an index from texture-hash-index
+    // those names are turned into the real ones here, so the texture hook does not have to hash every texture.
+    // Hashes the index does not know are kept as they are for the hook's fallback
+    void ResolveHashNamedTextures(std::vector<replicant::dds::TextureSource>& sources) {
+        const std::filesystem::path indexPath = std::filesystem::path("LunarTear") / replicant::TextureHashIndex::DefaultFileName;
+
+        bool anyHashNames = std::any_of(sources.begin(), sources.end(), [](const auto& source) {
+            return replicant::TextureHashIndex::ParseHashName(source.name).has_value();
+            });
+        if (!anyHashNames || !std::filesystem::exists(indexPath)) return;
+
+        auto file = replicant::MappedFile::Open(indexPath);
+        if (!file) {
+            Logger::Log(Error) << "Failed to read " << indexPath.string() << ": " << file.error().message;
+            return;
+        }
+        auto index = replicant::TextureHashIndex::Deserialize(file->data());
+        if (!index) {
+            Logger::Log(Error) << "Failed to parse " << indexPath.string() << ": " << index.error().message;
+            return;
+        }
+
+        std::vector<replicant::dds::TextureSource> resolved;
+        resolved.reserve(sources.size());
+        size_t translated = 0;
+
+        for (auto& source : sources) {
+            auto crc = replicant::TextureHashIndex::ParseHashName(source.name);
+            auto matches = crc ? index->find(*crc) : std::vector<replicant::TextureHashMatch>{};
+            if (matches.empty()) {
+                resolved.push_back(std::move(source));
+                continue;
+            }
+
+            // Identical textures share a hash, SpecialK replaces all of them
+            std::set<std::string> names;
+            for (const auto& match : matches) {
+                std::filesystem::path name = std::filesystem::path(match.texture->name).filename();
+                name.replace_extension(".dds");
+                names.insert(ToLower(name.string()));
+            }
+            for (const auto& name : names) {
+                Logger::Log(Verbose) << "Hash named texture " << source.path.filename().string() << " resolved to " << name;
+                resolved.push_back({ name, source.path });
+            }
+            translated++;
+        }
+
+        Logger::Log(Info) << "Resolved " << translated << " hash named textures using " << indexPath.string();
+        sources = std::move(resolved);
+    }
+
     std::string DetermineModID(const std::filesystem::path& modDir) {
         std::filesystem::path manifestPath = modDir / "manifest.json";
         if (std::filesystem::exists(manifestPath)) {
@@ -152,7 +207,7 @@ void ScanModsAndResolveConflicts() {
     Logger::Log(Verbose) << "Starting Mod Scan...";
 
     s_mods.clear();
-    s_resolvedTexturesMap.clear();
+    s_textureCatalog = {};
     s_resolvedTablesMap.clear();
     s_resolvedScriptsList.clear();
     g_patched_archive_mods.clear();
@@ -221,6 +276,8 @@ void ScanModsAndResolveConflicts() {
     std::sort(sortedIds.begin(), sortedIds.end());
 
     std::map<std::string, std::vector<std::string>> collisionTracker;
+    std::set<std::string> seenTextures;
+    std::vector<replicant::dds::TextureSource> textureSources;
 
     for (const auto& modId : sortedIds) {
         const auto& mod = s_mods.at(modId);
@@ -235,8 +292,8 @@ void ScanModsAndResolveConflicts() {
 
         for (const auto& [name, path] : mod.potentialTextures) {
             std::string lowerName = ToLower(name); 
-            if (s_resolvedTexturesMap.count(lowerName)) collisionTracker[lowerName].push_back(modId);
-            s_resolvedTexturesMap[lowerName] = path;
+            if (!seenTextures.insert(lowerName).second) collisionTracker[lowerName].push_back(modId);
+            textureSources.push_back({ lowerName, path });
         }
 
         for (const auto& [name, path] : mod.potentialTables) {
@@ -270,6 +327,15 @@ void ScanModsAndResolveConflicts() {
         }
     }
 
+    // Headers are probed here, in parallel, so the texture hook only has to look the name up
+    ResolveHashNamedTextures(textureSources);
+    s_textureCatalog = replicant::dds::TextureCatalog::Build(textureSources);
+    for (const auto& rejected : s_textureCatalog.rejected()) {
+        Logger::Log(Error) << "Ignoring loose texture " << rejected.path.string() << ": " << rejected.error.message;
+    }
+    Logger::Log(Verbose) << "Cataloged " << s_textureCatalog.size() << " loose textures"
+        << (s_textureCatalog.hasHashNames() ? ", some named by SpecialK hash" : "");
+
     Logger::Log(Info) << "Mod Scan Complete. Loaded " << sortedIds.size() << " mods.";
 }
 
@@ -309,8 +375,18 @@ void LoadPlugins() {
     }
 }
 
-void* LoadLooseTexture(const char* relativePath, size_t& out_size) {
-    return LoadLooseInternal(ToLower(NormalizePath(relativePath)), s_resolvedTexturesMap, out_size);
+const replicant::dds::CatalogTexture* FindLooseTexture(const char* relativePath) {
+    std::lock_guard<std::mutex> lock(s_stateMutex);
+    return s_textureCatalog.find(ToLower(NormalizePath(relativePath)));
+}
+
+bool HasHashNamedTextures() {
+    std::lock_guard<std::mutex> lock(s_stateMutex);
+    return s_textureCatalog.hasHashNames();
+}
+
+std::expected<std::span<const std::byte>, replicant::Error> LoadLooseTexturePixels(const replicant::dds::CatalogTexture& texture) {
+    return s_textureCatalog.pixels(texture);
 }
 
 void* LoadLooseTable(const char* relativePath, size_t& out_size) {
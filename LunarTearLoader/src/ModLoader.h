@@ -3,7 +3,10 @@
 #include <string>
 #include <optional>
 #include <filesystem>
+#include <expected>
+#include <span>
 #include <replicant/weapon.h>
+#include <replicant/textureCatalog.h>
 #include <nlohmann/json.hpp>
 
 
@@ -11,7 +14,12 @@ void ScanModsAndResolveConflicts();
 void LoadPlugins();
 
 void* LoadLooseTable(const char* relativePath, size_t& out_size);
-void* LoadLooseTexture(const char* relativePath, size_t& out_size);
+
+// Loose DDS replacements, probed during the mod scan. Pixel data is read on first use and stays valid
+const replicant::dds::CatalogTexture* FindLooseTexture(const char* relativePath);
+bool HasHashNamedTextures();
+std::expected<std::span<const std::byte>, replicant::Error> LoadLooseTexturePixels(const replicant::dds::CatalogTexture& texture);
+
 std::vector<std::vector<char>> GetInjectionScripts(const std::string& injectionPoint);
 std::vector<nlohmann::json> GetCustomWeapons();
 
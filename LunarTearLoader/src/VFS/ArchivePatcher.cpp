@@ -1,12 +1,10 @@
 #include "ArchivePatcher.h"
 #include "Common/Logger.h"
-#include "replicant/arc.h"
-#include "replicant/bxon.h"
+#include "Common/Settings.h"
+#include "replicant/indexMerge.h"
 
 #include "replicant/core/io.h"
-#include "replicant/tpArchiveFileParam.h"
 #include <filesystem>
-#include <fstream>
 #include <algorithm>
 #include <expected>
 
@@ -14,13 +12,31 @@ using enum Logger::LogCategory;
 
 namespace {
 
-    uint32_t CalculateHash(std::string_view s) {
-        uint32_t hash = 0x811c9dc5;
-        for (char c : s) {
-            hash *= 0x01000193;              
-            hash ^= static_cast<uint8_t>(c); 
+    const std::filesystem::path OriginalIndexPath = "data/info.arc";
+    const std::filesystem::path PatchedIndexPath = "LunarTear/LunarTear.arc";
+    const std::filesystem::path FingerprintPath = "LunarTear/LunarTear.fingerprint";
+    const std::filesystem::path ConsolidatedArchiveDir = "LunarTear";
+
+    bool FingerprintMatches(const replicant::PatchFingerprint& current) {
+        if (!std::filesystem::exists(FingerprintPath)) return false;
+
+        auto file = replicant::MappedFile::Open(FingerprintPath);
+        if (!file) return false;
+
+        auto previous = replicant::PatchFingerprint::Deserialize(file->data());
+        if (!previous) {
+            Logger::Log(Warning) << "Ignoring unreadable patch fingerprint: " << previous.error().message;
+            return false;
+        }
+        return previous->isUpToDate(current);
+    }
+
+    // Archives consolidated on an earlier launch are dead weight once the patched index stops referencing them
+    void RemoveUnusedConsolidatedArchives() {
+        size_t removed = replicant::RemoveConsolidatedArchives({ std::filesystem::current_path() / ConsolidatedArchiveDir });
+        if (removed > 0) {
+            Logger::Log(Verbose) << "Removed " << removed << " consolidated mod archive(s) that are no longer used.";
         }
-        return hash;
     }
 }
 
@@ -30,165 +46,99 @@ bool GeneratePatchedIndex() {
     try {
         if (g_patched_archive_mods.empty()) {
             Logger::Log(Verbose) << "No VFS mods detected. Skipping archive patching.";
-            return true; 
+            RemoveUnusedConsolidatedArchives();
+            return true;
         }
 
-        auto original_index_data = replicant::ReadFile("data/info.arc");
+        auto original_index_data = replicant::MappedFile::Open(OriginalIndexPath);
         if (!original_index_data) {
             Logger::Log(Error) << "Failed to read original info.arc: " << original_index_data.error().message;
             return false;
         }
 
+        std::sort(g_patched_archive_mods.begin(), g_patched_archive_mods.end(), [](const ModArchive& a, const ModArchive& b) {
+            return a.id < b.id;
+            });
 
-        auto decompressed_size = replicant::archive::GetDecompressedSize(*original_index_data);
-        if (!decompressed_size) {
-            Logger::Log(Error) << "Failed to decompress original info.arc: " << decompressed_size.error().code << " - " << decompressed_size.error().message;
-            return false;
+        std::vector<replicant::ModIndexSource> sources;
+        sources.reserve(g_patched_archive_mods.size());
+        for (const auto& mod : g_patched_archive_mods) {
+            sources.push_back({ mod.id, mod.indexPath });
         }
 
-        auto decompressed_result = replicant::archive::Decompress(*original_index_data, *decompressed_size);
-        if (!decompressed_result) {
-            Logger::Log(Error) << "Failed to decompress original info.arc: " << decompressed_result.error().message;
-            return false;
+        // Same base index, same mod indices in the same order: the LunarTear.arc from last launch is still valid
+        auto fingerprint = replicant::PatchFingerprint::Compute(OriginalIndexPath, original_index_data->data(), sources);
+        fingerprint.consolidated = Settings::Instance().ConsolidateModArchives;
+        if (FingerprintMatches(fingerprint)) {
+            Logger::Log(Verbose) << "Archive mods unchanged since last launch. Reusing LunarTear.arc.";
+            if (!fingerprint.consolidated) RemoveUnusedConsolidatedArchives();
+            return true;
         }
 
-        auto bxonRes = replicant::ParseBxon(*decompressed_result);
-        if (!bxonRes) {
-            Logger::Log(Error) << "Failed to parse info.arc BXON" << bxonRes.error().message;
-            return false;
-        }
+        std::filesystem::path data_root = std::filesystem::current_path() / "data";
 
-        auto& [headerInfo, payload] = *bxonRes;
+        replicant::MergeOptions options;
+        if (fingerprint.consolidated) {
+            options.consolidate = replicant::ConsolidateOptions{ std::filesystem::current_path() / ConsolidatedArchiveDir };
+        }
 
-		auto main_param = replicant::TpArchiveFileParam::Deserialize(payload);
-        if (!main_param) {
-            Logger::Log(Error) << "Failed to parse original info.arc as BXON: " << main_param.error().message;
+        auto merged = replicant::MergeModIndices(original_index_data->data(), sources, data_root, options);
+        if (!merged && fingerprint.consolidated) {
+            Logger::Log(Warning) << "Failed to consolidate mod archives, referencing them directly instead: " << merged.error().toString();
+            fingerprint.consolidated = false;
+            merged = replicant::MergeModIndices(original_index_data->data(), sources, data_root);
+        }
+        if (!merged) {
+            Logger::Log(Error) << "Failed to patch info.arc: " << merged.error().toString();
             return false;
         }
 
-        std::sort(g_patched_archive_mods.begin(), g_patched_archive_mods.end(), [](const ModArchive& a, const ModArchive& b) {
-            return a.id < b.id;
-            });
-
-        bool any_mod_was_valid = false;
-        std::filesystem::path game_root_path = std::filesystem::current_path();
-
-        for (auto& mod : g_patched_archive_mods) {
-            auto mod_index_data = replicant::ReadFile(mod.indexPath);
-            if (!mod_index_data) {
-                Logger::Log(Warning) << "Could not read mod index '" 
-                    << mod.indexPath << "'. Skipping: " << mod_index_data.error().message;
-                continue;
-            }
-
-            auto mod_decompressed_size = replicant::archive::GetDecompressedSize(*mod_index_data);
-            if (!mod_decompressed_size) {
-                Logger::Log(Error) << "Failed to decompress mod index '" << mod.indexPath 
-                    << "'. Skipping:" << mod_decompressed_size.error().code << " - "
-                    << mod_decompressed_size.error().message;
-                continue;
-            }
-            auto mod_decompressed_result = replicant::archive::Decompress(*mod_index_data, *mod_decompressed_size);
-            if (!mod_decompressed_result) {
-                Logger::Log(Warning) << "Failed to decompress mod index '" << mod.indexPath << "'. Skipping:" 
-                    << mod_decompressed_result.error().code 
-                    << " - " << mod_decompressed_result.error().message;
+        for (const auto& mod : merged->mods) {
+            if (!mod.applied) {
+                Logger::Log(Warning) << "VFS Error for mod '" << mod.id << "': " << mod.error << ". Skipping.";
                 continue;
             }
-
-            auto mod_bxonRes = replicant::ParseBxon(*mod_decompressed_result);
-            if (!mod_bxonRes) {
-                Logger::Log(Warning) << "Failed to parse mod index '" << mod.indexPath
-                    << "' as BXON. Skipping: " << mod_bxonRes.error().message;
-                continue;
-            }
-            auto& [modHeader, modPayload] = *mod_bxonRes;
-
-            auto mod_param = replicant::TpArchiveFileParam::Deserialize(modPayload);
-            if (!mod_param) {
-                Logger::Log(Warning) << "Failed to parse mod index '" << mod.indexPath 
-                    << "' as BXON. Skipping: " << mod_param.error().message;
-                continue;
-            }
-  
-            const std::string mod_archive_name = mod_param->archiveEntries[0].filename;
-            std::filesystem::path mod_dir = std::filesystem::path(mod.indexPath).parent_path();
-            std::filesystem::path full_archive_path = mod_dir / mod_archive_name;
-
-            if (!std::filesystem::exists(full_archive_path)) {
-                Logger::Log(Error) << "VFS Error for mod '" << mod.id << "': Index requires archive '" << mod_archive_name << "' but it was not found. Skipping.";
-                continue;
-            }
-
-            any_mod_was_valid = true;
-            std::string final_path_for_index = std::filesystem::relative(full_archive_path, game_root_path / "data").generic_string();
-            uint8_t new_archive_index = main_param->addArchiveEntry(final_path_for_index, mod_param->archiveEntries[0].loadType);
-            main_param->archiveEntries[new_archive_index].arcOffsetScale = mod_param->archiveEntries[0].arcOffsetScale;
-
-            for (const auto& mod_file_entry : mod_param->fileEntries) {
-                auto* game_entry = main_param->findFile(mod_file_entry.name);
-                if (game_entry) { 
-                    Logger::Log(Verbose) << "Overwriting entry: " << mod_file_entry.name;
-                    game_entry->archiveIndex = new_archive_index;
-                    game_entry->rawOffset = mod_file_entry.rawOffset;
-                    game_entry->size = mod_file_entry.size;
-                    game_entry->packFileSerializedSize = mod_file_entry.packFileSerializedSize;
-                    game_entry->packFileResourceSize = mod_file_entry.packFileResourceSize;
-                }
-                else {
-                    Logger::Log(Verbose) << "Adding new entry: " << mod_file_entry.name;
-                    replicant::FileEntry new_fe = mod_file_entry;
-                    new_fe.archiveIndex = new_archive_index;
-                    main_param->fileEntries.push_back(new_fe);
-                }
-            }
+            Logger::Log(Verbose) << "Mod '" << mod.id << "': " << mod.stats.overwritten << " entries overwritten, " << mod.stats.added << " added.";
         }
 
-        if (!any_mod_was_valid) {
+        if (!merged->anyApplied()) {
             Logger::Log(Verbose) << "No valid VFS mods were found after scanning. Skipping patch generation.";
             return false;
         }
 
-        auto& all_file_entries = main_param->fileEntries;
-        std::sort(all_file_entries.begin(), all_file_entries.end(),
-            [](const replicant::FileEntry& a, const replicant::FileEntry& b) {
-                return CalculateHash(a.name) < CalculateHash(b.name);
-            }
-        );
-
-        auto newPayloadRes = (*main_param).Serialize();
-        if (!newPayloadRes) {
-            Logger::Log(Error) << "Failed to serialize patched index: " << newPayloadRes.error().message;
-            return false;
-		}
-		std::vector<std::byte> newPayload = *newPayloadRes;
-
-        auto newBxonRes = replicant::BuildBxon(
-            headerInfo.assetType,
-            headerInfo.version,
-            headerInfo.projectId,
-            newPayload
-        );
-        if (!newBxonRes) {
-            Logger::Log(Error) << "Failed to build patched index BXON: " << newBxonRes.error().message;
-            return false;
-		}
-
-		std::vector<std::byte> newBxon = *newBxonRes;
-
-        auto compressed_index_result = replicant::archive::Compress(newBxon);
-        if (!compressed_index_result) {
-            Logger::Log(Error) << "Failed to compress patched index: " << compressed_index_result.error().message;
-            return false;
+        if (merged->consolidation) {
+            const auto& c = *merged->consolidation;
+            Logger::Log(Verbose) << "Consolidated " << c.frames << " files from " << c.sources.size() << " mod archive(s) into "
+                << c.archives.size() << " archive(s), skipping " << c.shadowedEntries << " shadowed entries.";
         }
 
-        std::filesystem::create_directories("LunarTear");
-        auto writeRes = replicant::WriteFile("LunarTear/LunarTear.arc", *compressed_index_result);
+        // Drop the old fingerprint first so a failed write can never leave a stale one pointing at a broken output
+        std::error_code ec;
+        std::filesystem::remove(FingerprintPath, ec);
+
+        auto writeRes = replicant::WriteFile(PatchedIndexPath, merged->compressedIndex);
         if (!writeRes) {
             Logger::Log(Error) << "Failed to write output file" << writeRes.error().message;
             return false;
         }
 
+        // Also covers a consolidation that failed part way and fell back to the mod archives
+        if (!fingerprint.consolidated) RemoveUnusedConsolidatedArchives();
+
+        // Every mod archive, consolidated or referenced directly, and stamped as missing for mods skipped without
+        // one, so installing, removing or replacing an archive rebuilds the index
+        for (const auto& mod : merged->mods) {
+            if (!mod.archivePath.empty()) fingerprint.addDependency(mod.archivePath);
+        }
+        if (merged->consolidation) {
+            for (const auto& archive : merged->consolidation->archives) fingerprint.addOutput(archive);
+        }
+        fingerprint.addOutput(PatchedIndexPath);
+
+        auto fingerprintData = fingerprint.Serialize();
+        if (!fingerprintData || !replicant::WriteFile(FingerprintPath, *fingerprintData)) {
+            Logger::Log(Warning) << "Failed to write patch fingerprint, LunarTear.arc will be rebuilt on next launch.";
+        }
 
         Logger::Log(Verbose) << "Successfully built sorted and patched LunarTear.arc.";
         return true;
@@ -197,4 +147,4 @@ bool GeneratePatchedIndex() {
         Logger::Log(Error) << "An exception occurred during archive patching: " << e.what();
         return false;
     }
-}
\ No newline at end of file
+}
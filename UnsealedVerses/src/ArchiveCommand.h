@@ -5,21 +5,52 @@
 #include <vector>
 #include <string>
 #include <optional>
+#include <cctype>
 #include "replicant/core/io.h"
 #include "replicant/bxon.h"
 #include "replicant/arc.h"
 #include "replicant/tpArchiveFileParam.h"
+#include "replicant/deadFrames.h"
+#include "replicant/accessTrace.h"
+#include "IndexBuildCommand.h"
+#include <unordered_map>
 
-// TODO: This command is extremely memory heavy
 class ArchiveCommand : public Command {
 private:
     std::optional<std::filesystem::path> m_index_new_path;
     std::optional<std::filesystem::path> m_index_patch_path;
     std::optional<std::filesystem::path> m_index_patch_out_path;
     replicant::ArchiveLoadType m_load_type = replicant::ArchiveLoadType::PRELOAD_DECOMPRESS;
+    unsigned m_jobs = 0;
+    bool m_use_cache = false;
+    bool m_deduplicate = false;
+    uint64_t m_max_memory = 0;
+    bool m_append = false;
+    bool m_compact = false;
+    unsigned m_compact_threshold = 25;
+    std::optional<std::filesystem::path> m_layout_trace_path;
     std::filesystem::path m_output_archive_path;
     std::vector<std::string> m_file_inputs;
 
+    // Byte count with an optional K, M or G suffix (binary units)
+    static std::optional<uint64_t> parse_size(const std::string& text) {
+        size_t pos = 0;
+        uint64_t value;
+        try { value = std::stoull(text, &pos); }
+        catch (...) { return std::nullopt; }
+
+        std::string suffix = text.substr(pos);
+        if (suffix.empty()) return value;
+        if (suffix.size() > 1) return std::nullopt;
+
+        switch (std::toupper(static_cast<unsigned char>(suffix[0]))) {
+        case 'K': return value << 10;
+        case 'M': return value << 20;
+        case 'G': return value << 30;
+        default: return std::nullopt;
+        }
+    }
+
     bool parse_archive_args() {
         if (m_args.empty()) {
             std::cerr << "Error: 'archive' command requires an output path.\n";
@@ -48,6 +79,35 @@ private:
                 }
                 catch (...) { std::cerr << "Error: Invalid number for load type.\n"; return false; }
             }
+            else if (arg == "--cache") {
+                m_use_cache = true;
+            }
+            else if (arg == "--dedupe") {
+                m_deduplicate = true;
+            }
+            else if (arg == "--jobs" && i + 1 < m_args.size()) {
+                try { m_jobs = static_cast<unsigned>(std::stoul(m_args[++i])); }
+                catch (...) { std::cerr << "Error: Invalid number for --jobs.\n"; return false; }
+            }
+            else if (arg == "--max-memory" && i + 1 < m_args.size()) {
+                auto size = parse_size(m_args[++i]);
+                if (!size) { std::cerr << "Error: Invalid size for --max-memory.\n"; return false; }
+                m_max_memory = *size;
+            }
+            else if (arg == "--layout-trace" && i + 1 < m_args.size()) {
+                m_layout_trace_path = m_args[++i];
+            }
+            else if (arg == "--append") {
+                m_append = true;
+            }
+            else if (arg == "--compact") {
+                m_compact = true;
+            }
+            else if (arg == "--compact-threshold" && i + 1 < m_args.size()) {
+                try { m_compact_threshold = static_cast<unsigned>(std::stoul(m_args[++i])); }
+                catch (...) { std::cerr << "Error: Invalid number for --compact-threshold.\n"; return false; }
+                if (m_compact_threshold > 100) { std::cerr << "Error: --compact-threshold is a percentage.\n"; return false; }
+            }
             else {
                 m_file_inputs.push_back(arg);
             }
@@ -56,7 +116,15 @@ private:
         if (m_index_new_path && m_index_patch_path) {
             std::cerr << "Error: Cannot use --index and --patch together.\n"; return false;
         }
-        if (m_file_inputs.empty()) {
+        if ((m_append || m_compact) && !m_index_patch_path) {
+            std::cerr << "Error: --append and --compact need the index referencing the archive, pass it with --patch.\n"; return false;
+        }
+        if (m_append && m_load_type == replicant::ArchiveLoadType::PRELOAD_DECOMPRESS) {
+            std::cerr << "Error: --append only works on stream archives (load type 1 or 2).\n"; return false;
+        }
+        // Compacting on its own only rewrites the archive, it takes no inputs
+        bool compactOnly = m_compact && !m_append;
+        if (m_file_inputs.empty() && !compactOnly) {
             std::cerr << "Error: No input folder provided for archive.\n"; return false;
         }
         if (m_index_patch_path && !m_index_patch_out_path) {
@@ -83,25 +151,208 @@ private:
         writeCompressedIndex(*m_index_new_path, bxon_data);
     }
 
-    void handlePatchMode(const std::string& arc_filename, const std::vector<replicant::archive::ArchiveEntryInfo>& entries) {
-        std::cout << "\nPatching original index: " << *m_index_patch_path << "\n";
+    struct LoadedIndex {
+        replicant::BxonHeaderInfo bxon_info;
+        replicant::TpArchiveFileParam params;
+    };
 
-        auto compressed_data = unwrap(replicant::ReadFile(*m_index_patch_path), "Failed to read index to patch");
+    LoadedIndex loadPatchIndex() {
+        std::vector<std::byte> bxon_data;
+        {
+            // Scoped so the mapping is released before the index is overwritten in place
+            auto compressed_data = unwrap(replicant::MappedFile::Open(*m_index_patch_path), "Failed to read index to patch");
 
-        auto decompressed_size = unwrap(replicant::archive::GetDecompressedSize(compressed_data), "Failed to get decompressed size of index");
-        auto bxon_data = unwrap(replicant::archive::Decompress(compressed_data, decompressed_size), "Failed to decompress index");
+            auto decompressed_size = unwrap(replicant::archive::GetDecompressedSize(compressed_data.data()), "Failed to get decompressed size of index");
+            bxon_data = unwrap(replicant::archive::Decompress(compressed_data.data(), decompressed_size), "Failed to decompress index");
+        }
 
         auto [bxon_info, payload] = unwrap(replicant::ParseBxon(bxon_data), "Failed to parse index BXON");
 
         auto params = unwrap(replicant::TpArchiveFileParam::Deserialize(payload), "Failed to deserialize index payload");
+        return { bxon_info, std::move(params) };
+    }
 
-        uint8_t arc_index = params.addArchiveEntry(arc_filename, m_load_type);
-        params.registerArchive(arc_index, entries);
+    void writePatchIndex(const LoadedIndex& index, const std::filesystem::path& path) {
+        std::vector<std::byte> new_payload = unwrap(index.params.Serialize(), "Failed to serialise new patched index");
+        std::vector<std::byte> new_bxon_data = unwrap(replicant::BuildBxon(index.bxon_info.assetType, index.bxon_info.version, index.bxon_info.projectId, new_payload), "failed to build new index bxon");
+
+        writeCompressedIndex(path, new_bxon_data);
+    }
+
+    void handlePatchMode(const std::string& arc_filename, const std::vector<replicant::archive::ArchiveEntryInfo>& entries) {
+        std::cout << "\nPatching original index: " << *m_index_patch_path << "\n";
+
+        LoadedIndex index = loadPatchIndex();
+
+        uint8_t arc_index = index.params.addArchiveEntry(arc_filename, m_load_type);
+        index.params.registerArchive(arc_index, entries);
+
+        writePatchIndex(index, *m_index_patch_out_path);
+    }
+
+    static std::filesystem::path sidecarPath(const std::filesystem::path& archive, const char* extension) {
+        std::filesystem::path path = archive;
+        path += extension;
+        return path;
+    }
+
+    static std::optional<uint8_t> findArchive(const replicant::TpArchiveFileParam& params, const std::string& arc_filename) {
+        for (size_t i = 0; i < params.archiveEntries.size(); ++i) {
+            if (params.archiveEntries[i].filename == arc_filename) return static_cast<uint8_t>(i);
+        }
+        return std::nullopt;
+    }
+
+    // Dead frames recorded for the archive as it was before this run, empty if the sidecar is missing or stale
+    static replicant::archive::DeadFrames loadDeadFrames(const std::filesystem::path& path, const replicant::FileStamp& archiveStamp) {
+        replicant::archive::DeadFrames dead;
+        std::error_code ec;
+        if (!std::filesystem::exists(path, ec)) return dead;
+
+        auto file = replicant::MappedFile::Open(path);
+        if (!file) return dead;
+
+        auto loaded = replicant::archive::DeadFrames::Deserialize(file->data());
+        if (!loaded || loaded->archiveSize != archiveStamp.size || loaded->archiveMtime != archiveStamp.mtime) return dead;
+        return std::move(*loaded);
+    }
+
+    // Compacts the archive and writes the index patched to match. The index is written to a temporary file before
+    // the archive is replaced and renamed into place right after, so a failed write never leaves an index pointing
+    // into the old layout of a compacted archive. Returns false if only that last rename failed
+    bool compactArchive(LoadedIndex& index, uint8_t arc_index, const std::filesystem::path& cache_path, const std::filesystem::path& dead_path) {
+        auto compacted = unwrap(replicant::archive::Compact(m_output_archive_path, index.params, arc_index, cache_path), "Failed to compact archive");
+
+        std::filesystem::path index_tmp = sidecarPath(*m_index_patch_out_path, ".tmp");
+        std::error_code ec;
+        try {
+            std::cout << "Patching index: " << *m_index_patch_out_path << "\n";
+            writePatchIndex(index, index_tmp);
+            unwrap(replicant::archive::CommitCompact(compacted), "Failed to compact archive");
+        }
+        catch (...) {
+            replicant::archive::DiscardCompact(compacted);
+            std::filesystem::remove(index_tmp, ec);
+            throw;
+        }
+
+        std::cout << "Compacted archive: kept " << compacted.frames << " frames, reclaimed " << compacted.reclaimedBytes << " bytes.\n";
+        if (compacted.cacheDropped) {
+            std::cout << "Warning: Could not update the build cache, it was deleted. The next build recompresses every file.\n";
+        }
+        std::filesystem::remove(dead_path, ec);
+
+        std::filesystem::rename(index_tmp, *m_index_patch_out_path, ec);
+        if (ec) {
+            std::cerr << "Error: The archive was compacted but the patched index could not be moved into place (" << ec.message()
+                << "). Replace " << m_index_patch_out_path->string() << " with " << index_tmp.string() << " before using the archive.\n";
+            return false;
+        }
+        return true;
+    }
 
-        std::vector<std::byte> new_payload = unwrap(params.Serialize(), "Failed to serialise new patched index");
-        std::vector<std::byte> new_bxon_data = unwrap(replicant::BuildBxon(bxon_info.assetType, bxon_info.version, bxon_info.projectId, new_payload), "failed to build new index bxon");
+    // Appends new and changed files to an existing stream archive, patches their entries in the index and tracks
+    // the frames they replaced. The archive is compacted once that dead space reaches the threshold
+    int handleAppend(const std::vector<replicant::archive::ArchiveInput>& inputs, replicant::archive::CompressionConfig config) {
+        std::error_code ec;
+        if (!std::filesystem::exists(m_output_archive_path, ec)) {
+            std::cerr << "Error: Archive to append to does not exist: " << m_output_archive_path.string() << ". Build it without --append first.\n";
+            return 1;
+        }
+
+        std::string arc_filename = m_output_archive_path.filename().string();
+        std::filesystem::path cache_path = sidecarPath(m_output_archive_path, ".cache");
+        std::filesystem::path dead_path = sidecarPath(m_output_archive_path, ".dead");
+
+        LoadedIndex index = loadPatchIndex();
+
+        std::vector<replicant::archive::FrameRange> previous_frames;
+        if (auto existing = findArchive(index.params, arc_filename)) {
+            previous_frames = replicant::archive::DeadFrames::FramesOf(index.params, *existing);
+        }
+
+        replicant::archive::DeadFrames dead = loadDeadFrames(dead_path, replicant::StampOf(m_output_archive_path));
+
+        replicant::archive::AppendOptions options;
+        options.cachePath = cache_path;
+        options.maxMemory = m_max_memory;
+
+        std::cout << "Appending to archive with " << inputs.size() << " files...\n";
+        auto result = unwrap(replicant::archive::Append(m_output_archive_path, inputs, config, options), "Failed to append to archive");
+        std::cout << "Appended " << (result.entries.size() - result.reusedFrames) << " new or changed file(s), "
+            << result.reusedFrames << " unchanged.\n";
+
+        uint8_t arc_index = index.params.addArchiveEntry(arc_filename, m_load_type);
+        index.params.registerArchive(arc_index, result.entries);
+
+        dead.addUnreferenced(previous_frames, index.params, arc_index);
+
+        replicant::FileStamp archive_stamp = replicant::StampOf(m_output_archive_path);
+        uint64_t wasted = dead.wastedBytes();
+        bool over_threshold = archive_stamp.size > 0 && wasted * 100 >= archive_stamp.size * m_compact_threshold;
+        std::cout << "Dead frames: " << dead.frames.size() << " (" << wasted << " of " << archive_stamp.size << " bytes).\n";
 
-        writeCompressedIndex(*m_index_patch_out_path, new_bxon_data);
+        if (m_compact || (wasted > 0 && over_threshold)) {
+            return compactArchive(index, arc_index, cache_path, dead_path) ? 0 : 1;
+        }
+
+        dead.archiveSize = archive_stamp.size;
+        dead.archiveMtime = archive_stamp.mtime;
+        auto dead_data = unwrap(dead.Serialize(), "Failed to serialise dead frame list");
+        unwrap(replicant::WriteFile(dead_path, dead_data), "Failed to write dead frame list");
+
+        std::cout << "Patching index: " << *m_index_patch_out_path << "\n";
+        writePatchIndex(index, *m_index_patch_out_path);
+        return 0;
+    }
+
+    // Rewrites the archive without the frames its index entries no longer reference
+    int handleCompactOnly() {
+        std::string arc_filename = m_output_archive_path.filename().string();
+
+        LoadedIndex index = loadPatchIndex();
+        auto arc_index = findArchive(index.params, arc_filename);
+        if (!arc_index) {
+            std::cerr << "Error: " << arc_filename << " is not referenced by " << m_index_patch_path->string() << ".\n";
+            return 1;
+        }
+
+        return compactArchive(index, *arc_index, sidecarPath(m_output_archive_path, ".cache"), sidecarPath(m_output_archive_path, ".dead")) ? 0 : 1;
+    }
+
+    // Recorded traces name archives and the entries of packs, not the files in the input folders. Maps them onto the
+    // packs of each input folder. An index left there by index-build is reused where still current, but not written
+    // back, since it is one of the inputs
+    void mapTraceToPacks(replicant::archive::AccessTrace& trace) const {
+        std::vector<replicant::AssetIndex> indices;
+        for (const auto& input : m_file_inputs) {
+            std::filesystem::path index_path = IndexBuildCommand::DefaultIndexPath(input);
+            replicant::AssetIndex index;
+            if (std::filesystem::exists(index_path)) index = IndexBuildCommand::LoadAndRefresh(input, index_path, m_jobs, false);
+            unwrap(index.Update(input, m_jobs), "Failed to scan " + input);
+            indices.push_back(std::move(index));
+        }
+
+        auto stats = replicant::archive::MapToPacks(trace, indices);
+        std::cout << "Mapped " << stats.mapped << " traced texture and table access(es) to the packs containing them, "
+            << stats.kept << " kept as named, " << stats.dropped << " archive access(es) dropped.\n";
+    }
+
+    // Seek distance of the trace over the archive as built and as it would have been in scan order
+    static void reportLayout(const replicant::archive::AccessTrace& trace, const std::vector<std::string>& scan_order,
+        const std::vector<replicant::archive::ArchiveEntryInfo>& entries) {
+        std::unordered_map<std::string_view, const replicant::archive::ArchiveEntryInfo*> by_name;
+        by_name.reserve(entries.size());
+        for (const auto& entry : entries) by_name.emplace(entry.name, &entry);
+
+        std::vector<replicant::archive::ArchiveEntryInfo> unordered;
+        unordered.reserve(scan_order.size());
+        for (const auto& name : scan_order) unordered.push_back(*by_name.at(name));
+
+        uint64_t before = replicant::archive::EstimateSeekDistance(unordered, trace);
+        uint64_t after = replicant::archive::EstimateSeekDistance(entries, trace);
+        std::cout << "Estimated seek distance over " << trace.accesses.size() << " traced accesses: " << before << " bytes in scan order, "
+            << after << " bytes with the traced layout.\n";
     }
 
 public:
@@ -112,6 +363,10 @@ public:
         }
 
 
+        if (m_compact && !m_append) {
+            return handleCompactOnly();
+        }
+
         std::vector<replicant::archive::ArchiveInput> inputs;
         std::cout << "Preparing files for archive: " << m_output_archive_path.string() << " \n";
 
@@ -140,11 +395,59 @@ public:
             ? replicant::archive::BuildMode::SingleStream
             : replicant::archive::BuildMode::SeparateFrames;
 
+        // Preload archives are decompressed whole, so only stream archives have a layout worth ordering
+        std::optional<replicant::archive::AccessTrace> trace;
+        std::vector<std::string> scan_order;
+        if (m_layout_trace_path) {
+            if (build_mode != replicant::archive::BuildMode::SeparateFrames) {
+                std::cout << "Warning: --layout-trace only applies to stream archives (load type 1 or 2), ignoring.\n";
+            }
+            else {
+                trace = unwrap(replicant::archive::AccessTrace::Load(*m_layout_trace_path), "Failed to read layout trace");
+                mapTraceToPacks(*trace);
+                scan_order.reserve(inputs.size());
+                for (const auto& input : inputs) scan_order.push_back(input.name);
+
+                auto layout = replicant::archive::OrderByTrace(inputs, *trace);
+                std::cout << "Ordered by trace: " << layout.traced << " traced file(s) in " << trace->phases.size() << " phase(s), "
+                    << layout.shared << " used by several phases, " << layout.untraced << " untraced placed last.\n";
+            }
+        }
+
+        replicant::archive::CompressionConfig config;
+        config.jobs = m_jobs;
+
+        if (m_append) {
+            return handleAppend(inputs, config);
+        }
+
         std::cout << "Building archive with " << inputs.size() << " files...\n";
 
-        auto build_result = unwrap(replicant::archive::Build(m_output_archive_path, inputs, build_mode), "Failed to build archive");
+        replicant::archive::BuildOptions options;
+        options.deduplicate = m_deduplicate;
+        options.maxMemory = m_max_memory;
+        if (m_use_cache) {
+            if (build_mode != replicant::archive::BuildMode::SeparateFrames) {
+                std::cout << "Warning: --cache only applies to stream archives (load type 1 or 2), ignoring.\n";
+            }
+            else {
+                options.cachePath = m_output_archive_path;
+                *options.cachePath += ".cache";
+            }
+        }
+
+        auto build_result = unwrap(replicant::archive::Build(m_output_archive_path, inputs, build_mode, config, options), "Failed to build archive");
 
 		std::cout << "Built archive: " << m_output_archive_path.string() << "\n";
+        if (build_result.dedupedEntries > 0) {
+            std::cout << "Deduplicated " << build_result.dedupedEntries << " identical file(s), saving " << build_result.dedupedBytes << " bytes.\n";
+        }
+        if (trace) {
+            reportLayout(*trace, scan_order, build_result.entries);
+        }
+        if (options.cachePath) {
+            std::cout << "Reused " << build_result.reusedFrames << " of " << build_result.entries.size() << " frames from the build cache.\n";
+        }
 
         std::string arc_filename = m_output_archive_path.filename().string();
         if (m_index_new_path) {
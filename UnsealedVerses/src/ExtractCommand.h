@@ -0,0 +1,59 @@
+#pragma once
+#include "Common.h"
+#include <filesystem>
+#include <iostream>
+#include <vector>
+#include <string>
+#include "replicant/arcReader.h"
+
+class ExtractCommand : public Command {
+public:
+    ExtractCommand(std::vector<std::string> args) : Command(std::move(args)) {}
+    int execute() override {
+        if (m_args.size() < 2) {
+            std::cerr << "Error: extract mode requires <info.arc> <name...> [--out <folder>]\n";
+            return 1;
+        }
+
+        const std::filesystem::path index_path(m_args[0]);
+        std::filesystem::path output_folder = ".";
+        std::vector<std::string> names;
+
+        for (size_t i = 1; i < m_args.size(); ++i) {
+            if (m_args[i] == "--out" && i + 1 < m_args.size()) {
+                output_folder = m_args[++i];
+            }
+            else {
+                names.push_back(m_args[i]);
+            }
+        }
+
+        if (names.empty()) {
+            std::cerr << "Error: No file names given to extract.\n";
+            return 1;
+        }
+
+        auto reader = unwrap(replicant::ArcReader::Open(index_path), "Failed to open index");
+
+        int failed = 0;
+        for (const auto& name : names) {
+            const replicant::FileEntry* entry = reader.find(name);
+            if (!entry) {
+                std::cerr << "Error: '" << name << "' is not in the index.\n";
+                failed++;
+                continue;
+            }
+
+            std::filesystem::path out_path = output_folder / name;
+            auto result = reader.extractTo(*entry, out_path);
+            if (!result) {
+                std::cerr << "Error: Failed to extract '" << name << "': " << result.error().toString() << "\n";
+                failed++;
+                continue;
+            }
+            std::cout << "Extracted: " << name << " (" << reader.params().archiveEntries[entry->archiveIndex].filename << ")\n";
+        }
+
+        return failed == 0 ? 0 : 1;
+    }
+};
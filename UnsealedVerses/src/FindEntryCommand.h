@@ -5,48 +5,132 @@
 #include <vector>
 #include <string>
 #include "replicant/core/io.h"
+#include "replicant/core/parallel.h"
 #include "replicant/pack.h"
 #include "replicant/arc.h"
+#include "IndexBuildCommand.h"
 
 class FindEntryCommand : public Command {
 public:
     FindEntryCommand(std::vector<std::string> args) : Command(std::move(args)) {}
     int execute() override {
-        if (m_args.size() != 2) {
-            std::cerr << "Error: find-entry mode requires <search_folder> <entry_name_to_find>\n";
+        if (m_args.size() < 2) {
+            std::cerr << "Error: find-entry mode requires <search_folder> <entry_name_to_find> [--jobs <n>] [--index <path>] [--no-refresh] [--importers]\n";
             return 1;
         }
 
         const std::filesystem::path search_path(m_args[0]);
         const std::string entry_name = m_args[1];
+        unsigned jobs = 0;
+        std::filesystem::path index_path;
+        bool refresh = true;
+        bool importers = false;
+
+        for (size_t i = 2; i < m_args.size(); ++i) {
+            if (m_args[i] == "--jobs" && i + 1 < m_args.size()) {
+                try { jobs = static_cast<unsigned>(std::stoul(m_args[++i])); }
+                catch (...) { std::cerr << "Error: Invalid number for --jobs.\n"; return 1; }
+            }
+            else if (m_args[i] == "--index" && i + 1 < m_args.size()) {
+                index_path = m_args[++i];
+            }
+            else if (m_args[i] == "--no-refresh") {
+                refresh = false;
+            }
+            else if (m_args[i] == "--importers") {
+                importers = true;
+            }
+            else {
+                std::cerr << "Error: Unknown option '" << m_args[i] << "'\n";
+                return 1;
+            }
+        }
 
         if (!std::filesystem::is_directory(search_path)) {
             std::cerr << "Error: Provided path is not a directory: " << search_path << "\n";
             return 1;
         }
 
-        std::cout << "Searching for entry '" << entry_name << "' in directory '" << search_path.string() << "'...\n";
-        int found_count = 0;
+        // An index left by index-build is picked up automatically
+        if (index_path.empty() && std::filesystem::exists(IndexBuildCommand::DefaultIndexPath(search_path))) {
+            index_path = IndexBuildCommand::DefaultIndexPath(search_path);
+        }
+
+        if (importers) {
+            std::cout << "Searching for PACK files importing '" << entry_name << "' in directory '" << search_path.string() << "'...\n";
+        }
+        else {
+            std::cout << "Searching for entry '" << entry_name << "' in directory '" << search_path.string() << "'...\n";
+        }
+
+        std::vector<std::string> found_paths = index_path.empty()
+            ? searchFiles(search_path, entry_name, importers, jobs)
+            : searchIndex(search_path, index_path, entry_name, importers, jobs, refresh);
+
+        for (const auto& path : found_paths) {
+            std::cout << (importers ? "Imported by: " : "Found in: ") << path << "\n";
+        }
+
+        std::cout << "Search complete. Found " << found_paths.size() << " occurrence(s).\n";
+        return 0;
+    }
+
+private:
+    static std::vector<std::string> searchIndex(const std::filesystem::path& search_path, const std::filesystem::path& index_path,
+        const std::string& entry_name, bool importers, unsigned jobs, bool refresh) {
+        auto index = IndexBuildCommand::LoadAndRefresh(search_path, index_path, jobs, refresh);
+
+        auto packs = importers ? index.findImporters(entry_name) : index.findEntry(entry_name);
 
+        std::vector<std::string> result;
+        result.reserve(packs.size());
+        for (const auto* pack : packs) {
+            result.push_back(pack->path);
+        }
+        return result;
+    }
+
+    static std::vector<std::string> searchFiles(const std::filesystem::path& search_path, const std::string& entry_name,
+        bool importers, unsigned jobs) {
+        std::vector<std::filesystem::path> candidates;
         for (const auto& dir_entry : std::filesystem::recursive_directory_iterator(search_path)) {
             if (dir_entry.is_regular_file()) {
-                const auto& current_file_path = dir_entry.path();
+                candidates.push_back(dir_entry.path());
+            }
+        }
 
-                // TODO: Right now we have to parse the entire PACK file to check for the entry - a regression in the new libreplicant api
+        // Only the tables and string pool of each PACK are read, so this is bound by file opens rather than size
+        std::vector<char> found(candidates.size(), 0);
 
+        replicant::ParallelFor(candidates.size(), jobs, [&](size_t i) {
+            auto probe = replicant::Pack::Probe(candidates[i]);
+            if (!probe) return;
 
-                auto pack_result = replicant::Pack::DeserializeNoResources(current_file_path);
-                if (!pack_result) continue;
+            if (importers) {
+                for (const auto& import : probe->imports) {
+                    if (import.path == entry_name) {
+                        found[i] = 1;
+                        break;
+                    }
+                }
+                return;
+            }
 
-                if (pack_result->findFile(entry_name)) {
-                    std::filesystem::path relative_path = std::filesystem::relative(current_file_path, search_path);
-                    std::cout << "Found in: " << relative_path.generic_string() << "\n";
-                    found_count++;
+            for (const auto& file : probe->files) {
+                if (file.name == entry_name) {
+                    found[i] = 1;
+                    break;
                 }
             }
-        }
+        });
 
-        std::cout << "Search complete. Found " << found_count << " occurrence(s).\n";
-        return 0;
+        std::vector<std::string> result;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (found[i]) {
+                std::filesystem::path relative_path = std::filesystem::relative(candidates[i], search_path);
+                result.push_back(relative_path.generic_string());
+            }
+        }
+        return result;
     }
 };
@@ -0,0 +1,96 @@
+#pragma once
+#include "Common.h"
+#include <filesystem>
+#include <iostream>
+#include <vector>
+#include <string>
+#include "replicant/core/io.h"
+#include "replicant/assetIndex.h"
+
+class IndexBuildCommand : public Command {
+public:
+    IndexBuildCommand(std::vector<std::string> args) : Command(std::move(args)) {}
+
+    static std::filesystem::path DefaultIndexPath(const std::filesystem::path& data_folder) {
+        return data_folder / replicant::AssetIndex::DefaultFileName;
+    }
+
+    // Loads the index at index_path (starting empty if it does not exist or is unreadable), brings it up to date with
+    // data_folder and writes it back if anything changed. Only packs whose size or mtime changed are probed again
+    static replicant::AssetIndex LoadAndRefresh(const std::filesystem::path& data_folder, const std::filesystem::path& index_path,
+        unsigned jobs, bool refresh = true) {
+        replicant::AssetIndex index;
+
+        if (std::filesystem::exists(index_path)) {
+            auto file = replicant::MappedFile::Open(index_path);
+            if (file) {
+                auto loaded = replicant::AssetIndex::Deserialize(file->data());
+                if (loaded) {
+                    index = std::move(*loaded);
+                }
+                else {
+                    std::cerr << "Warning: Ignoring unreadable index " << index_path << ": " << loaded.error().toString() << "\n";
+                }
+            }
+        }
+        else if (!refresh) {
+            throw std::runtime_error("Index does not exist: " + index_path.string());
+        }
+
+        if (!refresh) return index;
+
+        auto stats = unwrap(index.Update(data_folder, jobs), "Failed to scan " + data_folder.string());
+        std::cout << "Index: " << stats.reused << " unchanged, " << stats.scanned << " scanned, " << stats.removed << " removed.\n";
+
+        if (stats.scanned != 0 || stats.removed != 0 || !std::filesystem::exists(index_path)) {
+            auto data = index.Serialize();
+            if (!data) {
+                throw std::runtime_error("Failed to serialize index: " + data.error().toString());
+            }
+            unwrap(replicant::WriteFile(index_path, *data), "Failed to write index");
+        }
+        return index;
+    }
+
+    int execute() override {
+        if (m_args.empty()) {
+            std::cerr << "Error: index-build mode requires <data_folder> [--index <path>] [--jobs <n>]\n";
+            return 1;
+        }
+
+        const std::filesystem::path data_folder(m_args[0]);
+        std::filesystem::path index_path = DefaultIndexPath(data_folder);
+        unsigned jobs = 0;
+
+        for (size_t i = 1; i < m_args.size(); ++i) {
+            if (m_args[i] == "--index" && i + 1 < m_args.size()) {
+                index_path = m_args[++i];
+            }
+            else if (m_args[i] == "--jobs" && i + 1 < m_args.size()) {
+                try { jobs = static_cast<unsigned>(std::stoul(m_args[++i])); }
+                catch (...) { std::cerr << "Error: Invalid number for --jobs.\n"; return 1; }
+            }
+            else {
+                std::cerr << "Error: Unknown option '" << m_args[i] << "'\n";
+                return 1;
+            }
+        }
+
+        if (!std::filesystem::is_directory(data_folder)) {
+            std::cerr << "Error: Provided path is not a directory: " << data_folder << "\n";
+            return 1;
+        }
+
+        std::cout << "Indexing '" << data_folder.string() << "' into '" << index_path.string() << "'...\n";
+        auto index = LoadAndRefresh(data_folder, index_path, jobs);
+
+        size_t pack_count = 0, entry_count = 0;
+        for (const auto& pack : index.packs) {
+            if (!pack.isPack) continue;
+            pack_count++;
+            entry_count += pack.entries.size();
+        }
+        std::cout << "Indexed " << entry_count << " entries in " << pack_count << " PACK file(s).\n";
+        return 0;
+    }
+};
@@ -1,68 +1,271 @@
+#pragma once
+#include "Common.h"
+#include <filesystem>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include "replicant/core/io.h"
+#include "replicant/core/parallel.h"
+#include "replicant/dds.h"
+#include "replicant/bxon.h"
+#include "replicant/tpGxTexHead.h"
 
 class TextureConvertCommand : public Command {
+    struct Job {
+        std::filesystem::path input;
+        std::filesystem::path output;
+    };
+
+    struct Failure {
+        std::filesystem::path input;
+        std::string message;
+    };
+
 public:
     TextureConvertCommand(std::vector<std::string> args) : Command(std::move(args)) {}
     int execute() override {
-        if (m_args.size() != 2) {
-            std::cerr << "Error: texture-convert requires <input> <output>\n";
+        if (m_args.size() < 2) {
+            std::cerr << "Error: texture-convert requires <input> <output> [--jobs <n>] [--force]\n";
             std::cerr << "It will auto-detect conversion direction (.dds -> .rtex or .rtex -> .dds)\n";
             return 1;
         }
-        const std::filesystem::path input_path(m_args[0]);
+        const std::string input_arg = m_args[0];
         const std::filesystem::path output_path(m_args[1]);
+        unsigned jobs = 0;
+        bool force = false;
+
+        for (size_t i = 2; i < m_args.size(); ++i) {
+            if (m_args[i] == "--jobs" && i + 1 < m_args.size()) {
+                try { jobs = static_cast<unsigned>(std::stoul(m_args[++i])); }
+                catch (...) { std::cerr << "Error: Invalid number for --jobs.\n"; return 1; }
+            }
+            else if (m_args[i] == "--force") {
+                force = true;
+            }
+            else {
+                std::cerr << "Error: Unknown option '" << m_args[i] << "'\n";
+                return 1;
+            }
+        }
+
+        const std::filesystem::path input_path(input_arg);
+
+        if (std::filesystem::is_regular_file(input_path)) {
+            if (input_path.extension() == ".dds") {
+                return to_rtex(input_path, output_path);
+            }
+            else if (input_path.extension() == ".rtex") {
+                return to_dds(input_path, output_path);
+            }
+            else {
+                std::cerr << "Error: Input file must be .dds or .rtex\n";
+                return 1;
+            }
+        }
+
+        return convertBatch(input_arg, output_path, jobs, force);
+    }
+
+private:
+    static bool isWildcard(std::string_view s) {
+        return s.find_first_of("*?") != std::string_view::npos;
+    }
+
+    // '*' and '?' stay within a directory, '**' spans any number of them ("**/" also matches none)
+    static bool globMatch(std::string_view pattern, std::string_view path) {
+        if (pattern.empty()) return path.empty();
 
-        if (input_path.extension() == ".dds") {
-            return to_rtex(input_path, output_path);
+        if (pattern.starts_with("**")) {
+            std::string_view rest = pattern.substr(2);
+            if (rest.starts_with('/') && globMatch(rest.substr(1), path)) return true;
+            for (size_t i = 0; i <= path.size(); ++i) {
+                if (globMatch(rest, path.substr(i))) return true;
+            }
+            return false;
         }
-        else if (input_path.extension() == ".rtex") {
-            return to_dds(input_path, output_path);
+
+        if (pattern[0] == '*') {
+            for (size_t i = 0; i <= path.size(); ++i) {
+                if (globMatch(pattern.substr(1), path.substr(i))) return true;
+                if (i < path.size() && path[i] == '/') break;
+            }
+            return false;
+        }
+
+        if (path.empty()) return false;
+        bool same = pattern[0] == '?' ? path[0] != '/' : pattern[0] == path[0];
+        return same && globMatch(pattern.substr(1), path.substr(1));
+    }
+
+    static bool isTexture(const std::filesystem::path& path) {
+        return path.extension() == ".dds" || path.extension() == ".rtex";
+    }
+
+    static bool isInside(const std::filesystem::path& path, const std::filesystem::path& dir) {
+        auto rel = path.lexically_relative(dir);
+        return !rel.empty() && *rel.begin() != "..";
+    }
+
+    // Every .dds/.rtex under a directory, or matching a glob such as "dump/**/*.rtex". Outputs mirror the inputs'
+    // paths relative to the directory, or to the glob's leading wildcard-free directories
+    static std::vector<Job> collectJobs(const std::string& input_arg, const std::filesystem::path& output_root) {
+        std::filesystem::path input(input_arg);
+        std::filesystem::path base;
+        std::string pattern;
+
+        if (isWildcard(input_arg)) {
+            auto it = input.begin();
+            for (; it != input.end() && !isWildcard(it->string()); ++it) base /= *it;
+            for (; it != input.end(); ++it) {
+                if (!pattern.empty()) pattern += '/';
+                pattern += it->string();
+            }
+            if (base.empty()) base = ".";
         }
         else {
-            std::cerr << "Error: Input file must be .dds or .rtex\n";
-            return 1;
+            base = input;
+        }
+
+        if (!std::filesystem::is_directory(base)) {
+            throw std::runtime_error("Input is not a file, directory or glob: " + input_arg);
+        }
+
+        std::error_code ec;
+        auto abs_base = std::filesystem::weakly_canonical(base, ec);
+        auto abs_output = std::filesystem::weakly_canonical(output_root, ec);
+        if (abs_base == abs_output) {
+            throw std::runtime_error("Output folder must differ from the input folder");
         }
+
+        bool output_inside = isInside(abs_output, abs_base);
+
+        std::vector<Job> result;
+        for (const auto& dir_entry : std::filesystem::recursive_directory_iterator(base)) {
+            if (!dir_entry.is_regular_file() || !isTexture(dir_entry.path())) continue;
+
+            // Never feed earlier outputs back in when the output folder lies within the input
+            if (output_inside && isInside(std::filesystem::weakly_canonical(dir_entry.path(), ec), abs_output)) continue;
+
+            std::filesystem::path relative = dir_entry.path().lexically_relative(base);
+            if (!pattern.empty() && !globMatch(pattern, relative.generic_string())) continue;
+
+            std::filesystem::path output = output_root / relative;
+            output.replace_extension(dir_entry.path().extension() == ".dds" ? ".rtex" : ".dds");
+            result.push_back({ dir_entry.path(), std::move(output) });
+        }
+
+        std::sort(result.begin(), result.end(), [](const Job& a, const Job& b) { return a.input < b.input; });
+        return result;
     }
-private:
-    int to_rtex(const std::filesystem::path& input_path, const std::filesystem::path& output_path) {
-        std::cout << "Converting DDS to BXON Texture (.rtex)\n";
-        std::cout << "Input:  " << input_path << "\n";
-        std::cout << "Output: " << output_path << "\n";
 
-        auto dds_file = unwrap(replicant::dds::DDSFile::Load(input_path), "Failed to load DDS file");
-        auto [header, pixel_data] = dds_file.ToGameFormat();
+    // Up to date if the output was written after the input last changed
+    static bool isUpToDate(const Job& job) {
+        std::error_code ec;
+        auto output_time = std::filesystem::last_write_time(job.output, ec);
+        if (ec) return false;
+        auto input_time = std::filesystem::last_write_time(job.input, ec);
+        return !ec && output_time >= input_time;
+    }
+
+    int convertBatch(const std::string& input_arg, const std::filesystem::path& output_root, unsigned jobs, bool force) {
+        std::vector<Job> work = collectJobs(input_arg, output_root);
+        if (work.empty()) {
+            std::cerr << "Error: No .dds or .rtex files found in '" << input_arg << "'\n";
+            return 1;
+        }
 
-        std::vector<std::byte> serialized_header = unwrap(replicant::SerializeTexHead(header), "Failed to serialise new tex header");
+        std::cout << "Converting " << work.size() << " texture(s) from '" << input_arg << "' into '" << output_root.string() << "'...\n";
 
-        std::vector<std::byte> payload;
-        payload.insert(payload.end(), serialized_header.begin(), serialized_header.end());
-        payload.insert(payload.end(), pixel_data.begin(), pixel_data.end());
+        replicant::DirectoryCache directories;
+        std::atomic<size_t> converted = 0;
+        std::atomic<size_t> skipped = 0;
+        std::mutex failures_mutex;
+        std::vector<Failure> failures;
 
-        std::vector<std::byte> bxon_data = unwrap(replicant::BuildBxon("tpGxTexHead", 3, 0x2ea74106, payload), "Failed to build new rtex bxon");
-        unwrap(replicant::WriteFile(output_path, bxon_data), "Failed to write output .rtex file");
+        replicant::ParallelFor(work.size(), jobs, [&](size_t i) {
+            const Job& job = work[i];
+            if (!force && isUpToDate(job)) {
+                skipped++;
+                return;
+            }
 
-        std::cout << "Successfully created " << output_path << "\n";
+            try {
+                unwrap(directories.ensure(job.output.parent_path()), "Failed to create output folder");
+                if (job.input.extension() == ".dds") {
+                    convertToRtex(job.input, job.output);
+                }
+                else {
+                    convertToDds(job.input, job.output);
+                }
+                converted++;
+            }
+            catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(failures_mutex);
+                failures.push_back({ job.input, e.what() });
+            }
+        });
+
+        std::cout << "Converted " << converted << ", skipped " << skipped << " up to date, " << failures.size() << " failed.\n";
+
+        if (!failures.empty()) {
+            std::sort(failures.begin(), failures.end(), [](const Failure& a, const Failure& b) { return a.input < b.input; });
+            std::cerr << "\nFailed conversions:\n";
+            for (const auto& failure : failures) {
+                std::cerr << "  " << failure.input.string() << ": " << failure.message << "\n";
+            }
+            return 1;
+        }
         return 0;
     }
 
-    int to_dds(const std::filesystem::path& input_path, const std::filesystem::path& output_path) {
-        std::cout << "Converting BXON Texture (.rtex) to DDS\n";
-        std::cout << "Input:  " << input_path << "\n";
-        std::cout << "Output: " << output_path << "\n";
+    static void convertToRtex(const std::filesystem::path& input_path, const std::filesystem::path& output_path) {
+        auto dds_file = unwrap(replicant::dds::DDSFile::Load(input_path), "Failed to load DDS file");
+
+        std::vector<std::byte> bxon_data = unwrap(dds_file.ToRtex(), "Failed to build new rtex bxon");
+        unwrap(replicant::WriteFile(output_path, bxon_data), "Failed to write output .rtex file");
+    }
 
-        auto rtex_data = unwrap(replicant::ReadFile(input_path), "Failed to read .rtex file");
-        auto [bxon_info, payload] = unwrap(replicant::ParseBxon(rtex_data), "Failed to parse BXON container");
+    static void convertToDds(const std::filesystem::path& input_path, const std::filesystem::path& output_path) {
+        auto rtex_data = unwrap(replicant::MappedFile::Open(input_path), "Failed to read .rtex file");
+        auto [bxon_info, payload] = unwrap(replicant::ParseBxon(rtex_data.data()), "Failed to parse BXON container");
 
         if (bxon_info.assetType != "tpGxTexHead") {
-            std::cerr << "Error: Input file is not an rtex file.\n"; return 1;
+            throw std::runtime_error("Input file is not an rtex file");
         }
 
         auto header = unwrap(replicant::DeserializeTexHead(payload), "Failed to parse texture header");
 
-        size_t header_size = unwrap(replicant::SerializeTexHead(header), "Failed to get Tex head size").size();
+        size_t header_size = replicant::SerializedTexHeadSize(header);
+        if (header_size > payload.size()) {
+            throw std::runtime_error("Texture header is larger than the file");
+        }
         std::span<const std::byte> pixel_data = payload.subspan(header_size);
 
-        auto dds_file = unwrap(replicant::dds::DDSFile::CreateFromGameData(header, pixel_data), "Failed to create DDS from game data");
-        unwrap(dds_file.Save(output_path), "Failed to save DDS file");
+        // Pixels go from the mapped input straight to the output file
+        unwrap(replicant::dds::DDSFile::SaveGameData(header, pixel_data, output_path), "Failed to save DDS file");
+    }
+
+    int to_rtex(const std::filesystem::path& input_path, const std::filesystem::path& output_path) {
+        std::cout << "Converting DDS to BXON Texture (.rtex)\n";
+        std::cout << "Input:  " << input_path << "\n";
+        std::cout << "Output: " << output_path << "\n";
+
+        convertToRtex(input_path, output_path);
+
+        std::cout << "Successfully created " << output_path << "\n";
+        return 0;
+    }
+
+    int to_dds(const std::filesystem::path& input_path, const std::filesystem::path& output_path) {
+        std::cout << "Converting BXON Texture (.rtex) to DDS\n";
+        std::cout << "Input:  " << input_path << "\n";
+        std::cout << "Output: " << output_path << "\n";
+
+        convertToDds(input_path, output_path);
 
         std::cout << "Successfully converted to " << output_path << "\n";
         return 0;
@@ -0,0 +1,102 @@
+#pragma once
+#include "Common.h"
+#include <filesystem>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <format>
+#include "replicant/core/io.h"
+#include "replicant/core/crc32c.h"
+#include "replicant/textureHashIndex.h"
+
+class TextureHashIndexCommand : public Command {
+private:
+    // Accepts "0123ABCD.dds" as well as a bare "0123ABCD"
+    static std::optional<uint32_t> parseHash(const std::string& text) {
+        if (auto crc = replicant::TextureHashIndex::ParseHashName(text)) return crc;
+        return replicant::TextureHashIndex::ParseHashName(text + ".dds");
+    }
+
+public:
+    TextureHashIndexCommand(std::vector<std::string> args) : Command(std::move(args)) {}
+    int execute() override {
+        if (m_args.empty()) {
+            std::cerr << "Error: texture-hash-index mode requires <data_folder> [--index <path>] [--jobs <n>] [--lookup <hash>]\n";
+            return 1;
+        }
+
+        const std::filesystem::path data_folder(m_args[0]);
+        std::filesystem::path index_path = data_folder / replicant::TextureHashIndex::DefaultFileName;
+        unsigned jobs = 0;
+        std::vector<std::string> lookups;
+
+        for (size_t i = 1; i < m_args.size(); ++i) {
+            if (m_args[i] == "--index" && i + 1 < m_args.size()) {
+                index_path = m_args[++i];
+            }
+            else if (m_args[i] == "--jobs" && i + 1 < m_args.size()) {
+                try { jobs = static_cast<unsigned>(std::stoul(m_args[++i])); }
+                catch (...) { std::cerr << "Error: Invalid number for --jobs.\n"; return 1; }
+            }
+            else if (m_args[i] == "--lookup" && i + 1 < m_args.size()) {
+                lookups.push_back(m_args[++i]);
+            }
+            else {
+                std::cerr << "Error: Unknown option '" << m_args[i] << "'\n";
+                return 1;
+            }
+        }
+
+        if (!std::filesystem::is_directory(data_folder)) {
+            std::cerr << "Error: Provided path is not a directory: " << data_folder << "\n";
+            return 1;
+        }
+
+        replicant::TextureHashIndex index;
+        if (std::filesystem::exists(index_path)) {
+            auto file = replicant::MappedFile::Open(index_path);
+            if (file) {
+                auto loaded = replicant::TextureHashIndex::Deserialize(file->data());
+                if (loaded) {
+                    index = std::move(*loaded);
+                }
+                else {
+                    std::cerr << "Warning: Ignoring unreadable index " << index_path << ": " << loaded.error().toString() << "\n";
+                }
+            }
+        }
+
+        std::cout << "Hashing textures in '" << data_folder.string() << "' into '" << index_path.string() << "'"
+            << (replicant::crc32cAccelerated() ? "" : " (no SSE 4.2, using software CRC32C)") << "...\n";
+
+        auto stats = unwrap(index.Update(data_folder, jobs), "Failed to scan " + data_folder.string());
+        std::cout << "Index: " << stats.reused << " unchanged, " << stats.scanned << " scanned (" << stats.textures
+            << " textures hashed), " << stats.removed << " removed.\n";
+
+        if (stats.scanned != 0 || stats.removed != 0 || !std::filesystem::exists(index_path)) {
+            auto data = unwrap(index.Serialize(), "Failed to serialize texture hash index");
+            unwrap(replicant::WriteFile(index_path, data), "Failed to write texture hash index");
+        }
+
+        size_t texture_count = 0;
+        for (const auto& pack : index.packs) texture_count += pack.textures.size();
+        std::cout << "Indexed " << texture_count << " textures.\n";
+        std::cout << "Copy the index into the LunarTear folder to have hash named mod textures resolved at startup.\n";
+
+        for (const auto& lookup : lookups) {
+            auto crc = parseHash(lookup);
+            if (!crc) {
+                std::cerr << "Error: '" << lookup << "' is not a texture hash\n";
+                continue;
+            }
+
+            auto matches = index.find(*crc);
+            std::cout << "\n" << std::format("{:08X}", *crc) << ": " << matches.size() << " texture(s)\n";
+            for (const auto& match : matches) {
+                std::cout << "  " << match.texture->name << " in " << match.pack->path << "\n";
+            }
+        }
+
+        return 0;
+    }
+};
@@ -5,6 +5,7 @@
 #include <vector>
 #include <string>
 #include "replicant/core/io.h"
+#include "replicant/pack.h"
 #include "replicant/dds.h"
 #include "replicant/bxon.h"
 
@@ -31,8 +32,13 @@ public:
             return 1;
         }
 
-        auto pack_data = unwrap(replicant::ReadFile(input_path), "Failed to read input PACK file");
-        auto pack = unwrap(replicant::Pack::Deserialize(pack_data), "Failed to parse PACK file");
+        replicant::Pack pack;
+        {
+            // Scoped so the input mapping is released before the output (which may be the same file) is written
+            auto pack_data = unwrap(replicant::MappedFile::Open(input_path), "Failed to read input PACK file");
+            auto pack_view = unwrap(replicant::PackView::Deserialize(pack_data.data()), "Failed to parse PACK file");
+            pack = pack_view.toPack();
+        }
 
         int patch_count = 0;
         for (const auto& dir_entry : std::filesystem::recursive_directory_iterator(dds_folder_path)) {
@@ -46,7 +52,20 @@ public:
                 if (entry_to_patch) {
                     std::cout << "Patching '" << entry_name << "' with '" << dds_path.string() << "'...\n";
 
-                    auto dds_file = unwrap(replicant::dds::DDSFile::Load(dds_path), "Failed to load patch DDS " + dds_path.string());
+                    auto dds_data = unwrap(replicant::MappedFile::Open(dds_path), "Failed to read patch DDS " + dds_path.string());
+
+                    // Reject files the game cannot use from the header alone, before paying for a full decode
+                    auto probe = replicant::dds::ProbeHeader(dds_data.data());
+                    if (!probe) {
+                        std::cerr << "Error: Invalid DDS " << dds_path.string() << ": " << probe.error().toString() << "\n";
+                        continue;
+                    }
+                    if (probe->format == replicant::TextureFormat::UNKNOWN) {
+                        std::cerr << "Error: " << dds_path.string() << " uses a pixel format the game does not support\n";
+                        continue;
+                    }
+
+                    auto dds_file = unwrap(replicant::dds::DDSFile::LoadFromMemory(dds_data.data()), "Failed to load patch DDS " + dds_path.string());
 
                     auto [header, pixel_data] = dds_file.ToGameFormat();
 
@@ -0,0 +1,79 @@
+#pragma once
+#include "Common.h"
+#include <filesystem>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <format>
+#include "replicant/core/io.h"
+#include "replicant/accessTrace.h"
+
+class TraceCommand : public Command {
+private:
+    static const char* eventName(size_t event) {
+        switch (static_cast<replicant::archive::TraceEvent>(event)) {
+        case replicant::archive::TraceEvent::File:    return "files";
+        case replicant::archive::TraceEvent::Archive: return "archives";
+        case replicant::archive::TraceEvent::Texture: return "textures";
+        case replicant::archive::TraceEvent::Table:   return "tables";
+        default:                                      return "other";
+        }
+    }
+
+    static std::string seconds(uint64_t nanoseconds) {
+        return std::format("{:.3f}s", static_cast<double>(nanoseconds) / 1e9);
+    }
+
+public:
+    TraceCommand(std::vector<std::string> args) : Command(std::move(args)) {}
+    int execute() override {
+        if (m_args.empty()) {
+            std::cerr << "Error: trace mode requires <trace.bin> [--load-order <out.txt>]\n";
+            return 1;
+        }
+
+        const std::filesystem::path trace_path(m_args[0]);
+        std::filesystem::path load_order_path;
+
+        for (size_t i = 1; i < m_args.size(); ++i) {
+            if (m_args[i] == "--load-order" && i + 1 < m_args.size()) {
+                load_order_path = m_args[++i];
+            }
+            else {
+                std::cerr << "Error: Unknown option '" << m_args[i] << "'\n";
+                return 1;
+            }
+        }
+
+        auto trace = unwrap(replicant::archive::AccessTrace::Load(trace_path), "Failed to read trace");
+        auto summary = replicant::archive::Summarize(trace);
+
+        std::cout << "Trace: " << trace_path.string() << "\n";
+        std::cout << summary.accesses << " accesses to " << summary.distinct << " distinct names over " << seconds(summary.duration) << "\n";
+        for (size_t event = 0; event < summary.byEvent.size(); ++event) {
+            if (summary.byEvent[event] > 0) std::cout << "  " << eventName(event) << ": " << summary.byEvent[event] << "\n";
+        }
+
+        std::cout << "\nPhases in order of first access:\n";
+        for (const auto& phase : summary.phases) {
+            std::cout << "  " << (phase.label.empty() ? "(none)" : phase.label) << ": " << phase.accesses << " accesses, "
+                << phase.distinct << " distinct, " << seconds(phase.firstTime) << " - " << seconds(phase.lastTime) << "\n";
+        }
+
+        if (!load_order_path.empty()) {
+            std::string load_order = replicant::archive::ToLoadOrder(trace);
+            auto bytes = std::as_bytes(std::span(load_order.data(), load_order.size()));
+            unwrap(replicant::WriteFile(load_order_path, bytes), "Failed to write load order");
+            std::cout << "\nWrote load order to " << load_order_path.string() << " (usable with archive --layout-trace).\n";
+        }
+
+        // Only packs are stored in stream archives, the recorded names are entries inside them or whole .arc files
+        if (summary.byEvent[static_cast<size_t>(replicant::archive::TraceEvent::Texture)] > 0 ||
+            summary.byEvent[static_cast<size_t>(replicant::archive::TraceEvent::Table)] > 0) {
+            std::cout << "\nTexture and table names are entries inside PACK files. archive --layout-trace maps them to the packs\n"
+                "of its input folders that contain them; archive accesses are not used for layout.\n";
+        }
+
+        return 0;
+    }
+};
@@ -1,16 +1,29 @@
-#include <future>
+#include <atomic>
 #include <mutex>
+#include <optional>
+#include "replicant/core/parallel.h"
 
 class UnarchiveCommand : public Command {
     std::mutex console_mutex; 
+    replicant::DirectoryCache directories;
 
 	bool chara_only = false;
+    unsigned jobs = 0;
+
+    // Adjacent frames are extracted as one job up to this many bytes of archive, read front to back
+    static constexpr uint64_t BATCH_BYTES = 8 * 1024 * 1024;
+
+    struct Batch {
+        size_t archive;
+        size_t first;
+        size_t last;
+    };
 
 public:
     UnarchiveCommand(std::vector<std::string> args) : Command(std::move(args)) {}
 
     int execute() override {
-        if (m_args.size() != 2 && m_args.size() != 3) {
+        if (m_args.size() < 2) {
             std::cerr << "Error: unarchive mode requires <info.arc> <output_folder> [options]\n";
             return 1;
         }
@@ -18,26 +31,28 @@ public:
         const std::filesystem::path output_folder_base(m_args[1]);
         const std::filesystem::path archive_dir = index_path.parent_path();
 
-    
-        if (m_args.size() == 3) {
-            if (m_args[2] == "--chara-only") {
+        for (size_t i = 2; i < m_args.size(); ++i) {
+            if (m_args[i] == "--chara-only") {
                 chara_only = true;
             }
+            else if (m_args[i] == "--jobs" && i + 1 < m_args.size()) {
+                try { jobs = static_cast<unsigned>(std::stoul(m_args[++i])); }
+                catch (...) { std::cerr << "Error: Invalid number for --jobs.\n"; return 1; }
+            }
             else {
-                std::cerr << "Error: Unknown option '" << m_args[2] << "'\n";
+                std::cerr << "Error: Unknown option '" << m_args[i] << "'\n";
                 return 1;
             }
-
         }
 
         std::cout << "Unpacking archives using index: " << index_path << "\n";
 
-        auto compressed_index = unwrap(replicant::ReadFile(index_path), "Failed to read index");
+        auto compressed_index = unwrap(replicant::MappedFile::Open(index_path), "Failed to read index");
 
         size_t dSize = 0;
-        if (auto sz = replicant::archive::GetDecompressedSize(compressed_index)) dSize = *sz;
+        if (auto sz = replicant::archive::GetDecompressedSize(compressed_index.data())) dSize = *sz;
 
-        auto bxon_data = unwrap(replicant::archive::Decompress(compressed_index, dSize), "Index decompress failed");
+        auto bxon_data = unwrap(replicant::archive::Decompress(compressed_index.data(), dSize), "Index decompress failed");
 
         auto [info, payload] = unwrap(replicant::ParseBxon(bxon_data), "Index BXON parse failed");
         if (info.assetType != "tpArchiveFileParam") throw std::runtime_error("Invalid asset type");
@@ -55,136 +70,219 @@ public:
             }
         }
 
-        std::vector<std::future<void>> futures;
+        // Frames in on-disk order, so every job reads forward through its archive
+        for (auto& file_list : files_per_archive) {
+            std::sort(file_list.begin(), file_list.end(), [](const replicant::FileEntry* a, const replicant::FileEntry* b) {
+                return a->rawOffset < b->rawOffset;
+                });
+        }
+
+        std::vector<std::optional<replicant::MappedFile>> archives(params.archiveEntries.size());
+        std::vector<Batch> batches;
+        std::vector<Batch> stream_batches;
 
         for (size_t i = 0; i < params.archiveEntries.size(); ++i) {
-            const auto& arc_entry = params.archiveEntries[i];
+            const auto& arc_meta = params.archiveEntries[i];
             const auto& file_list = files_per_archive[i];
-
             if (file_list.empty()) continue;
 
-            futures.push_back(std::async(std::launch::async,
-                [this,
-                i,
-                arc_entry = std::cref(arc_entry),
-                file_list = std::cref(file_list),
-                archive_dir,
-                output_folder_base]()
-                {
-                    try {
-                        processArchive(
-                            i,
-                            arc_entry.get(),
-                            file_list.get(),
-                            archive_dir,
-                            output_folder_base
-                        );
-                    }
-                    catch (const std::exception& e) {
-                        std::lock_guard<std::mutex> lock(console_mutex);
-                        std::cerr << "Error in archive '"
-                            << arc_entry.get().filename
-                            << "': " << e.what() << "\n";
-                    }
+            auto mapped = replicant::MappedFile::Open(archive_dir / arc_meta.filename);
+            if (!mapped) {
+                std::cerr << "Error in archive '" << arc_meta.filename << "': " << mapped.error().message << "\n";
+                continue;
+            }
+            archives[i] = std::move(*mapped);
+
+            std::cout << "Queued " << arc_meta.filename << " (" << file_list.size() << " files)\n";
+
+            // A preload archive is a single stream and cannot be split. Queued first so it does not end up on the tail
+            if (arc_meta.loadType == replicant::ArchiveLoadType::PRELOAD_DECOMPRESS) {
+                batches.push_back({ i, 0, file_list.size() });
+                continue;
+            }
+
+            size_t first = 0;
+            uint64_t batch_start = file_list[0]->rawOffset;
+            for (size_t f = 1; f < file_list.size(); ++f) {
+                uint64_t frame_end = file_list[f]->rawOffset + file_list[f]->size;
+                if (frame_end - batch_start > BATCH_BYTES) {
+                    stream_batches.push_back({ i, first, f });
+                    first = f;
+                    batch_start = file_list[f]->rawOffset;
                 }
-            ));
+            }
+            stream_batches.push_back({ i, first, file_list.size() });
         }
+        batches.insert(batches.end(), stream_batches.begin(), stream_batches.end());
 
-        for (auto& f : futures) {
-            f.wait();
-        }
+        std::vector<std::atomic<size_t>> batches_left(params.archiveEntries.size());
+        for (const auto& batch : batches) batches_left[batch.archive]++;
+
+        replicant::ParallelForStealing(batches.size(), jobs, [&](size_t b) {
+            const Batch& batch = batches[b];
+            const auto& arc_meta = params.archiveEntries[batch.archive];
+            std::span<const replicant::FileEntry* const> files(files_per_archive[batch.archive].data() + batch.first, batch.last - batch.first);
+
+            try {
+                processBatch(arc_meta, *archives[batch.archive], files, output_folder_base);
+            }
+            catch (const std::exception& e) {
+                std::lock_guard<std::mutex> lock(console_mutex);
+                std::cerr << "Error in archive '" << arc_meta.filename << "': " << e.what() << "\n";
+            }
+
+            if (--batches_left[batch.archive] == 0) {
+                std::lock_guard<std::mutex> lock(console_mutex);
+                std::cout << "Finished " << arc_meta.filename << ".\n";
+            }
+        });
 
         std::cout << "\nUnpacking complete.\n";
         return 0;
     }
 
 private:
-    void processArchive(
-        size_t index,
+    void processBatch(
         const replicant::ArchiveEntry& arc_meta,
-        const std::vector<const replicant::FileEntry*>& files,
-        const std::filesystem::path& arc_dir,
+        const replicant::MappedFile& arc_data,
+        std::span<const replicant::FileEntry* const> files,
         const std::filesystem::path& out_base
     ) {
-        std::filesystem::path arc_path = arc_dir / arc_meta.filename;
+        // PRELOAD 
+        if (arc_meta.loadType == replicant::ArchiveLoadType::PRELOAD_DECOMPRESS) {
+            extractPreload(arc_meta, arc_data.data(), files, out_base);
+            return;
+        }
 
-        {
-            std::lock_guard<std::mutex> lock(console_mutex);
-            std::cout << "Processing " << arc_meta.filename << " (" << files.size() << " files)...\n";
+        // STREAM
+        uint64_t batch_start = files.front()->rawOffset;
+        uint64_t batch_end = 0;
+        for (const auto* file : files) batch_end = std::max<uint64_t>(batch_end, file->rawOffset + file->size);
+        if (batch_end > arc_data.size()) {
+            throw std::runtime_error("Frames out of bounds in " + arc_meta.filename);
         }
 
-        // PRELOAD 
-        if (arc_meta.loadType == replicant::ArchiveLoadType::PRELOAD_DECOMPRESS) {
-            auto arc_data = unwrap(replicant::ReadFile(arc_path), "Failed to read " + arc_meta.filename);
-
-            // Decompress the ENTIRE archive to memory - the largest vanilla preload arc is 9MB
-            size_t dSize = 0;
-            if (auto sz = replicant::archive::GetDecompressedSize(arc_data)) dSize = *sz;
-            auto blob = unwrap(replicant::archive::Decompress(arc_data, dSize), "Decompress failed " + arc_meta.filename);
-
-            for (const auto* file : files) {
-                
-                std::filesystem::path out_path = out_base / file->name;
-
-
-                uint64_t extract_size = file->size;
-                if (extract_size == 0) {
-                    // Preload compressedSizes report 0. Infer size from offsets mapping against the decoded blob!
-                    uint64_t next_offset = blob.size();
-                    for (const auto* f : files) {
-                        if (f->rawOffset > file->rawOffset && f->rawOffset < next_offset) {
-                            next_offset = f->rawOffset;
-                        }
-                    }
-                    extract_size = next_offset - file->rawOffset;
-                }
+        // One large sequential read for the whole batch instead of a page fault per frame
+        arc_data.prefetch(static_cast<size_t>(batch_start), static_cast<size_t>(batch_end - batch_start));
+
+        for (const auto* file : files) {
+            auto frame = arc_data.data().subspan(static_cast<size_t>(file->rawOffset), file->size);
 
-                // For Type 0: rawOffset is offset into DECOMPRESSED blob
-                // size is the uncompressed size
-                if (file->rawOffset + extract_size > blob.size()) {
-                    throw std::runtime_error("File " + file->name + " out of bounds in " + arc_meta.filename);
+            // Decompressed straight into the output file, the frame header gives the exact size to preallocate
+            uint64_t expected_size = 0;
+            if (auto sz = replicant::archive::GetDecompressedSize(frame)) expected_size = *sz;
+
+            auto sink = unwrap(replicant::FileSink::Create(out_base / file->name, expected_size, &directories), "Write failed " + file->name);
+            unwrap(replicant::archive::DecompressToSink(frame, [&](std::span<const std::byte> chunk) -> std::expected<void, replicant::Error> {
+                if (auto written = sink.write(chunk); !written) {
+                    return std::unexpected(replicant::Error{ replicant::ErrorCode::IoError, written.error().message });
                 }
+                return {};
+            }), "Decompress failed " + file->name);
+            unwrap(sink.close(), "Write failed " + file->name);
+        }
+    }
+
+    // The preload archive is one zstd stream, decompressed once in chunks and routed to the files by offset so the
+    // whole blob never has to be in memory. Each file runs up to the next distinct offset (or the end of the
+    // stream), matching how the sizes of preload entries are inferred elsewhere
+    void extractPreload(
+        const replicant::ArchiveEntry& arc_meta,
+        std::span<const std::byte> arc_data,
+        std::span<const replicant::FileEntry* const> files,
+        const std::filesystem::path& out_base
+    ) {
+        constexpr uint64_t unknown_end = UINT64_MAX;
+
+        uint64_t stream_size = unknown_end;
+        if (auto sz = replicant::archive::GetDecompressedSize(arc_data)) stream_size = *sz;
+
+        struct Target {
+            const replicant::FileEntry* file;
+            uint64_t begin;
+            uint64_t end;
+        };
 
-                std::span<const std::byte> file_span(blob.data() + file->rawOffset, static_cast<size_t>(extract_size));
-                unwrap(replicant::WriteFile(out_path, file_span), "Write failed " + file->name);
+        std::vector<Target> targets;
+        targets.reserve(files.size());
+        for (const auto* file : files) {
+            targets.push_back({ file, file->rawOffset, 0 });
+        }
+        std::sort(targets.begin(), targets.end(), [](const Target& a, const Target& b) { return a.begin < b.begin; });
+
+        for (size_t i = 0; i < targets.size(); ++i) {
+            if (targets[i].file->size != 0) {
+                targets[i].end = targets[i].begin + targets[i].file->size;
+                continue;
             }
+            auto next = std::upper_bound(targets.begin() + i, targets.end(), targets[i].begin,
+                [](uint64_t offset, const Target& t) { return offset < t.begin; });
+            targets[i].end = next != targets.end() ? next->begin : stream_size;
         }
-        // STREAM
-        else {
-            std::ifstream arc_stream(arc_path, std::ios::binary);
-            if (!arc_stream) throw std::runtime_error("Could not open " + arc_path.string());
 
-            std::vector<std::byte> compressed_buf;
+        struct OpenTarget {
+            const Target* target;
+            replicant::FileSink sink;
+        };
 
-            for (const auto* file : files) {
+        std::vector<OpenTarget> active;
+        size_t next_target = 0;
+        uint64_t position = 0;
 
-                std::filesystem::path out_path = out_base / file->name;
+        auto route = [&](std::span<const std::byte> chunk) -> std::expected<void, replicant::Error> {
+            uint64_t chunk_end = position + chunk.size();
 
-                arc_stream.seekg(file->rawOffset);
-                if (!arc_stream) throw std::runtime_error("Seek failed for " + file->name);
+            while (next_target < targets.size() && targets[next_target].begin < chunk_end) {
+                const Target& target = targets[next_target++];
+                uint64_t expected_size = target.end != unknown_end ? target.end - target.begin : 0;
 
-                if (compressed_buf.size() < file->size) {
-                    compressed_buf.resize(file->size);
-                }
+                auto sink = replicant::FileSink::Create(out_base / target.file->name, expected_size, &directories);
+                if (!sink) return std::unexpected(replicant::Error{ replicant::ErrorCode::IoError, sink.error().message });
+                active.push_back({ &target, std::move(*sink) });
+            }
 
-                if (!arc_stream.read(reinterpret_cast<char*>(compressed_buf.data()), file->size)) {
-                    throw std::runtime_error("Read failed for " + file->name);
-                }
+            for (auto& open : active) {
+                uint64_t from = std::max(position, open.target->begin);
+                uint64_t to = std::min(chunk_end, open.target->end);
+                if (from >= to) continue;
 
-                std::span<const std::byte> chunk_span(compressed_buf.data(), file->size);
+                auto written = open.sink.write(chunk.subspan(static_cast<size_t>(from - position), static_cast<size_t>(to - from)));
+                if (!written) return std::unexpected(replicant::Error{ replicant::ErrorCode::IoError, written.error().message });
+            }
+
+            position = chunk_end;
 
-                size_t dSize = 0;
-                if (auto sz = replicant::archive::GetDecompressedSize(chunk_span)) dSize = *sz;
+            for (size_t i = 0; i < active.size();) {
+                if (active[i].target->end <= position) {
+                    auto closed = active[i].sink.close();
+                    if (!closed) return std::unexpected(replicant::Error{ replicant::ErrorCode::IoError, closed.error().message });
+                    active.erase(active.begin() + i);
+                }
+                else {
+                    ++i;
+                }
+            }
+            return {};
+        };
 
-                auto decompressed = unwrap(replicant::archive::Decompress(chunk_span, dSize), "Decompress failed " + file->name);
+        unwrap(replicant::archive::DecompressToSink(arc_data, route), "Decompress failed " + arc_meta.filename);
 
-                unwrap(replicant::WriteFile(out_path, decompressed), "Write failed " + file->name);
+        // Whatever is still open ran to the end of a stream of unknown size
+        for (auto& open : active) {
+            if (open.target->end != unknown_end) {
+                throw std::runtime_error("File " + open.target->file->name + " out of bounds in " + arc_meta.filename);
             }
+            unwrap(open.sink.close(), "Write failed " + open.target->file->name);
         }
 
-        {
-            std::lock_guard<std::mutex> lock(console_mutex);
-            std::cout << "Finished " << arc_meta.filename << ".\n";
+        // Empty files sitting exactly at the end of the stream never see a chunk
+        for (; next_target < targets.size(); ++next_target) {
+            const Target& target = targets[next_target];
+            if (target.begin != position || (target.end != target.begin && target.end != unknown_end)) {
+                throw std::runtime_error("File " + target.file->name + " out of bounds in " + arc_meta.filename);
+            }
+            auto sink = unwrap(replicant::FileSink::Create(out_base / target.file->name, 0, &directories), "Write failed " + target.file->name);
+            unwrap(sink.close(), "Write failed " + target.file->name);
         }
     }
-};
\ No newline at end of file
+};
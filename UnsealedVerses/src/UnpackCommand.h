@@ -15,21 +15,25 @@ public:
 
         std::filesystem::create_directories(output_folder_path);
 
-        auto pack_data = unwrap(replicant::ReadFile(input_path), "Failed to read PACK file");
+        auto pack_data = unwrap(replicant::MappedFile::Open(input_path), "Failed to read PACK file");
 
-        auto pack = unwrap(replicant::Pack::Deserialize(pack_data), "Failed to parse PACK file");
+        auto pack = unwrap(replicant::PackView::Deserialize(pack_data.data()), "Failed to parse PACK file");
 
+        std::vector<std::byte> file_content;
         for (const auto& entry : pack.files) {
-            std::filesystem::path out_path = output_folder_path / entry.name;
+            const std::string entry_name(entry.name);
+            std::filesystem::path out_path = output_folder_path / entry_name;
             std::filesystem::create_directories(out_path.parent_path());
 
-            std::vector<std::byte> file_content = entry.serializedData;
+            std::span<const std::byte> out_data = entry.serializedData;
             if (entry.hasResource()) {
+                file_content.assign(entry.serializedData.begin(), entry.serializedData.end());
                 file_content.insert(file_content.end(), entry.resourceData.begin(), entry.resourceData.end());
+                out_data = file_content;
             }
 
-            unwrap(replicant::WriteFile(out_path, file_content), "Failed to write output file " + entry.name);
-            std::cout << "Extracted: " << entry.name << "\n";
+            unwrap(replicant::WriteFile(out_path, out_data), "Failed to write output file " + entry_name);
+            std::cout << "Extracted: " << entry_name << "\n";
         }
 
         return 0;
@@ -17,9 +17,9 @@ public:
 
         std::filesystem::create_directories(output_folder_path);
 
-        auto kpk_data = unwrap(replicant::ReadFile(input_path), "Failed to read KPK file");
+        auto kpk_data = unwrap(replicant::MappedFile::Open(input_path), "Failed to read KPK file");
 
-        auto kpk = unwrap(replicant::KpkFile::Deserialize(kpk_data), "Failed to parse KPK file");
+        auto kpk = unwrap(replicant::KpkFile::Deserialize(kpk_data.data()), "Failed to parse KPK file");
 
         for (const auto& entry : kpk.entries) {
             std::filesystem::path out_path = output_folder_path / entry.name;
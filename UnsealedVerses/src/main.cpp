@@ -4,10 +4,14 @@
 
 #include "Common.h"
 #include "FindEntryCommand.h"
+#include "IndexBuildCommand.h"
+#include "TextureHashIndexCommand.h"
 #include "UnpackCommand.h"
 #include "TexturePatchCommand.h"
 #include "ArchiveCommand.h"
 #include "UnarchiveCommand.h"
+#include "TraceCommand.h"
+#include "ExtractCommand.h"
 #include "TextureConvertCommand.h"
 #include "CreateWeaponAsset.h"
 #include "UnpackKPKCommand.h"
@@ -24,14 +28,44 @@ void printUsage() {
     std::cout << "      --index <path>      Generate a new compressed index file (e.g., info.arc).\n";
     std::cout << "      --patch <path>      Patch an existing compressed index file.\n";
     std::cout << "      --out <path>        Output path for the patched index. Overwrites original if not set.\n";
-    std::cout << "      --load-type <0|1|2> Set load type (0: Preload, 1: Stream, 2: StreamOnDemand).\n\n";
+    std::cout << "      --load-type <0|1|2> Set load type (0: Preload, 1: Stream, 2: StreamOnDemand).\n";
+    std::cout << "      --jobs <n>          Compression threads (default: one per CPU thread).\n";
+    std::cout << "      --cache             Keep <output.arc>.cache and only recompress changed files on rebuild\n";
+    std::cout << "                          (stream archives only).\n";
+    std::cout << "      --dedupe            Share one frame between identical files (stream archives only). Reads and\n";
+    std::cout << "                          hashes every file before compressing, so it costs an extra pass over the input.\n";
+    std::cout << "      --max-memory <size> Cap memory held by compressed files waiting to be written, e.g. 512M or 2G\n";
+    std::cout << "                          (stream archives only, files of 32 MiB and up are streamed regardless).\n";
+    std::cout << "      --layout-trace <path>\n";
+    std::cout << "                          Order files by an access trace so files loaded together are stored together\n";
+    std::cout << "                          (stream archives only). A trace.bin recorded by the loader, or one \"<phase> <name>\"\n";
+    std::cout << "                          or \"<name>\" per line, in load order. Texture and table names are mapped to the\n";
+    std::cout << "                          PACK files in assets_path containing them; archive (.arc) accesses are ignored.\n";
+    std::cout << "      --append            Append new and changed files to the existing <output.arc> and patch their\n";
+    std::cout << "                          entries in the --patch index (stream archives only). Replaced frames are\n";
+    std::cout << "                          tracked in <output.arc>.dead.\n";
+    std::cout << "      --compact           Drop frames the --patch index no longer references from <output.arc>. Takes no\n";
+    std::cout << "                          assets_path unless combined with --append.\n";
+    std::cout << "      --compact-threshold <percent>\n";
+    std::cout << "                          With --append, compact once dead frames reach this share of the archive (default: 25).\n\n";
     std::cout << "  unarchive <info.arc> <output_folder> [options]\n";
     std::cout << "    Extracts all files from archives referenced by the given index\n";
     std::cout << "    Options:\n";
-    std::cout << "      --chara-only      Extract only the chara folder (character models and weapons) (saves ~20GB)\n\n";
-    std::cout << "  texture-convert <input> <output>\n";
+    std::cout << "      --chara-only      Extract only the chara folder (character models and weapons) (saves ~20GB)\n";
+    std::cout << "      --jobs <n>        Number of extraction threads (default: one per CPU thread).\n\n";
+    std::cout << "  extract <info.arc> <name...> [options]\n";
+    std::cout << "    Extracts individual files by name without unarchiving everything.\n";
+    std::cout << "    Only the frames of the requested files are decompressed (whole stream for preload archives).\n";
+    std::cout << "    Options:\n";
+    std::cout << "      --out <path>      Output folder, file names keep their directories (default: current folder).\n\n";
+    std::cout << "  texture-convert <input> <output> [options]\n";
     std::cout << "    Converts a standalone texture between .dds and .rtex\n";
-    std::cout << "    Note that here an rtex texture file is considered a header and pixel data concatenated\n\n";
+    std::cout << "    Note that here an rtex texture file is considered a header and pixel data concatenated\n";
+    std::cout << "    <input> may also be a folder or a glob (e.g. \"dump/**/*.rtex\"), <output> is then a folder that\n";
+    std::cout << "    mirrors the input layout. Outputs newer than their input are skipped.\n";
+    std::cout << "    Options:\n";
+    std::cout << "      --jobs <n>        Number of textures converted in parallel (default: one per CPU thread).\n";
+    std::cout << "      --force           Convert every texture, even if its output is up to date.\n\n";
     std::cout << "  unpack <input.xap> <output_folder>\n";
     std::cout << "    Extracts all files from a PACK file (.xap) into a specified folder.\n";
     std::cout << "    Note that this will append the resource data immediately after the serialised data\n\n";
@@ -39,8 +73,29 @@ void printUsage() {
     std::cout << "    Patches textures in a PACK file (.xap) using dds textures from a folder.\n";
     std::cout << "    The new files should have the same name as the ones being replcaed,\n";
     std::cout << "    just with a dds file extension instead of an rtex.\n\n";
-    std::cout << "  find-entry <search_folder> <entry_name>\n";
-    std::cout << "    Recursively searches a directory for PACK files containing an entry with the given name.\n\n";
+    std::cout << "  find-entry <search_folder> <entry_name> [options]\n";
+    std::cout << "    Recursively searches a directory for PACK files containing an entry with the given name.\n";
+    std::cout << "    Options:\n";
+    std::cout << "      --jobs <n>        Number of files probed in parallel (default: one per CPU thread).\n";
+    std::cout << "      --index <path>    Answer from an asset index, refreshing changed files first.\n";
+    std::cout << "                        Used automatically if the folder contains one from index-build.\n";
+    std::cout << "      --no-refresh      Trust the index as is without checking the folder for changes.\n";
+    std::cout << "      --importers       Find PACK files that import the given path instead.\n\n";
+    std::cout << "  index-build <data_folder> [options]\n";
+    std::cout << "    Builds or updates an index of every PACK entry and import under a folder for find-entry.\n";
+    std::cout << "    Only files whose size or modification time changed since the last run are read again.\n";
+    std::cout << "    Options:\n";
+    std::cout << "      --index <path>    Index file to write (default: <data_folder>/asset_index.ltidx).\n";
+    std::cout << "      --jobs <n>        Number of files probed in parallel (default: one per CPU thread).\n\n";
+    std::cout << "  texture-hash-index <data_folder> [options]\n";
+    std::cout << "    Builds or updates a table of the SpecialK CRC32C hash of every rtex in the PACK files under a folder,\n";
+    std::cout << "    telling which game textures a hash named .dds replaces. Placed in the LunarTear folder, it lets the\n";
+    std::cout << "    loader resolve hash named mod textures at startup instead of hashing textures while the game loads.\n";
+    std::cout << "    Only files whose size or modification time changed since the last run are read again.\n";
+    std::cout << "    Options:\n";
+    std::cout << "      --index <path>    Index file to write (default: <data_folder>/texture_hashes.ltth).\n";
+    std::cout << "      --jobs <n>        Number of files hashed in parallel (default: one per CPU thread).\n";
+    std::cout << "      --lookup <hash>   Print the textures with this hash, e.g. 0123ABCD or 0123ABCD.dds. Repeatable.\n\n";
     std::cout << "  create-weapon-asset <assets_local_mesh_path> <output_weapon_asset>\n";
     std::cout << "    Creates a weapon asset. The game will search for this to find the mesh for a weapon\n";
     std::cout << "    output_weapon_asset can be whatever you want but the last letter should be the level\n";
@@ -48,6 +103,10 @@ void printUsage() {
     std::cout << "    assets_local_mesh_path should be local to game vfs.\n";
     std::cout << "    Your mesh can be wherever you want, i reccomend something like 'chara/weapon/[modname]/[weaponName]'.\n";
     std::cout << "    You will need ones of these weapon assets for every level, however they can all point to the same mesh.\n\n";
+    std::cout << "  trace <trace.bin> [options]\n";
+    std::cout << "    Summarises a file access trace recorded by the loader (TraceFileAccess in LunarTear.ini).\n";
+    std::cout << "    Options:\n";
+    std::cout << "      --load-order <path> Write the first load of every file per phase as text for archive --layout-trace.\n\n";
     std::cout << "  unpack-kpk <input> <output_folder>\n";
     std::cout << "    Extracts all files from a KPK file into a specified folder.\n\n";
     std::cout << "\n";
@@ -70,6 +129,9 @@ int main(int argc, char* argv[]) {
     else if (command_name == "unarchive") {
         command = std::make_unique<UnarchiveCommand>(command_args);
     }
+    else if (command_name == "extract") {
+        command = std::make_unique<ExtractCommand>(command_args);
+    }
     else if (command_name == "texture-convert") {
         command = std::make_unique<TextureConvertCommand>(command_args);
     }
@@ -79,12 +141,21 @@ int main(int argc, char* argv[]) {
     else if (command_name == "find-entry") {
         command = std::make_unique<FindEntryCommand>(command_args);
     }
+    else if (command_name == "index-build") {
+        command = std::make_unique<IndexBuildCommand>(command_args);
+    }
+    else if (command_name == "texture-hash-index") {
+        command = std::make_unique<TextureHashIndexCommand>(command_args);
+    }
     else if (command_name == "unpack") {
         command = std::make_unique<UnpackCommand>(command_args);
     }
     else if (command_name == "create-weapon-asset") {
         command = std::make_unique<CreateWeaponAsset>(command_args);
     }
+    else if (command_name == "trace") {
+        command = std::make_unique<TraceCommand>(command_args);
+    }
     else if (command_name == "unpack-kpk") {
         command = std::make_unique<UnpackKPKCommand>(command_args);
     }
@@ -0,0 +1,122 @@
+#pragma once
+#include "replicant/core/common.h"
+#include "replicant/arc.h"
+#include "replicant/assetIndex.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <unordered_map>
+#include <array>
+#include <span>
+
+namespace replicant::archive {
+
+    // What was requested. Text traces only name files
+    enum class TraceEvent : uint8_t {
+        File = 0,
+        Archive = 1,    // An archive or index the game decompressed
+        Texture = 2,
+        Table = 3,
+    };
+    inline constexpr size_t TRACE_EVENT_COUNT = 4;
+
+    struct TraceAccess {
+        std::string name;   // VFS name, '/' separated, as archive inputs are named
+        uint32_t phase = 0; // Index into AccessTrace::phases
+        TraceEvent event = TraceEvent::File;
+        uint64_t time = 0;  // Nanoseconds since recording started, 0 in text traces
+    };
+
+    // The order the game requested files in, grouped into phases (a level load, a menu, ...), used to lay out
+    // SeparateFrames archives so files loaded together are read sequentially.
+    // Text form, one access per line in the order they happened: `<phase> <name>`, or just `<name>` for the
+    // unnamed phase. A phase can be any label without whitespace, a timestamp works too. Blank lines and lines
+    // starting with '#' are skipped.
+    // Binary form, as the loader records it (see TraceEncoder): a header followed by records, where a phase
+    // record sets the phase of every event record after it
+    class AccessTrace {
+    public:
+        std::vector<std::string> phases;        // Labels, in order of first appearance
+        std::vector<TraceAccess> accesses;      // In the order they happened
+
+        static std::expected<AccessTrace, Error> ParseText(std::string_view text);
+
+        // Accesses come out in time order. A recording cut off mid-record (the game was killed) is read up to the
+        // last complete record
+        static std::expected<AccessTrace, Error> Deserialize(std::span<const std::byte> data);
+
+        // Either form, told apart by the binary header
+        static std::expected<AccessTrace, Error> Load(const std::filesystem::path& path);
+
+        void add(std::string_view phase, std::string_view name, TraceEvent event = TraceEvent::File, uint64_t time = 0);
+
+    private:
+        std::unordered_map<std::string, uint32_t> phaseIndex_;
+    };
+
+    // Writes the binary trace form incrementally, so a recorder can flush it in chunks as events come in
+    class TraceEncoder {
+    public:
+        static std::vector<std::byte> Header();
+
+        // Appends an event record to out, preceded by a phase record if phase differs from the previous event's
+        void encode(std::vector<std::byte>& out, TraceEvent event, uint64_t time, std::string_view phase, std::string_view name);
+
+    private:
+        std::string phase_;
+    };
+
+    struct TraceSummary {
+        struct Phase {
+            std::string label;
+            size_t accesses = 0;
+            size_t distinct = 0;    // Different names requested in the phase
+            uint64_t firstTime = 0;
+            uint64_t lastTime = 0;
+        };
+
+        size_t accesses = 0;
+        size_t distinct = 0;
+        uint64_t duration = 0;      // Time of the last access
+        std::array<size_t, TRACE_EVENT_COUNT> byEvent{};
+        std::vector<Phase> phases;  // Same order as AccessTrace::phases
+    };
+
+    TraceSummary Summarize(const AccessTrace& trace);
+
+    // The first request of every name in each phase, in order, as text ParseText reads back. Whitespace in phase
+    // labels becomes '_'
+    std::string ToLoadOrder(const AccessTrace& trace);
+
+    struct PackMapStats {
+        size_t mapped = 0;      // Accesses rewritten as accesses of the packs containing them
+        size_t kept = 0;        // Accesses no pack has an entry for, left as they are
+        size_t dropped = 0;     // Archive accesses
+    };
+
+    // The loader records what the game asks for: whole .arc containers, and textures and tables by the name of their
+    // entry inside a PACK, none of which name a file stored in a stream archive. This rewrites every access whose name
+    // is an entry of a pack in one of indices (one per archive input folder, so pack paths are named as the inputs
+    // built from that folder) as an access of each such pack in path order, dropping repeats of the same pack within
+    // a phase that follow each other. Archive accesses are dropped. Anything else, hand-written input names included, is kept
+    PackMapStats MapToPacks(AccessTrace& trace, std::span<const AssetIndex> indices);
+
+    struct LayoutStats {
+        size_t traced = 0;      // Inputs the trace requests
+        size_t shared = 0;      // Of those, inputs requested in more than one phase
+        size_t untraced = 0;
+    };
+
+    // Reorders inputs for a SeparateFrames build: phase by phase in order of first use, each phase starting with the
+    // inputs it shares with later phases (clustered by the set of phases using them), then its own, each group in
+    // order of first access. Untraced inputs follow in their original order
+    LayoutStats OrderByTrace(std::vector<ArchiveInput>& inputs, const AccessTrace& trace);
+
+    // Replays the trace over frames stored back to back, sector aligned, in the order given, and sums the distance
+    // between the end of each frame read and the start of the next. Names not in frames are skipped. An estimate of
+    // how far a disk head travels, independent of where the frames actually sit
+    uint64_t EstimateSeekDistance(const std::vector<ArchiveEntryInfo>& frames, const AccessTrace& trace);
+}
@@ -7,12 +7,19 @@
 #include <filesystem>
 #include <span>
 #include <expected>
+#include <functional>
+#include <optional>
+
+namespace replicant {
+    class TpArchiveFileParam;
+}
 
 namespace replicant::archive {
 
     struct CompressionConfig {
         int level = 1;
         int windowLog = 15; // Game will crash if any higher
+        unsigned jobs = 1;  // Build worker threads, 0 for one per hardware thread. Output does not depend on it
     };
 
     enum class BuildMode {
@@ -39,6 +46,45 @@ namespace replicant::archive {
 
     struct ArchiveResult {
         std::vector<ArchiveEntryInfo> entries;
+        size_t reusedFrames = 0; // Frames copied from the previous build instead of recompressed
+        size_t dedupedEntries = 0; // Entries sharing an earlier entry's frame
+        uint64_t dedupedBytes = 0; // Archive bytes (aligned frames) not written thanks to that
+    };
+
+    struct BuildOptions {
+        // SeparateFrames only. Records every input's size, mtime and content hash next to its frame (see BuildCache).
+        // On the next build, inputs with the same size and mtime, or the same size and content, copy their frame
+        // from the previous archive instead of being recompressed. The archive is written beside the output and
+        // renamed over it, so the previous one stays readable throughout
+        std::optional<std::filesystem::path> cachePath;
+
+        // SeparateFrames only. Inputs with identical content (same hash64 and size, confirmed byte for byte) get one
+        // frame, and their entries share its offset
+        bool deduplicate = false;
+
+        // SeparateFrames only. Caps the bytes held by compressed frames waiting to be written, 0 for no cap beyond
+        // the two frames per job window. Inputs of 32 MiB and up never count against it: the writing thread streams
+        // them into the archive from a mapping instead, compressing them or copying their reused frame
+        uint64_t maxMemory = 0;
+    };
+
+    struct AppendOptions {
+        // Build cache of the archive, see BuildOptions::cachePath. Inputs it shows as unchanged keep their frame;
+        // without a valid cache every input is appended. Rewritten for the grown archive either way
+        std::optional<std::filesystem::path> cachePath;
+
+        uint64_t maxMemory = 0; // See BuildOptions::maxMemory
+    };
+
+    struct CompactResult {
+        size_t frames = 0;          // Frames kept
+        uint64_t reclaimedBytes = 0;
+
+        std::filesystem::path archivePath;
+        std::filesystem::path compactedPath;    // The rewritten archive, <archivePath>.tmp until CommitCompact
+        std::optional<std::filesystem::path> cachePath; // Build cache that was valid for the archive, if any
+        bool cacheRemapped = false;     // Its remapped version is waiting at <cachePath>.tmp
+        bool cacheDropped = false;      // Set by CommitCompact if the cache could not be moved along and was deleted
     };
 
     std::expected<std::vector<std::byte>, Error> Compress(
@@ -51,6 +97,24 @@ namespace replicant::archive {
         size_t decompressedSize = 0
     );
 
+    // Decompresses into a caller-owned buffer, which must be large enough for the whole content (see
+    // GetDecompressedSize). Returns the number of bytes written. Uses a per-thread context, so repeated calls do not allocate
+    std::expected<size_t, Error> DecompressInto(
+        std::span<const std::byte> compressedData,
+        std::span<std::byte> output
+    );
+
+    // Receives decompressed data in order, in chunks of at most DECOMPRESS_CHUNK_SIZE. Returning an error stops decompression
+    using DecompressSink = std::function<std::expected<void, Error>(std::span<const std::byte>)>;
+    inline constexpr size_t DECOMPRESS_CHUNK_SIZE = 1024 * 1024;
+
+    // Streams the decompressed content to sink without ever holding more than one chunk, whatever the content size.
+    // Handles concatenated frames. Returns the total number of bytes produced
+    std::expected<uint64_t, Error> DecompressToSink(
+        std::span<const std::byte> compressedData,
+        const DecompressSink& sink
+    );
+
     std::expected<size_t, Error> GetDecompressedSize(
         std::span<const std::byte> compressedData
     );
@@ -60,7 +124,38 @@ namespace replicant::archive {
         const std::filesystem::path& outputPath,
         const std::vector<ArchiveInput>& inputs,
         BuildMode mode,
-        CompressionConfig config = {}
+        CompressionConfig config = {},
+        const BuildOptions& options = {}
     );
-    
+
+    // SeparateFrames only. Compresses the new and changed inputs and appends their frames, sector aligned, to the end
+    // of an existing archive, leaving every frame already in it where it is. Returns an entry for every input, kept
+    // frames included (counted in reusedFrames), ready for registerArchive. Frames of replaced inputs stay behind as
+    // dead space until Compact. On failure the archive is truncated back to its original size
+    std::expected<ArchiveResult, Error> Append(
+        const std::filesystem::path& archivePath,
+        const std::vector<ArchiveInput>& inputs,
+        CompressionConfig config = {},
+        const AppendOptions& options = {}
+    );
+
+    // Writes a SeparateFrames archive with only the frames the entries of archiveIndex reference, in offset order,
+    // to <archivePath>.tmp and moves those entries to their offsets in it. Nothing on disk is replaced: the caller
+    // writes the index out, then calls CommitCompact, or DiscardCompact to back out. A build cache at cachePath
+    // that is valid for the archive is remapped to <cachePath>.tmp alongside
+    std::expected<CompactResult, Error> Compact(
+        const std::filesystem::path& archivePath,
+        TpArchiveFileParam& index,
+        uint8_t archiveIndex,
+        const std::optional<std::filesystem::path>& cachePath = std::nullopt
+    );
+
+    // Renames the compacted archive over the original, then the remapped build cache over the old one. Fails, with
+    // the compacted files removed and nothing replaced, only if the archive cannot be renamed. Past that point
+    // nothing fails: a cache that cannot be moved along is deleted and cacheDropped set
+    std::expected<void, Error> CommitCompact(CompactResult& compacted);
+
+    // Removes the files a Compact left waiting for CommitCompact
+    void DiscardCompact(const CompactResult& compacted);
+
 }
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+#include "replicant/core/common.h"
+#include "replicant/core/io.h"
+#include "replicant/tpArchiveFileParam.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <span>
+#include <filesystem>
+
+namespace replicant {
+
+    // Random access to the files referenced by an info.arc, without unarchiving everything.
+    // STREAM archives are mapped on first use and only the requested frame is decompressed. A PRELOAD archive is a
+    // single zstd stream, so it is decompressed once on first use and kept for later reads.
+    // Not thread-safe, use one reader per thread
+    class ArcReader {
+    public:
+        // Archives are looked up next to the index file
+        static std::expected<ArcReader, Error> Open(const std::filesystem::path& indexPath);
+
+        ArcReader(ArcReader&&) noexcept = default;
+        ArcReader& operator=(ArcReader&&) noexcept = default;
+
+        const TpArchiveFileParam& params() const { return params_; }
+        const FileEntry* find(const std::string& name) { return params_.findFile(name); }
+
+        // The returned data stays valid for the reader's lifetime for PRELOAD files, and until the next read for
+        // STREAM files
+        std::expected<std::span<const std::byte>, Error> read(const FileEntry& entry);
+        std::expected<std::span<const std::byte>, Error> read(const std::string& name);
+
+        std::expected<void, Error> extractTo(const FileEntry& entry, const std::filesystem::path& outPath);
+
+    private:
+        struct ArchiveState {
+            std::optional<MappedFile> file;
+
+            // PRELOAD only
+            std::vector<std::byte> blob;
+            std::vector<uint64_t> sortedOffsets;
+            bool decompressed = false;
+        };
+
+        ArcReader() = default;
+
+        std::expected<ArchiveState*, Error> archive(uint8_t archiveIndex, bool preload);
+
+        std::filesystem::path archiveDir_;
+        TpArchiveFileParam params_;
+        std::vector<ArchiveState> archives_;
+        std::vector<std::byte> scratch_;
+    };
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include "replicant/core/common.h"
+#include "replicant/pack.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <expected>
+#include <span>
+#include <filesystem>
+
+namespace replicant {
+
+    struct AssetIndexEntry {
+        uint32_t nameHash = 0;
+        std::string name;
+        uint32_t serializedSize = 0;
+        uint32_t resourceSize = 0;
+    };
+
+    struct AssetIndexPack {
+        std::string path;       // Relative to the indexed root, '/' separated
+        int64_t mtime = 0;      // Raw last_write_time ticks, only compared for equality
+        uint64_t fileSize = 0;
+        bool isPack = false;    // Non-PACK files are kept so they are not re-probed on every update
+
+        std::vector<AssetIndexEntry> entries;
+        std::vector<ImportEntry> imports;
+    };
+
+    struct AssetIndexUpdateStats {
+        size_t reused = 0;
+        size_t scanned = 0;
+        size_t removed = 0;
+    };
+
+    // Persistent index of every PACK in an extracted data tree: entry names, hashes, sizes and imports.
+    // Each pack is stamped with its size and mtime, so Update only re-probes files that changed.
+    // The serialized form keeps packs sorted by path and hash -> pack tables sorted by hash for lookups.
+    class AssetIndex {
+    public:
+        static constexpr const char* DefaultFileName = "asset_index.ltidx";
+
+        std::vector<AssetIndexPack> packs;
+
+        static std::expected<AssetIndex, Error> Deserialize(std::span<const std::byte> data);
+        std::expected<std::vector<std::byte>, Error> Serialize() const;
+
+        // Walks root and brings the index in line with it. Unchanged files are reused, new or changed ones are
+        // probed in parallel (see Pack::Probe) and missing ones dropped. Index files themselves are skipped
+        std::expected<AssetIndexUpdateStats, Error> Update(const std::filesystem::path& root, unsigned jobs = 0);
+
+        // Packs containing a file entry with this name
+        std::vector<const AssetIndexPack*> findEntry(std::string_view name) const;
+
+        // Packs that import this path
+        std::vector<const AssetIndexPack*> findImporters(std::string_view path) const;
+
+    private:
+        struct Lookup {
+            uint32_t hash;
+            uint32_t packIndex;
+        };
+
+        static AssetIndex DeserializeInternal(std::span<const std::byte> data);
+        void buildLookups();
+        std::vector<std::byte> SerializeInternal() const;
+
+        std::vector<Lookup> entryLookup_;
+        std::vector<Lookup> importLookup_;
+    };
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "replicant/core/common.h"
+#include "replicant/core/lookup.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <expected>
+#include <span>
+
+namespace replicant::archive {
+
+    struct BuildCacheEntry {
+        std::string name;
+
+        // Input stamp and content hash (hash64) when the frame was compressed
+        uint64_t fileSize = 0;
+        int64_t mtime = 0;
+        uint64_t contentHash = 0;
+
+        // Where the compressed frame sits in the archive the cache was written for
+        uint64_t offset = 0;
+        uint32_t compressedSize = 0;
+        uint32_t packSerializedSize = 0;
+        uint32_t packResourceSize = 0;
+    };
+
+    // Sidecar of a SeparateFrames archive recording which input produced each frame, see BuildOptions::cachePath.
+    // Only valid for the archive whose size and mtime it records, and for the same compression settings
+    class BuildCache {
+    public:
+        int level = 0;
+        int windowLog = 0;
+        uint64_t archiveSize = 0;
+        int64_t archiveMtime = 0;
+        std::vector<BuildCacheEntry> entries;
+
+        static std::expected<BuildCache, Error> Deserialize(std::span<const std::byte> data);
+        std::expected<std::vector<std::byte>, Error> Serialize() const;
+
+        // Indexes entries by name. find() stays correct without it but scans linearly
+        void buildLookupIndex();
+        const BuildCacheEntry* find(const std::string& name) const;
+
+    private:
+        std::vector<std::byte> SerializeInternal() const;
+
+        LookupIndex index_;
+    };
+}
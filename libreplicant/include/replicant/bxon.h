@@ -2,7 +2,7 @@
 #include "replicant/core/common.h"
 #include <string>
 #include <vector>
-#include <span >
+#include <span>
 #include <cstdint>
 #include <expected>
 
@@ -23,5 +23,13 @@ namespace replicant {
             uint32_t projectId,
             std::span<const std::byte> payload
         );
+
+    // Same, with the payload given in parts that are written back to back, so callers need not concatenate them first
+    std::expected<std::vector<std::byte>, Error> BuildBxon(
+            const std::string& assetType,
+            uint32_t version,
+            uint32_t projectId,
+            std::span<const std::span<const std::byte>> payloadParts
+        );
     
 }
\ No newline at end of file
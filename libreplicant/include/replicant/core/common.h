@@ -1,6 +1,11 @@
 #pragma once
 #include <string>
 #include <format>
+#include <span>
+#include <bit>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
 
 namespace replicant {
 
@@ -13,6 +18,58 @@ namespace replicant {
         return hash;
     }
 
+    // Fast non-cryptographic 64-bit content hash, for change detection and duplicate detection. Reads 8-byte words
+    // in native order, so values are only comparable between little-endian machines
+    inline uint64_t hash64(std::span<const std::byte> data, uint64_t seed = 0) {
+        constexpr uint64_t k0 = 0x9E3779B97F4A7C15ull;
+        constexpr uint64_t k1 = 0xC2B2AE3D27D4EB4Full;
+        constexpr uint64_t k2 = 0x165667B19E3779F9ull;
+
+        auto load = [](const std::byte* p) {
+            uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        };
+        auto round = [&](uint64_t acc, uint64_t word) {
+            return std::rotl(acc + word * k1, 31) * k0;
+        };
+
+        const std::byte* p = data.data();
+        size_t remaining = data.size();
+
+        // Four independent lanes so the multiplies overlap
+        uint64_t a = seed + k0 + k1, b = seed + k1, c = seed, d = seed - k0;
+        while (remaining >= 32) {
+            a = round(a, load(p));
+            b = round(b, load(p + 8));
+            c = round(c, load(p + 16));
+            d = round(d, load(p + 24));
+            p += 32;
+            remaining -= 32;
+        }
+
+        uint64_t h = std::rotl(a, 1) + std::rotl(b, 7) + std::rotl(c, 12) + std::rotl(d, 18);
+        h += static_cast<uint64_t>(data.size()) * k2;
+
+        while (remaining >= 8) {
+            h = std::rotl(h ^ round(0, load(p)), 27) * k0 + k2;
+            p += 8;
+            remaining -= 8;
+        }
+        while (remaining > 0) {
+            h = std::rotl(h ^ (static_cast<uint64_t>(*p) * k2), 11) * k0;
+            ++p;
+            --remaining;
+        }
+
+        h ^= h >> 33;
+        h *= k1;
+        h ^= h >> 29;
+        h *= k2;
+        h ^= h >> 32;
+        return h;
+    }
+
     enum class ErrorCode {
         IoError,
         ParseError,
@@ -0,0 +1,18 @@
+#pragma once
+#include <span>
+#include <cstdint>
+#include <cstddef>
+
+namespace replicant {
+
+    // CRC-32C (Castagnoli), bit for bit the same as crc32c::Crc32c / crc32c::Extend, which the loader and SpecialK
+    // name textures by. Pass a previous result as crc to continue it over more data. Uses the SSE 4.2 CRC32
+    // instruction when the CPU has it and a table driven version otherwise
+    uint32_t crc32c(std::span<const std::byte> data, uint32_t crc = 0);
+
+    // The table driven version on its own, whatever the CPU supports, so both paths can be checked against each other
+    uint32_t crc32cSoftware(std::span<const std::byte> data, uint32_t crc = 0);
+
+    // Whether crc32c runs on the hardware instruction on this machine
+    bool crc32cAccelerated();
+}
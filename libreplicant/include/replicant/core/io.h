@@ -7,6 +7,9 @@
 #include <expected>
 #include <string>
 #include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_set>
 
 namespace replicant {
 
@@ -26,6 +29,24 @@ namespace replicant {
         std::string message;
     };
 
+    // Size and last write time of a file, for cheap change detection. mtime is in raw filesystem clock ticks, only
+    // meaningful for equality. Both are zero if the file cannot be stat'ed
+    struct FileStamp {
+        uint64_t size = 0;
+        int64_t mtime = 0;
+
+        bool operator==(const FileStamp&) const = default;
+    };
+
+    inline FileStamp StampOf(const std::filesystem::path& path) {
+        std::error_code ec;
+        FileStamp stamp;
+        stamp.size = static_cast<uint64_t>(std::filesystem::file_size(path, ec));
+        if (ec) return {};
+        stamp.mtime = static_cast<int64_t>(std::filesystem::last_write_time(path, ec).time_since_epoch().count());
+        return stamp;
+    }
+
     inline std::expected<std::vector<std::byte>, IOError> ReadFile(const std::filesystem::path& path)
     {
         std::error_code ec;
@@ -117,5 +138,88 @@ namespace replicant {
         return {};
     }
 
+    // Read-only view of a whole file. The file is memory mapped where possible so large PACKs and archives are
+    // paged in on demand instead of copied up front. If mapping fails the contents are read into an owned buffer,
+    // so callers always get a contiguous span. The span is only valid for the lifetime of the MappedFile.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
 
-}
\ No newline at end of file
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        static std::expected<MappedFile, IOError> Open(const std::filesystem::path& path);
+
+        std::span<const std::byte> data() const { return data_; }
+        size_t size() const { return data_.size(); }
+        bool empty() const { return data_.empty(); }
+
+        // False if the contents came from the buffered fallback
+        bool isMapped() const { return view_ != nullptr; }
+
+        // Asks the OS to start reading [offset, offset + size) into memory ahead of use. A hint only, no-op when buffered
+        void prefetch(size_t offset, size_t size) const;
+
+    private:
+        void release();
+
+        std::span<const std::byte> data_;
+        void* view_ = nullptr;
+        std::vector<std::byte> buffer_;
+    };
+
+    // Remembers which directories already exist so extracting many files into the same folders does not hit the
+    // filesystem for every file. Thread-safe, one cache can be shared by concurrent extractions
+    class DirectoryCache {
+    public:
+        std::expected<void, IOError> ensure(const std::filesystem::path& directory);
+
+    private:
+        std::mutex mutex_;
+        std::unordered_set<std::string> known_;
+    };
+
+    // Sequential writer for one output file. The file is preallocated to the expected size so the filesystem can
+    // lay it out in one go, and trimmed on close if fewer bytes were written
+    class FileSink {
+    public:
+        FileSink() = default;
+        ~FileSink();
+
+        FileSink(FileSink&& other) noexcept;
+        FileSink& operator=(FileSink&& other) noexcept;
+
+        FileSink(const FileSink&) = delete;
+        FileSink& operator=(const FileSink&) = delete;
+
+        // Parent directories are created through `directories` if given, otherwise directly
+        static std::expected<FileSink, IOError> Create(const std::filesystem::path& path, uint64_t expectedSize = 0,
+            DirectoryCache* directories = nullptr);
+
+        std::expected<void, IOError> write(std::span<const std::byte> data);
+        std::expected<void, IOError> close();
+
+        uint64_t written() const { return written_; }
+        bool isOpen() const { return handle_ != InvalidHandle; }
+
+    private:
+#ifdef _WIN32
+        using NativeHandle = void*;
+        static inline const NativeHandle InvalidHandle = reinterpret_cast<NativeHandle>(static_cast<intptr_t>(-1));
+#else
+        using NativeHandle = int;
+        static constexpr NativeHandle InvalidHandle = -1;
+#endif
+
+        void release();
+
+        NativeHandle handle_ = InvalidHandle;
+        std::filesystem::path path_;
+        uint64_t written_ = 0;
+        uint64_t preallocated_ = 0;
+    };
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <unordered_map>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+namespace replicant {
+
+    // Hash -> position index over a vector of named entries, used by the findFile/findByHash helpers of the
+    // containers. Candidates are always confirmed against the full name so collisions are harmless.
+    // Entries appended to the vector are picked up by the next sync(). Reordering, erasing or renaming entries
+    // invalidates the index and needs a reset().
+    class LookupIndex {
+        std::unordered_multimap<uint32_t, size_t> map_;
+        size_t indexedCount_ = 0;
+        bool enabled_ = false;
+
+    public:
+        bool enabled() const { return enabled_; }
+        size_t indexedCount() const { return indexedCount_; }
+
+        // Enables the index and discards anything indexed so far. Hashing is deferred to the next sync()
+        void reset() {
+            map_.clear();
+            indexedCount_ = 0;
+            enabled_ = true;
+        }
+
+        void disable() {
+            map_.clear();
+            indexedCount_ = 0;
+            enabled_ = false;
+        }
+
+        template <typename Entries, typename HashOf>
+        void sync(const Entries& entries, HashOf hashOf) {
+            if (!enabled_) return;
+            if (entries.size() < indexedCount_) reset();
+            if (entries.size() == indexedCount_) return;
+
+            map_.reserve(entries.size());
+            for (; indexedCount_ < entries.size(); ++indexedCount_) {
+                map_.emplace(hashOf(entries[indexedCount_]), indexedCount_);
+            }
+        }
+
+        // Lowest position whose entry satisfies matches(). Indexed entries are narrowed down by hash first, anything
+        // not indexed yet (or everything, if the index is disabled) is scanned linearly, so matches() must be
+        // sufficient on its own. Returns entries.size() if nothing matches
+        template <typename Entries, typename Matches>
+        size_t find(const Entries& entries, uint32_t hash, Matches matches) const {
+            size_t indexedEnd = indexedCount_ < entries.size() ? indexedCount_ : entries.size();
+
+            size_t best = entries.size();
+            auto [first, last] = map_.equal_range(hash);
+            for (auto it = first; it != last; ++it) {
+                size_t pos = it->second;
+                if (pos < indexedEnd && pos < best && matches(entries[pos])) best = pos;
+            }
+            if (best != entries.size()) return best;
+
+            for (size_t pos = indexedEnd; pos < entries.size(); ++pos) {
+                if (matches(entries[pos])) return pos;
+            }
+            return entries.size();
+        }
+    };
+}
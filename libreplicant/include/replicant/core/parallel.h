@@ -0,0 +1,147 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace replicant {
+
+    // 0 means one job per hardware thread
+    inline unsigned ResolveJobCount(unsigned jobs) {
+        if (jobs != 0) return jobs;
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // Runs fn(i) for every i in [0, count) on up to `jobs` threads. Indices are handed out one at a time so
+    // uneven items balance out. The first exception thrown by fn is rethrown once all workers have stopped
+    template <typename Fn>
+    void ParallelFor(size_t count, unsigned jobs, Fn&& fn) {
+        size_t workerCount = std::min<size_t>(ResolveJobCount(jobs), count);
+        if (workerCount <= 1) {
+            for (size_t i = 0; i < count; ++i) fn(i);
+            return;
+        }
+
+        std::atomic<size_t> next{ 0 };
+        std::exception_ptr firstError;
+        std::mutex errorMutex;
+
+        auto worker = [&]() {
+            for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                try {
+                    fn(i);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!firstError) firstError = std::current_exception();
+                    next = count;
+                }
+            }
+        };
+
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(workerCount);
+            for (size_t i = 0; i < workerCount; ++i) workers.emplace_back(worker);
+        }
+
+        if (firstError) std::rethrow_exception(firstError);
+    }
+
+    // Like ParallelFor, but every worker starts on its own contiguous slice of [0, count) and walks it in order.
+    // A worker that runs dry steals the upper half of the largest remaining slice. Neighbouring indices therefore
+    // tend to run on the same thread in order, which keeps access to ordered data (e.g. frames sorted by offset)
+    // sequential, while uneven items still balance out
+    template <typename Fn>
+    void ParallelForStealing(size_t count, unsigned jobs, Fn&& fn) {
+        size_t workerCount = std::min<size_t>(ResolveJobCount(jobs), count);
+        if (workerCount <= 1) {
+            for (size_t i = 0; i < count; ++i) fn(i);
+            return;
+        }
+
+        struct Slice {
+            std::mutex mutex;
+            size_t next = 0;
+            size_t end = 0;
+        };
+
+        std::vector<Slice> slices(workerCount);
+        for (size_t w = 0; w < workerCount; ++w) {
+            slices[w].next = count * w / workerCount;
+            slices[w].end = count * (w + 1) / workerCount;
+        }
+
+        std::atomic<bool> abort{ false };
+        std::exception_ptr firstError;
+        std::mutex errorMutex;
+
+        auto steal = [&](size_t self) {
+            while (true) {
+                size_t victim = workerCount;
+                size_t largest = 0;
+                for (size_t w = 0; w < workerCount; ++w) {
+                    if (w == self) continue;
+                    std::lock_guard<std::mutex> lock(slices[w].mutex);
+                    size_t remaining = slices[w].end - slices[w].next;
+                    if (remaining > largest) {
+                        largest = remaining;
+                        victim = w;
+                    }
+                }
+                if (victim == workerCount) return false;
+
+                size_t begin, end;
+                {
+                    std::lock_guard<std::mutex> lock(slices[victim].mutex);
+                    size_t remaining = slices[victim].end - slices[victim].next;
+                    if (remaining == 0) continue; // Drained meanwhile, look again
+
+                    begin = slices[victim].next + remaining / 2;
+                    end = slices[victim].end;
+                    slices[victim].end = begin;
+                }
+
+                std::lock_guard<std::mutex> lock(slices[self].mutex);
+                slices[self].next = begin;
+                slices[self].end = end;
+                return true;
+            }
+        };
+
+        auto worker = [&](size_t self) {
+            while (!abort) {
+                size_t i;
+                {
+                    std::lock_guard<std::mutex> lock(slices[self].mutex);
+                    i = slices[self].next < slices[self].end ? slices[self].next++ : count;
+                }
+
+                if (i == count) {
+                    if (!steal(self)) return;
+                    continue;
+                }
+
+                try {
+                    fn(i);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!firstError) firstError = std::current_exception();
+                    abort = true;
+                }
+            }
+        };
+
+        {
+            std::vector<std::jthread> workers;
+            workers.reserve(workerCount);
+            for (size_t w = 0; w < workerCount; ++w) workers.emplace_back(worker, w);
+        }
+
+        if (firstError) std::rethrow_exception(firstError);
+    }
+}
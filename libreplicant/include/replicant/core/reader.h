@@ -89,15 +89,19 @@ namespace replicant {
             return target;
         }
 
-        std::string readStringRelative(const uint32_t& offsetField) const {
-            if (offsetField == 0) return "";
+        std::string_view readStringViewRelative(const uint32_t& offsetField) const {
+            if (offsetField == 0) return {};
 
             auto ptr = getOffsetPtr(offsetField);
 
             size_t maxLen = end_ - ptr;
             size_t len = strnlen(ptr, maxLen);
 
-            return std::string(ptr, len);
+            return std::string_view(ptr, len);
+        }
+
+        std::string readStringRelative(const uint32_t& offsetField) const {
+            return std::string(readStringViewRelative(offsetField));
         }
     };
 }
\ No newline at end of file
@@ -12,6 +12,28 @@ namespace DirectX {
 
 namespace replicant::dds {
 
+    struct DDSHeaderInfo {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t depth = 1;         // Above 1 only for volume textures
+        uint32_t mipLevels = 1;
+        uint32_t arraySize = 1;     // 2D surfaces per mip, 6 per cube for cube maps
+        TextureFormat format = TextureFormat::UNKNOWN;  // UNKNOWN for formats the game has no equivalent of
+        TextureDimension dimension = TextureDimension::Texture2D;
+
+        size_t dataOffset = 0;      // Where pixel data starts: 128, or 148 with a DX10 header
+        size_t dataSize = 0;        // Pixel data every surface takes up, 0 if the format is UNKNOWN
+    };
+
+    // Reads what DDSFile::LoadFromMemory would report from the DDS (and DX10) header alone, without DirectXTex,
+    // without allocating and without touching the pixels. Fails on malformed headers and on files too short for the
+    // pixel data the header describes, so the data can be used in place afterwards
+    std::expected<DDSHeaderInfo, Error> ProbeHeader(std::span<const std::byte> data);
+
+    // Same, for when only the start of a fileSize byte file has been read. `header` has to cover the DX10 header
+    // if there is one, 148 bytes always do
+    std::expected<DDSHeaderInfo, Error> ProbeHeader(std::span<const std::byte> header, uint64_t fileSize);
+
     class DDSFile {
         std::unique_ptr<DirectX::ScratchImage> image_;
 
@@ -29,6 +51,15 @@ namespace replicant::dds {
             std::span<const std::byte> pixelData
         );
 
+        // Writes game texture data as a DDS file. When the pixel data is packed the way ToGameFormat lays it out
+        // (the usual case) the DDS header is written in front of it directly, without staging a copy in a
+        // ScratchImage; otherwise this is CreateFromGameData followed by Save
+        static std::expected<void, Error> SaveGameData(
+            const TextureHeader& header,
+            std::span<const std::byte> pixelData,
+            const std::filesystem::path& path
+        );
+
         std::expected<void, Error> Save(const std::filesystem::path& path);
         std::expected<std::vector<std::byte>, Error> SaveToMemory();
 
@@ -41,5 +72,9 @@ namespace replicant::dds {
         std::span<const std::byte> getPixelData() const;
 
         std::pair<TextureHeader, std::vector<std::byte>> ToGameFormat() const;
+
+        // The texture as a standalone rtex (tpGxTexHead BXON, header followed by pixel data), written into a single
+        // buffer sized up front rather than assembled from intermediate copies
+        std::expected<std::vector<std::byte>, Error> ToRtex() const;
     };
 }
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+#include "replicant/core/common.h"
+#include "replicant/tpArchiveFileParam.h"
+#include <vector>
+#include <cstdint>
+#include <expected>
+#include <span>
+
+namespace replicant::archive {
+
+    struct FrameRange {
+        uint64_t offset = 0;
+        uint32_t size = 0;  // Compressed size, the frame occupies it rounded up to the sector alignment
+    };
+
+    // Sidecar of a SeparateFrames archive listing frames no index entry references anymore, left behind when
+    // Append replaced their entries. Only valid for the archive whose size and mtime it records; Compact
+    // reclaims the space
+    class DeadFrames {
+    public:
+        uint64_t archiveSize = 0;
+        int64_t archiveMtime = 0;
+        std::vector<FrameRange> frames;
+
+        static std::expected<DeadFrames, Error> Deserialize(std::span<const std::byte> data);
+        std::expected<std::vector<std::byte>, Error> Serialize() const;
+
+        // Archive bytes taken up by the dead frames, alignment padding included
+        uint64_t wastedBytes() const;
+
+        // The distinct frames entries of archiveIndex point at, by offset
+        static std::vector<FrameRange> FramesOf(const TpArchiveFileParam& index, uint8_t archiveIndex);
+
+        // Adds the frames of `previous` (see FramesOf) that no entry of archiveIndex in `index` starts at anymore
+        void addUnreferenced(std::span<const FrameRange> previous, const TpArchiveFileParam& index, uint8_t archiveIndex);
+
+    private:
+        std::vector<std::byte> SerializeInternal() const;
+    };
+}
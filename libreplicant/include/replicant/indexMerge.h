@@ -0,0 +1,170 @@
+#pragma once
+#include "replicant/core/common.h"
+#include "replicant/core/lookup.h"
+#include "replicant/tpArchiveFileParam.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <span>
+#include <filesystem>
+
+namespace replicant {
+
+    struct ModIndexSource {
+        std::string id;
+        std::filesystem::path indexPath;   // The mod's info.arc, its archive is looked up next to it
+    };
+
+    struct MergeStats {
+        size_t overwritten = 0;     // Entries that replaced an entry of the base index or of an earlier mod
+        size_t added = 0;
+    };
+
+    struct ModMergeResult {
+        std::string id;
+        bool applied = false;
+        std::string error;          // Why the mod was skipped, empty if applied
+        std::filesystem::path archivePath;  // The archive its index references, empty if the index could not be read
+        MergeStats stats;
+    };
+
+    struct ConsolidateOptions {
+        std::filesystem::path outputDir;            // Where the consolidated archives are written
+        std::string baseName = "LunarTearMods";     // Archives are named <baseName>_000.arc, <baseName>_001.arc, ...
+
+        // An archive is split once the next frame would take it past this. Offsets are stored >> 4 in 32 bits,
+        // so anything up to 64 GiB is addressable
+        uint64_t maxArchiveSize = 16ull << 30;
+    };
+
+    struct ConsolidateStats {
+        std::vector<std::filesystem::path> sources;     // Mod archives whose frames were copied
+        std::vector<std::filesystem::path> archives;    // Archives written
+        size_t frames = 0;
+        uint64_t bytes = 0;
+        size_t shadowedEntries = 0;     // Mod entries replaced by a later mod, their frames were not copied
+    };
+
+    // Applies mod indices to a base index as upserts by entry name. Every entry's fnv1_32 is computed once and kept
+    // next to it, lookups go through a hash index over those cached values and the final sort uses them as keys, so
+    // a merge is linear in the total number of entries apart from that one sort.
+    // Archive indices are tracked at full width until finish(), so more than 256 archives can be merged as long as
+    // consolidate() brings the count back down
+    class IndexMerger {
+    public:
+        explicit IndexMerger(TpArchiveFileParam base);
+
+        // Adds an archive entry for archivePath (taking load type and offset scale from the mod's first archive) and
+        // points every entry of the mod at it. Entries already present, from the base or an earlier mod, are replaced
+        MergeStats apply(const TpArchiveFileParam& mod, const std::string& archivePath);
+
+        // Copies the frames still referenced from the STREAM archives added by apply() into a few new archives in
+        // options.outputDir, in source order, and repoints their entries. The source archives are dropped from the
+        // index afterwards. Frames shared by several entries are copied once. Archive names are resolved against,
+        // and the new ones referenced relative to, dataRoot
+        std::expected<ConsolidateStats, Error> consolidate(const std::filesystem::path& dataRoot, const ConsolidateOptions& options);
+
+        // The merged index with file entries in ascending name hash order, as Serialize writes them and the game
+        // expects. Fails if more archives are referenced than an entry's 8-bit archive index can address.
+        // The merger is empty afterwards
+        std::expected<TpArchiveFileParam, Error> finish();
+
+    private:
+        size_t find(const std::string& name, uint32_t hash);
+
+        TpArchiveFileParam param_;
+        std::vector<uint32_t> hashes_;      // fnv1_32 of param_.fileEntries[i].name
+        std::vector<uint32_t> archiveOf_;   // Full width archive index of param_.fileEntries[i]
+        LookupIndex index_;
+
+        size_t baseArchiveCount_ = 0;
+        size_t shadowedEntries_ = 0;
+    };
+
+    // Deletes the archives consolidate() wrote to options.outputDir, numbered from keep on. Archives are numbered
+    // without gaps, so this stops at the first one missing. Returns how many were removed
+    size_t RemoveConsolidatedArchives(const ConsolidateOptions& options, size_t keep = 0);
+
+    struct MergeOptions {
+        // Consolidates the STREAM mod archives after merging, see IndexMerger::consolidate
+        std::optional<ConsolidateOptions> consolidate;
+    };
+
+    struct IndexMergeResult {
+        std::vector<std::byte> compressedIndex;     // Only filled if at least one mod was applied
+        std::vector<ModMergeResult> mods;           // Same order as the sources
+        std::optional<ConsolidateStats> consolidation;
+
+        bool anyApplied() const;
+    };
+
+    // Merges mod indices into the base info.arc (compressed, as stored on disk) and returns the patched index in the
+    // same form, entries sorted by name hash as the game expects. Mods are applied in the order given, so a later
+    // mod wins over an earlier one. A mod whose index cannot be read or whose archive is missing is skipped and
+    // reported in its ModMergeResult; only a broken base index or a failed consolidation fails the whole merge.
+    // Mod archives are referenced relative to dataRoot, the directory the game resolves archive names against
+    std::expected<IndexMergeResult, Error> MergeModIndices(
+        std::span<const std::byte> baseIndex,
+        const std::vector<ModIndexSource>& mods,
+        const std::filesystem::path& dataRoot,
+        const MergeOptions& options = {}
+    );
+
+    // Everything a patched index is built from, so a rebuild can be skipped when nothing changed. The base index is
+    // identified by size, mtime and content hash, mod indices by path, size and mtime, in merge order. Mod archives
+    // (ModMergeResult::archivePath, missing ones included) and the outputs are stamped as well, so an archive that
+    // appears, disappears or changes, or a deleted or replaced output, triggers a rebuild too
+    class PatchFingerprint {
+    public:
+        struct ModStamp {
+            std::string id;
+            std::string indexPath;
+            uint64_t size = 0;
+            int64_t mtime = 0;
+
+            bool operator==(const ModStamp&) const = default;
+        };
+
+        struct FileStamp {
+            std::string path;
+            uint64_t size = 0;
+            int64_t mtime = 0;
+
+            bool operator==(const FileStamp&) const = default;
+        };
+
+        uint64_t baseSize = 0;
+        int64_t baseMtime = 0;
+        uint64_t baseHash = 0;
+        bool consolidated = false;
+        std::vector<ModStamp> mods;
+
+        std::vector<FileStamp> dependencies;
+        std::vector<FileStamp> outputs;
+
+        // baseIndex is the content of baseIndexPath, passed in so callers that go on to merge only read it once
+        static PatchFingerprint Compute(
+            const std::filesystem::path& baseIndexPath,
+            std::span<const std::byte> baseIndex,
+            const std::vector<ModIndexSource>& mods
+        );
+
+        // Record the current size and mtime of a file, zero if it does not exist
+        void addDependency(const std::filesystem::path& path);
+        void addOutput(const std::filesystem::path& path);
+
+        // True if current (a freshly computed fingerprint) has the same inputs as this one, and every dependency
+        // and output recorded here is unchanged on disk
+        bool isUpToDate(const PatchFingerprint& current) const;
+
+        static std::expected<PatchFingerprint, Error> Deserialize(std::span<const std::byte> data);
+        std::expected<std::vector<std::byte>, Error> Serialize() const;
+
+        bool operator==(const PatchFingerprint&) const = default;
+
+    private:
+        std::vector<std::byte> SerializeInternal() const;
+    };
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "replicant/core/common.h"
+#include "replicant/core/lookup.h"
 #include <vector>
 #include <string>
 #include <cstdint>
@@ -23,11 +24,21 @@ namespace replicant {
         static std::expected<KpkFile, Error> Deserialize(std::span<const std::byte> data);
         std::expected<std::vector<std::byte>, Error> Serialize() const;
 
+        // Opt-in hash index for findFile/findByHash, keyed on fnv1_32 of the entry name. Entries appended are
+        // indexed lazily on the next non-const lookup; rebuild after reordering, erasing or renaming entries
+        void buildLookupIndex() { index_.reset(); }
+        void dropLookupIndex() { index_.disable(); }
+
         KpkEntry* findFile(const std::string& name);
         const KpkEntry* findFile(const std::string& name) const;
 
+        KpkEntry* findByHash(uint32_t nameHash);
+        const KpkEntry* findByHash(uint32_t nameHash) const;
+
     private:
         std::vector<std::byte> SerializeInternal() const;
+
+        LookupIndex index_;
     };
 
 }
\ No newline at end of file
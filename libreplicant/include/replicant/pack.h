@@ -1,7 +1,9 @@
 #pragma once
 #include "replicant/core/common.h"
+#include "replicant/core/lookup.h"
 #include <vector>
 #include <string>
+#include <string_view>
 #include <cstdint>
 #include <expected>
 #include <optional>
@@ -35,6 +37,23 @@ namespace replicant {
         bool hasResource() const { return !resourceData.empty(); }
     };
 
+    struct PackProbeEntry {
+        uint32_t nameHash = 0;
+        std::string name;
+        uint32_t serializedSize = 0;
+        uint32_t resourceSize = 0; // Inferred from the next resource offset, so includes padding
+    };
+
+    // Names, hashes and sizes of a PACK's contents, read from the header and tables only
+    struct PackProbe {
+        PackHeaderInfo info{};
+        uint32_t serializedSize = 0;
+        uint32_t resourceSize = 0;
+        std::vector<ImportEntry> imports;
+        std::vector<PackProbeEntry> assetPackages;
+        std::vector<PackProbeEntry> files;
+    };
+
     namespace raw {
 
         struct RawImport {
@@ -63,20 +82,73 @@ namespace replicant {
         static std::expected<Pack, Error> Deserialize(std::span<const std::byte> data);
         static std::expected<Pack, Error> DeserializeNoResources(const std::filesystem::path& filePath);
 
+        // Reads only the header, the import/asset package/file tables and the string pool, without any content
+        static std::expected<PackProbe, Error> Probe(const std::filesystem::path& filePath);
+
         struct PackFileSizes {
             uint32_t serializedSize;
             uint32_t resourceSize;
             uint32_t fileSize;
+            uint64_t physicalSize; // Size on disk, read in the same open as the header
         };
 		static std::expected<PackFileSizes, Error> getFileSizes(const std::filesystem::path& filePath);
 
         std::expected<std::vector<std::byte>, Error> Serialize() const;
 
+        // Opt-in hash index for findFile, keyed on fnv1_32 of the entry name rather than the stored nameHash, which
+        // may not be set. Entries appended to files are indexed lazily on the next non-const lookup; rebuild after
+        // reordering, erasing or renaming entries. findByHash matches the stored nameHash through a second index
+        // over those, built and dropped together with the name index
+        void buildLookupIndex() { index_.reset(); hashIndex_.reset(); }
+        void dropLookupIndex() { index_.disable(); hashIndex_.disable(); }
+
         PackFileEntry* findFile(const std::string& name);
         const PackFileEntry* findFile(const std::string& name) const;
 
+        PackFileEntry* findByHash(uint32_t nameHash);
+        const PackFileEntry* findByHash(uint32_t nameHash) const;
+
     private:
         std::vector<std::byte> SerializeInternal() const;
 
+        LookupIndex index_;
+        LookupIndex hashIndex_;     // Keyed on the stored nameHash
+    };
+
+    struct ImportView {
+        uint32_t pathHash = 0;
+        std::string_view path;
+    };
+
+    struct AssetPackageView {
+        uint32_t nameHash = 0;
+        std::string_view name;
+        std::span<const std::byte> content;
+    };
+
+    struct PackFileView {
+        uint32_t nameHash = 0;
+        std::string_view name;
+
+        std::span<const std::byte> serializedData;
+        std::span<const std::byte> resourceData;
+
+        bool hasResource() const { return !resourceData.empty(); }
+    };
+
+    // Non-owning parse of a PACK. Names and data blocks are slices of the buffer passed to Deserialize
+    // (usually a MappedFile), which must outlive the view. Use toPack() when an editable copy is needed.
+    class PackView {
+    public:
+        PackHeaderInfo info{};
+        std::vector<ImportView> imports;
+        std::vector<AssetPackageView> assetPackages;
+        std::vector<PackFileView> files;
+
+        static std::expected<PackView, Error> Deserialize(std::span<const std::byte> data);
+
+        Pack toPack() const;
+
+        const PackFileView* findFile(std::string_view name) const;
     };
 }
\ No newline at end of file
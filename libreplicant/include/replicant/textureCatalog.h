@@ -0,0 +1,77 @@
+#pragma once
+#include "replicant/core/common.h"
+#include "replicant/dds.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <expected>
+#include <span>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+
+namespace replicant::dds {
+
+    struct TextureSource {
+        std::string name;   // Lookup key, matched exactly
+        std::filesystem::path path;
+    };
+
+    struct CatalogTexture {
+        std::string name;
+        std::filesystem::path path;
+        DDSHeaderInfo header;
+    };
+
+    struct CatalogRejection {
+        std::string name;
+        std::filesystem::path path;
+        Error error;
+    };
+
+    // Loose DDS replacements, probed once up front so a lookup is a hash lookup and the header checks need no file
+    // access. Only headers are read while building; the pixel data of a texture is read the first time it is asked
+    // for and kept for the lifetime of the catalog, so the returned spans stay valid
+    class TextureCatalog {
+    public:
+        TextureCatalog();
+        ~TextureCatalog();
+        TextureCatalog(TextureCatalog&&) noexcept;
+        TextureCatalog& operator=(TextureCatalog&&) noexcept;
+
+        // Probes every source in parallel. Sources that cannot be read or are not valid DDS files are left out and
+        // listed in rejected(). Later sources with the same name replace earlier ones
+        static TextureCatalog Build(std::span<const TextureSource> sources, unsigned jobs = 0);
+
+        const CatalogTexture* find(std::string_view name) const;
+
+        // Whether any name is a SpecialK style CRC32C name ("0123abcd.dds"), so callers can skip hashing otherwise
+        bool hasHashNames() const { return hasHashNames_; }
+
+        size_t size() const { return textures_.size(); }
+        const std::vector<CatalogTexture>& textures() const { return textures_; }
+        const std::vector<CatalogRejection>& rejected() const { return rejected_; }
+
+        // The pixel data of a texture of this catalog (header.dataOffset, header.dataSize). Thread safe; fails if
+        // the file is gone or no longer matches the probed header
+        std::expected<std::span<const std::byte>, Error> pixels(const CatalogTexture& texture) const;
+
+        // Whether name looks like "<8 hex digits>.dds", in either case
+        static bool IsHashName(std::string_view name);
+
+    private:
+        struct Slot;
+
+        struct NameHash {
+            using is_transparent = void;
+            size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+        };
+
+        std::vector<CatalogTexture> textures_;
+        std::unique_ptr<Slot[]> slots_;     // Lazily loaded file data, parallel to textures_
+        std::unordered_map<std::string, size_t, NameHash, std::equal_to<>> byName_;
+        std::vector<CatalogRejection> rejected_;
+        bool hasHashNames_ = false;
+    };
+}
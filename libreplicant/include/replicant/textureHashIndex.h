@@ -0,0 +1,78 @@
+#pragma once
+#include "replicant/core/common.h"
+#include "replicant/tpGxTexHead.h"
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <span>
+#include <filesystem>
+
+namespace replicant {
+
+    struct TextureHashEntry {
+        uint32_t crc = 0;
+        std::string name;   // Entry name in the pack, e.g. "tex_abc.rtex"
+    };
+
+    struct TextureHashPack {
+        std::string path;       // Relative to the indexed root, '/' separated
+        int64_t mtime = 0;      // Raw last_write_time ticks, only compared for equality
+        uint64_t fileSize = 0;
+
+        std::vector<TextureHashEntry> textures;    // Empty for files that are not PACKs, so they are not re-read
+    };
+
+    struct TextureHashMatch {
+        const TextureHashPack* pack = nullptr;
+        const TextureHashEntry* texture = nullptr;
+    };
+
+    struct TextureHashIndexUpdateStats {
+        size_t reused = 0;
+        size_t scanned = 0;
+        size_t removed = 0;
+        size_t textures = 0;    // Textures hashed while scanning
+    };
+
+    // Which game textures a SpecialK style hash name ("0123ABCD.dds") stands for: the CRC32C of LOD0 of every
+    // rtex in an extracted data tree, as the loader's hash fallback computes it at runtime. Packs are stamped
+    // with size and mtime like AssetIndex, so Update only re-reads files that changed. The serialized form
+    // keeps a crc -> texture table sorted by crc for lookups
+    class TextureHashIndex {
+    public:
+        static constexpr const char* DefaultFileName = "texture_hashes.ltth";
+
+        std::vector<TextureHashPack> packs;
+
+        static std::expected<TextureHashIndex, Error> Deserialize(std::span<const std::byte> data);
+        std::expected<std::vector<std::byte>, Error> Serialize() const;
+
+        // Walks root and brings the index in line with it. New or changed PACKs are read in parallel, only the
+        // texture headers and the LOD0 pixels of each rtex are touched. Index files themselves are skipped
+        std::expected<TextureHashIndexUpdateStats, Error> Update(const std::filesystem::path& root, unsigned jobs = 0);
+
+        std::vector<TextureHashMatch> find(uint32_t crc) const;
+
+        // The SpecialK hash of a texture: CRC32C over the first mip surface of pixel data
+        static std::optional<uint32_t> HashTexture(const TextureHeader& header, std::span<const std::byte> pixelData);
+
+        // The hash in a "<8 hex digits>.dds" file name, in either case
+        static std::optional<uint32_t> ParseHashName(std::string_view fileName);
+
+    private:
+        struct Lookup {
+            uint32_t crc;
+            uint32_t packIndex;
+            uint32_t textureIndex;
+        };
+
+        static TextureHashIndex DeserializeInternal(std::span<const std::byte> data);
+        void buildLookup();
+        std::vector<std::byte> SerializeInternal() const;
+
+        std::vector<Lookup> lookup_;
+    };
+}
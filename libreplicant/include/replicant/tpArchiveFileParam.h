@@ -1,6 +1,7 @@
 #pragma once
 #include "replicant/core/common.h"
 #include "replicant/arc.h" 
+#include "replicant/core/lookup.h"
 #include <vector>
 #include <string>
 #include <cstdint>
@@ -47,14 +48,24 @@ namespace replicant {
         uint8_t addArchiveEntry(const std::string& filename, ArchiveLoadType type);
 
 
+        // Builds the lookup index if it is not enabled yet, since every built entry is looked up
         void registerArchive(
             uint8_t archiveIndex,
             const std::vector<archive::ArchiveEntryInfo>& builtEntries
         );
 
+        // Opt-in hash index for findFile/findByHash, keyed on fnv1_32 of the entry name (the pathHash written by
+        // Serialize). Entries appended to fileEntries are indexed lazily on the next lookup; rebuild after
+        // reordering (e.g. sorting by hash), erasing or renaming entries
+        void buildLookupIndex() { index_.reset(); }
+        void dropLookupIndex() { index_.disable(); }
+
         FileEntry* findFile(const std::string& name);
+        FileEntry* findByHash(uint32_t pathHash);
 
     private:
         std::vector<std::byte> SerializeInternal() const;
+
+        LookupIndex index_;
     };
 }
\ No newline at end of file
@@ -77,6 +77,9 @@ namespace replicant {
     std::expected<TextureHeader, Error> DeserializeTexHead(std::span<const std::byte> data);
     std::expected<std::vector<std::byte>, Error> SerializeTexHead(const TextureHeader& header);
 
+    // Bytes SerializeTexHead produces for this header, i.e. where the pixel data of a standalone rtex starts
+    size_t SerializedTexHeadSize(const TextureHeader& header);
+
 }
 
 namespace replicant::raw {
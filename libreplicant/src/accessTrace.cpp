@@ -0,0 +1,366 @@
+#include "replicant/accessTrace.h"
+#include "replicant/core/io.h"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+#include <cstring>
+
+namespace replicant::archive {
+
+    namespace {
+        constexpr uint64_t SECTOR_ALIGNMENT = 16;
+
+        constexpr char TraceMagic[4] = { 'L', 'T', 'T', 'R' };
+        constexpr uint32_t TraceVersion = 1;
+
+        // Record tags, event records use their TraceEvent value
+        constexpr uint8_t PhaseRecord = 0xFF;
+
+        // Event record: tag, u64 time, u16 name length, name. Phase record: tag, u16 label length, label
+        template<typename T>
+        void Append(std::vector<std::byte>& out, const T& value) {
+            const auto* ptr = reinterpret_cast<const std::byte*>(&value);
+            out.insert(out.end(), ptr, ptr + sizeof(T));
+        }
+
+        void AppendString(std::vector<std::byte>& out, std::string_view s) {
+            uint16_t length = static_cast<uint16_t>(std::min<size_t>(s.size(), UINT16_MAX));
+            Append(out, length);
+            const auto* ptr = reinterpret_cast<const std::byte*>(s.data());
+            out.insert(out.end(), ptr, ptr + length);
+        }
+
+        // Bounds checked cursor that reports running out instead of throwing, see AccessTrace::Deserialize
+        struct RecordCursor {
+            std::span<const std::byte> data;
+            size_t pos = 0;
+
+            template<typename T>
+            bool read(T& value) {
+                if (data.size() - pos < sizeof(T)) return false;
+                std::memcpy(&value, data.data() + pos, sizeof(T));
+                pos += sizeof(T);
+                return true;
+            }
+
+            bool readString(std::string_view& s) {
+                uint16_t length;
+                if (!read(length) || data.size() - pos < length) return false;
+                s = std::string_view(reinterpret_cast<const char*>(data.data() + pos), length);
+                pos += length;
+                return true;
+            }
+        };
+
+        std::string_view Trim(std::string_view s) {
+            size_t begin = s.find_first_not_of(" \t\r");
+            if (begin == std::string_view::npos) return {};
+            size_t end = s.find_last_not_of(" \t\r");
+            return s.substr(begin, end - begin + 1);
+        }
+
+        // Trace names come from the game or hand-written lists, archive inputs are relative '/' paths
+        std::string NormalizeName(std::string_view name) {
+            std::string normalized(name);
+            std::replace(normalized.begin(), normalized.end(), '\\', '/');
+            size_t start = 0;
+            while (normalized.compare(start, 2, "./") == 0) start += 2;
+            while (start < normalized.size() && normalized[start] == '/') start++;
+            return normalized.substr(start);
+        }
+
+        struct NameUse {
+            size_t firstAccess;
+            std::vector<uint32_t> phases;   // Sorted, unique
+        };
+    }
+
+    void AccessTrace::add(std::string_view phase, std::string_view name, TraceEvent event, uint64_t time) {
+        auto [it, inserted] = phaseIndex_.try_emplace(std::string(phase), static_cast<uint32_t>(phases.size()));
+        if (inserted) phases.emplace_back(phase);
+
+        accesses.push_back({ NormalizeName(name), it->second, event, time });
+    }
+
+    std::expected<AccessTrace, Error> AccessTrace::ParseText(std::string_view text) {
+        AccessTrace trace;
+        size_t lineNumber = 0;
+
+        while (!text.empty()) {
+            size_t end = text.find('\n');
+            std::string_view line = Trim(text.substr(0, end));
+            text = end == std::string_view::npos ? std::string_view{} : text.substr(end + 1);
+            lineNumber++;
+
+            if (line.empty() || line.front() == '#') continue;
+
+            size_t split = line.find_first_of(" \t");
+            if (split == std::string_view::npos) {
+                trace.add("", line);
+                continue;
+            }
+
+            std::string_view name = Trim(line.substr(split));
+            if (name.empty()) {
+                return std::unexpected(Error{ ErrorCode::ParseError, std::format("Trace line {} has no name", lineNumber) });
+            }
+            trace.add(line.substr(0, split), name);
+        }
+
+        return trace;
+    }
+
+    std::expected<AccessTrace, Error> AccessTrace::Deserialize(std::span<const std::byte> data) {
+        RecordCursor cursor{ data };
+
+        char magic[4];
+        uint32_t version;
+        if (!cursor.read(magic) || std::memcmp(magic, TraceMagic, 4) != 0) {
+            return std::unexpected(Error{ ErrorCode::ParseError, "Invalid trace magic" });
+        }
+        if (!cursor.read(version) || version != TraceVersion) {
+            return std::unexpected(Error{ ErrorCode::ParseError, "Unsupported trace version" });
+        }
+
+        struct RawAccess {
+            std::string_view phase;
+            std::string_view name;
+            TraceEvent event;
+            uint64_t time;
+        };
+
+        std::vector<RawAccess> raw;
+        std::string_view phase;
+        while (cursor.pos < data.size()) {
+            uint8_t tag;
+            cursor.read(tag);
+
+            if (tag == PhaseRecord) {
+                if (!cursor.readString(phase)) break;
+                continue;
+            }
+            if (tag >= TRACE_EVENT_COUNT) {
+                return std::unexpected(Error{ ErrorCode::ParseError, std::format("Unknown trace record {} at {}", tag, cursor.pos - 1) });
+            }
+
+            uint64_t time;
+            std::string_view name;
+            if (!cursor.read(time) || !cursor.readString(name)) break;
+            raw.push_back({ phase, name, static_cast<TraceEvent>(tag), time });
+        }
+
+        // The recorder writes each thread's records in batches, so the file is only ordered per thread
+        std::stable_sort(raw.begin(), raw.end(), [](const RawAccess& a, const RawAccess& b) { return a.time < b.time; });
+
+        AccessTrace trace;
+        trace.accesses.reserve(raw.size());
+        for (const auto& access : raw) trace.add(access.phase, access.name, access.event, access.time);
+        return trace;
+    }
+
+    std::expected<AccessTrace, Error> AccessTrace::Load(const std::filesystem::path& path) {
+        auto data = ReadFile(path);
+        if (!data) return std::unexpected(Error{ ErrorCode::IoError, data.error().message });
+
+        if (data->size() >= 4 && std::memcmp(data->data(), TraceMagic, 4) == 0) {
+            return Deserialize(*data);
+        }
+        return ParseText(std::string_view(reinterpret_cast<const char*>(data->data()), data->size()));
+    }
+
+    std::vector<std::byte> TraceEncoder::Header() {
+        std::vector<std::byte> header;
+        Append(header, TraceMagic);
+        Append(header, TraceVersion);
+        return header;
+    }
+
+    void TraceEncoder::encode(std::vector<std::byte>& out, TraceEvent event, uint64_t time, std::string_view phase, std::string_view name) {
+        if (phase != phase_) {
+            phase_ = phase;
+            Append(out, PhaseRecord);
+            AppendString(out, phase);
+        }
+
+        Append(out, static_cast<uint8_t>(event));
+        Append(out, time);
+        AppendString(out, name);
+    }
+
+    TraceSummary Summarize(const AccessTrace& trace) {
+        TraceSummary summary;
+        summary.phases.resize(trace.phases.size());
+        for (size_t i = 0; i < trace.phases.size(); ++i) summary.phases[i].label = trace.phases[i];
+
+        std::unordered_map<std::string_view, std::vector<uint32_t>> phasesOf;
+        for (const auto& access : trace.accesses) {
+            TraceSummary::Phase& phase = summary.phases[access.phase];
+            if (phase.accesses == 0) phase.firstTime = access.time;
+            phase.lastTime = access.time;
+            phase.accesses++;
+
+            summary.accesses++;
+            summary.byEvent[static_cast<size_t>(access.event)]++;
+            summary.duration = std::max(summary.duration, access.time);
+
+            auto& seenIn = phasesOf[access.name];
+            if (seenIn.empty()) summary.distinct++;
+            if (std::find(seenIn.begin(), seenIn.end(), access.phase) == seenIn.end()) {
+                seenIn.push_back(access.phase);
+                phase.distinct++;
+            }
+        }
+        return summary;
+    }
+
+    std::string ToLoadOrder(const AccessTrace& trace) {
+        std::vector<std::string> labels;
+        labels.reserve(trace.phases.size());
+        for (const auto& phase : trace.phases) {
+            std::string label = phase;
+            std::replace_if(label.begin(), label.end(), [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }, '_');
+            labels.push_back(std::move(label));
+        }
+
+        struct PhaseName {
+            uint32_t phase;
+            std::string_view name;
+            bool operator==(const PhaseName&) const = default;
+        };
+        struct PhaseNameHash {
+            size_t operator()(const PhaseName& key) const { return std::hash<std::string_view>{}(key.name) ^ (static_cast<size_t>(key.phase) * 0x9E3779B97F4A7C15ull); }
+        };
+
+        std::unordered_set<PhaseName, PhaseNameHash> written;
+        std::string out;
+        for (const auto& access : trace.accesses) {
+            if (!written.insert({ access.phase, access.name }).second) continue;
+
+            const std::string& label = labels[access.phase];
+            if (!label.empty()) {
+                out += label;
+                out += ' ';
+            }
+            out += access.name;
+            out += '\n';
+        }
+        return out;
+    }
+
+    PackMapStats MapToPacks(AccessTrace& trace, std::span<const AssetIndex> indices) {
+        PackMapStats stats;
+        std::vector<TraceAccess> mapped;
+        mapped.reserve(trace.accesses.size());
+
+        auto push = [&](TraceAccess access) {
+            if (!mapped.empty() && mapped.back().phase == access.phase && mapped.back().name == access.name) return;
+            mapped.push_back(std::move(access));
+        };
+
+        for (auto& access : trace.accesses) {
+            if (access.event == TraceEvent::Archive) {
+                stats.dropped++;
+                continue;
+            }
+
+            bool found = false;
+            for (const auto& index : indices) {
+                for (const AssetIndexPack* pack : index.findEntry(access.name)) {
+                    push({ pack->path, access.phase, access.event, access.time });
+                    found = true;
+                }
+            }
+
+            if (found) {
+                stats.mapped++;
+            }
+            else {
+                stats.kept++;
+                push(std::move(access));
+            }
+        }
+
+        trace.accesses = std::move(mapped);
+        return stats;
+    }
+
+    LayoutStats OrderByTrace(std::vector<ArchiveInput>& inputs, const AccessTrace& trace) {
+        std::unordered_map<std::string, NameUse> uses;
+        uses.reserve(trace.accesses.size());
+        for (size_t i = 0; i < trace.accesses.size(); ++i) {
+            const TraceAccess& access = trace.accesses[i];
+            auto [it, inserted] = uses.try_emplace(access.name, NameUse{ i, {} });
+
+            auto& phases = it->second.phases;
+            auto pos = std::lower_bound(phases.begin(), phases.end(), access.phase);
+            if (pos == phases.end() || *pos != access.phase) phases.insert(pos, access.phase);
+        }
+
+        LayoutStats stats;
+        std::vector<const NameUse*> useOf(inputs.size(), nullptr);
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            auto it = uses.find(inputs[i].name);
+            if (it == uses.end()) {
+                stats.untraced++;
+                continue;
+            }
+            useOf[i] = &it->second;
+            stats.traced++;
+            if (it->second.phases.size() > 1) stats.shared++;
+        }
+
+        // Phases are numbered in order of first appearance, so the lowest phase of an input is the first to load it
+        std::vector<size_t> order(inputs.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            const NameUse* ua = useOf[a];
+            const NameUse* ub = useOf[b];
+            if (!ua || !ub) return ua && !ub;
+
+            if (ua->phases.front() != ub->phases.front()) return ua->phases.front() < ub->phases.front();
+
+            bool sharedA = ua->phases.size() > 1;
+            bool sharedB = ub->phases.size() > 1;
+            if (sharedA != sharedB) return sharedA;
+            if (sharedA && ua->phases != ub->phases) return ua->phases < ub->phases;
+
+            return ua->firstAccess < ub->firstAccess;
+        });
+
+        std::vector<ArchiveInput> ordered;
+        ordered.reserve(inputs.size());
+        for (size_t i : order) ordered.push_back(std::move(inputs[i]));
+        inputs = std::move(ordered);
+
+        return stats;
+    }
+
+    uint64_t EstimateSeekDistance(const std::vector<ArchiveEntryInfo>& frames, const AccessTrace& trace) {
+        struct Extent {
+            uint64_t offset;
+            uint64_t end;
+        };
+
+        std::unordered_map<std::string_view, Extent> extents;
+        extents.reserve(frames.size());
+        uint64_t offset = 0;
+        for (const auto& frame : frames) {
+            uint64_t size = (static_cast<uint64_t>(frame.compressedSize) + SECTOR_ALIGNMENT - 1) & ~(SECTOR_ALIGNMENT - 1);
+            extents.try_emplace(frame.name, Extent{ offset, offset + size });
+            offset += size;
+        }
+
+        uint64_t distance = 0;
+        uint64_t head = 0;
+        for (const auto& access : trace.accesses) {
+            auto it = extents.find(access.name);
+            if (it == extents.end()) continue;
+
+            const Extent& extent = it->second;
+            distance += extent.offset > head ? extent.offset - head : head - extent.offset;
+            head = extent.end;
+        }
+        return distance;
+    }
+}
@@ -4,22 +4,458 @@
 #include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <mutex>
+#include <array>
+#include <future>
+#include <memory>
+#include <condition_variable>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <cstring>
 #include "replicant/arc.h"
 #include "replicant/pack.h"
+#include "replicant/buildCache.h"
+#include "replicant/deadFrames.h"
+#include "replicant/tpArchiveFileParam.h"
 
 #include "replicant/core/io.h"
+#include "replicant/core/parallel.h"
 
 
 namespace replicant::archive {
 
     namespace {
         constexpr size_t SECTOR_ALIGNMENT = 16;
-        constexpr size_t STREAM_BUFFER_SIZE = 128 * 1024;
+        constexpr size_t STREAM_BUFFER_SIZE = 4 * 1024 * 1024;
+
+        // SeparateFrames inputs from this size up are not compressed into memory by a worker, the writer streams
+        // them straight into the archive instead (see StreamFrame)
+        constexpr uint64_t STREAMED_INPUT_SIZE = 32ull * 1024 * 1024;
 
         size_t align_to(size_t value, size_t alignment) {
             return (value + alignment - 1) & ~(alignment - 1);
         }
 
+        // zstd contexts are expensive to create relative to small frames, so every thread keeps its own for reuse.
+        // Compression contexts are keyed by their parameters so they never need to be reconfigured
+        struct PooledCCtx {
+            int level;
+            int windowLog;
+            std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> ctx;
+        };
+
+        ZSTD_CCtx* ThreadCCtx(CompressionConfig config) {
+            thread_local std::vector<PooledCCtx> pool;
+
+            for (auto& pooled : pool) {
+                if (pooled.level == config.level && pooled.windowLog == config.windowLog) {
+                    // Discards any session a previous failed call left behind, parameters are kept
+                    ZSTD_CCtx_reset(pooled.ctx.get(), ZSTD_reset_session_only);
+                    return pooled.ctx.get();
+                }
+            }
+
+            std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> ctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+            if (!ctx) return nullptr;
+
+            ZSTD_CCtx_setParameter(ctx.get(), ZSTD_c_compressionLevel, config.level);
+            ZSTD_CCtx_setParameter(ctx.get(), ZSTD_c_windowLog, config.windowLog);
+
+            pool.push_back({ config.level, config.windowLog, std::move(ctx) });
+            return pool.back().ctx.get();
+        }
+
+        ZSTD_DCtx* ThreadDCtx() {
+            thread_local std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> ctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+            if (ctx) ZSTD_DCtx_reset(ctx.get(), ZSTD_reset_session_only);
+            return ctx.get();
+        }
+
+        struct CompressedFrame {
+            std::vector<std::byte> data;
+            Pack::PackFileSizes info;
+            uint64_t contentHash = 0;
+            bool reused = false;
+            bool streamed = false;         // Too large to hold, compressed by the writer with StreamFrame, data is empty
+            size_t duplicateOf = SIZE_MAX; // Index of the earlier input whose frame this one shares, data is empty
+
+            // Reused frame of a large input, left in the previous archive's mapping for the writer to copy, data is empty
+            std::span<const std::byte> mapped;
+
+            std::span<const std::byte> bytes() const { return mapped.empty() ? std::span<const std::byte>(data) : mapped; }
+        };
+
+        std::expected<CompressedFrame, Error> CompressFrame(const ArchiveInput& input, CompressionConfig config, bool hashContent = false) {
+            auto infoRes = Pack::getFileSizes(input.fullPath);
+            if (!infoRes) {
+                std::cerr << "Failed to get file sizes for " << input.fullPath << ": " << infoRes.error().toString() << "\n";
+                return std::unexpected(infoRes.error());
+            };
+
+            // Map file
+            auto fileBlob = MappedFile::Open(input.fullPath);
+            if (!fileBlob) return std::unexpected(Error{ ErrorCode::IoError, "Failed to read " + input.fullPath.string() });
+
+            CompressedFrame frame;
+            frame.info = *infoRes;
+            frame.contentHash = hashContent ? hash64(fileBlob->data()) : 0;
+
+            if (fileBlob->size() >= STREAMED_INPUT_SIZE) {
+                frame.streamed = true;
+                return frame;
+            }
+
+            // Compress, the input mapping is released on return
+            auto compressRes = Compress(fileBlob->data(), config);
+            if (!compressRes) return std::unexpected(compressRes.error());
+
+            frame.data = std::move(*compressRes);
+            return frame;
+        }
+
+        // The build cache at cachePath, if it still describes the archive as it is on disk
+        std::optional<BuildCache> LoadValidCache(const std::filesystem::path& archivePath, const std::filesystem::path& cachePath) {
+            std::error_code ec;
+            if (!std::filesystem::exists(cachePath, ec) || !std::filesystem::exists(archivePath, ec)) return std::nullopt;
+
+            auto cacheFile = MappedFile::Open(cachePath);
+            if (!cacheFile) return std::nullopt;
+
+            auto cache = BuildCache::Deserialize(cacheFile->data());
+            if (!cache) return std::nullopt;
+
+            FileStamp archiveStamp = StampOf(archivePath);
+            if (cache->archiveSize != archiveStamp.size || cache->archiveMtime != archiveStamp.mtime) return std::nullopt;
+
+            cache->buildLookupIndex();
+            return std::move(*cache);
+        }
+
+        // Frames compressed with other settings would mix into the archive, so those invalidate the cache too
+        bool CacheMatchesConfig(const BuildCache& cache, CompressionConfig config) {
+            return cache.level == config.level && cache.windowLog == config.windowLog;
+        }
+
+        std::expected<void, Error> WriteCache(const std::filesystem::path& archivePath, const std::filesystem::path& cachePath, BuildCache& cache) {
+            FileStamp archiveStamp = StampOf(archivePath);
+            cache.archiveSize = archiveStamp.size;
+            cache.archiveMtime = archiveStamp.mtime;
+
+            auto cacheData = cache.Serialize();
+            if (!cacheData) return std::unexpected(cacheData.error());
+
+            auto written = WriteFile(cachePath, *cacheData);
+            if (!written) return std::unexpected(Error{ ErrorCode::IoError, written.error().message });
+            return {};
+        }
+
+        // The previous archive and its build cache, only loaded if the cache still describes that archive
+        struct PreviousBuild {
+            BuildCache cache;
+            MappedFile archive;
+        };
+
+        std::optional<PreviousBuild> LoadPreviousBuild(const std::filesystem::path& archivePath, const std::filesystem::path& cachePath,
+            CompressionConfig config) {
+            auto cache = LoadValidCache(archivePath, cachePath);
+            if (!cache || !CacheMatchesConfig(*cache, config)) return std::nullopt;
+
+            auto archive = MappedFile::Open(archivePath);
+            if (!archive) return std::nullopt;
+
+            return PreviousBuild{ std::move(*cache), std::move(*archive) };
+        }
+
+        std::optional<CompressedFrame> ReuseFrame(const PreviousBuild& previous, const ArchiveInput& input, const FileStamp& stamp) {
+            const BuildCacheEntry* entry = previous.cache.find(input.name);
+            if (!entry || entry->fileSize != stamp.size) return std::nullopt;
+            if (entry->offset + entry->compressedSize > previous.archive.size()) return std::nullopt;
+
+            // An unchanged stamp is trusted, a touched file of the same size is compared by content
+            if (entry->mtime != stamp.mtime) {
+                auto file = MappedFile::Open(input.fullPath);
+                if (!file || hash64(file->data()) != entry->contentHash) return std::nullopt;
+            }
+
+            auto bytes = previous.archive.data().subspan(static_cast<size_t>(entry->offset), entry->compressedSize);
+
+            CompressedFrame frame;
+            frame.info = { entry->packSerializedSize, entry->packResourceSize, 0, entry->fileSize };
+            frame.contentHash = entry->contentHash;
+            frame.reused = true;
+
+            // Frames of large inputs can be any size, the writer copies those from the mapping instead of them being
+            // held in memory until their turn
+            if (entry->fileSize >= STREAMED_INPUT_SIZE) {
+                frame.streamed = true;
+                frame.mapped = bytes;
+            }
+            else {
+                frame.data.assign(bytes.begin(), bytes.end());
+            }
+            return frame;
+        }
+
+        void WriteFrame(std::ofstream& outArc, const ArchiveInput& input, const CompressedFrame& frame, ArchiveResult& result) {
+            std::span<const std::byte> bytes = frame.bytes();
+            size_t cSize = bytes.size();
+            size_t alignedSize = align_to(cSize, SECTOR_ALIGNMENT);
+            size_t padding = alignedSize - cSize;
+
+            ArchiveEntryInfo entry;
+            entry.name = input.name;
+            entry.offset = static_cast<uint64_t>(outArc.tellp());
+            entry.compressedSize = static_cast<uint32_t>(cSize);
+            entry.packSerializedSize = frame.info.serializedSize;
+            entry.packResourceSize = frame.info.resourceSize;
+            result.entries.push_back(entry);
+
+            // Write compressed data
+            outArc.write(reinterpret_cast<const char*>(bytes.data()), cSize);
+
+            // Write padding
+            if (padding > 0) {
+                std::vector<char> pad(padding, 0);
+                outArc.write(pad.data(), padding);
+            }
+        }
+
+        // Compresses a large input straight into the archive as one frame. The whole mapped input is passed in a
+        // single ZSTD_e_end operation as a stable buffer, so zstd compresses from the mapping exactly as Compress
+        // would and only the output is streamed: the frame is byte-identical to Compress at the same settings, while
+        // memory stays at one window and one output buffer whatever the input size
+        std::expected<void, Error> StreamFrame(std::ofstream& outArc, const ArchiveInput& input, const CompressedFrame& frame,
+            CompressionConfig config, ArchiveResult& result) {
+            auto fileBlob = MappedFile::Open(input.fullPath);
+            if (!fileBlob) return std::unexpected(Error{ ErrorCode::IoError, "Failed to read " + input.fullPath.string() });
+
+            std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> cctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+            if (!cctx) return std::unexpected(Error{ ErrorCode::SystemError, "Failed to create ZSTD Context" });
+
+            ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_compressionLevel, config.level);
+            ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_windowLog, config.windowLog);
+            ZSTD_CCtx_setParameter(cctx.get(), ZSTD_c_stableInBuffer, 1);
+            ZSTD_CCtx_setPledgedSrcSize(cctx.get(), fileBlob->size());
+
+            uint64_t offset = static_cast<uint64_t>(outArc.tellp());
+            uint64_t cSize = 0;
+
+            std::vector<char> outBuf(ZSTD_CStreamOutSize());
+            ZSTD_inBuffer zIn = { fileBlob->data().data(), fileBlob->size(), 0 };
+            size_t ret;
+            do {
+                ZSTD_outBuffer zOut = { outBuf.data(), outBuf.size(), 0 };
+                ret = ZSTD_compressStream2(cctx.get(), &zOut, &zIn, ZSTD_e_end);
+                if (ZSTD_isError(ret)) return std::unexpected(Error{ ErrorCode::SystemError, ZSTD_getErrorName(ret) });
+                outArc.write(outBuf.data(), zOut.pos);
+                cSize += zOut.pos;
+            } while (ret > 0);
+
+            if (cSize > UINT32_MAX) {
+                return std::unexpected(Error{ ErrorCode::UnsupportedFeature, "Compressed frame over 4 GiB: " + input.fullPath.string() });
+            }
+
+            size_t padding = align_to(static_cast<size_t>(cSize), SECTOR_ALIGNMENT) - static_cast<size_t>(cSize);
+            if (padding > 0) {
+                std::array<char, SECTOR_ALIGNMENT> pad{};
+                outArc.write(pad.data(), padding);
+            }
+            if (!outArc) return std::unexpected(Error{ ErrorCode::IoError, "Failed to write archive" });
+
+            ArchiveEntryInfo entry;
+            entry.name = input.name;
+            entry.offset = offset;
+            entry.compressedSize = static_cast<uint32_t>(cSize);
+            entry.packSerializedSize = frame.info.serializedSize;
+            entry.packResourceSize = frame.info.resourceSize;
+            result.entries.push_back(entry);
+            return {};
+        }
+
+        struct DuplicateScan {
+            std::vector<uint64_t> hashes;
+            std::vector<size_t> duplicateOf;
+        };
+
+        // Hashes every input (reusing cached hashes for unchanged stamps) and maps each input to the first earlier
+        // input with equal content. Hash matches are confirmed byte for byte, a collision just stays unique
+        std::expected<DuplicateScan, Error> FindDuplicates(const std::vector<ArchiveInput>& inputs, unsigned jobs,
+            const PreviousBuild* previous, const std::vector<FileStamp>& stamps) {
+            DuplicateScan scan;
+            scan.hashes.resize(inputs.size());
+            scan.duplicateOf.assign(inputs.size(), SIZE_MAX);
+
+            std::vector<uint64_t> sizes(inputs.size());
+            std::vector<char> failed(inputs.size(), 0);
+
+            ParallelFor(inputs.size(), jobs, [&](size_t i) {
+                if (previous) {
+                    const BuildCacheEntry* cached = previous->cache.find(inputs[i].name);
+                    if (cached && cached->fileSize == stamps[i].size && cached->mtime == stamps[i].mtime) {
+                        scan.hashes[i] = cached->contentHash;
+                        sizes[i] = cached->fileSize;
+                        return;
+                    }
+                }
+
+                auto file = MappedFile::Open(inputs[i].fullPath);
+                if (!file) {
+                    failed[i] = 1;
+                    return;
+                }
+                scan.hashes[i] = hash64(file->data());
+                sizes[i] = file->size();
+            });
+
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                if (failed[i]) return std::unexpected(Error{ ErrorCode::IoError, "Failed to read " + inputs[i].fullPath.string() });
+            }
+
+            struct ContentKey {
+                uint64_t hash;
+                uint64_t size;
+                bool operator==(const ContentKey&) const = default;
+            };
+            struct ContentKeyHash {
+                size_t operator()(const ContentKey& key) const { return static_cast<size_t>(key.hash ^ (key.size * 0x9E3779B97F4A7C15ull)); }
+            };
+
+            std::unordered_map<ContentKey, size_t, ContentKeyHash> firstWithContent;
+            firstWithContent.reserve(inputs.size());
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                auto [it, inserted] = firstWithContent.try_emplace(ContentKey{ scan.hashes[i], sizes[i] }, i);
+                if (!inserted) scan.duplicateOf[i] = it->second;
+            }
+
+            ParallelFor(inputs.size(), jobs, [&](size_t i) {
+                if (scan.duplicateOf[i] == SIZE_MAX || sizes[i] == 0) return;
+
+                auto a = MappedFile::Open(inputs[i].fullPath);
+                auto b = MappedFile::Open(inputs[scan.duplicateOf[i]].fullPath);
+                bool same = a && b && a->size() == b->size() && std::memcmp(a->data().data(), b->data().data(), a->size()) == 0;
+                if (!same) scan.duplicateOf[i] = SIZE_MAX;
+            });
+
+            return scan;
+        }
+
+        using FrameProducer = std::function<std::expected<CompressedFrame, Error>(size_t)>;
+        using FrameConsumer = std::function<std::expected<void, Error>(size_t, const CompressedFrame&)>;
+        using FrameCost = std::function<uint64_t(size_t)>;
+
+        // Producer threads take inputs in order but may finish out of order. Finished frames wait in a window of
+        // slots until the consumer (the calling thread) reaches them, so at most `window` inputs are in memory at once
+        // and the archive is byte-identical to the single-threaded build.
+        // With a budget, a producer also waits until the estimated cost of its frame fits next to the frames already
+        // in flight. The frame the consumer waits for is always admitted, so a budget smaller than one frame slows
+        // the build down to one frame at a time instead of stalling it
+        std::expected<void, Error> ProduceFramesInOrder(size_t count, unsigned jobs, uint64_t budget, const FrameCost& cost,
+            const FrameProducer& produce, const FrameConsumer& consume) {
+            if (jobs <= 1) {
+                for (size_t i = 0; i < count; ++i) {
+                    auto frame = produce(i);
+                    if (!frame) return std::unexpected(frame.error());
+                    auto consumed = consume(i, *frame);
+                    if (!consumed) return consumed;
+                }
+                return {};
+            }
+
+            const size_t window = static_cast<size_t>(jobs) * 2;
+
+            struct Slot {
+                std::expected<CompressedFrame, Error> frame;
+                uint64_t cost;
+            };
+
+            std::vector<std::optional<Slot>> slots(window);
+            std::mutex mutex;
+            std::condition_variable slotFilled;
+            std::condition_variable slotFreed;
+            size_t nextInput = 0;
+            size_t nextWrite = 0;
+            uint64_t inFlight = 0;
+            bool abort = false;
+
+            auto worker = [&]() {
+                while (true) {
+                    size_t i;
+                    {
+                        std::lock_guard lock(mutex);
+                        if (abort || nextInput >= count) return;
+                        i = nextInput++;
+                    }
+
+                    uint64_t frameCost = budget ? cost(i) : 0;
+
+                    {
+                        std::unique_lock lock(mutex);
+                        slotFreed.wait(lock, [&] {
+                            if (abort) return true;
+                            if (i >= nextWrite + window) return false;
+                            return !budget || i == nextWrite || inFlight + frameCost <= budget;
+                        });
+                        if (abort) return;
+                        inFlight += frameCost;
+                    }
+
+                    auto frame = produce(i);
+
+                    {
+                        std::lock_guard lock(mutex);
+                        slots[i % window] = Slot{ std::move(frame), frameCost };
+                    }
+                    slotFilled.notify_all();
+                }
+            };
+
+            auto stop = [&]() {
+                {
+                    std::lock_guard lock(mutex);
+                    abort = true;
+                }
+                slotFreed.notify_all();
+            };
+
+            // Workers must not be left waiting for a slot if the writer bails out, or joining them would hang
+            struct StopOnExit {
+                decltype(stop)& fn;
+                ~StopOnExit() { fn(); }
+            };
+
+            std::vector<std::jthread> workers;
+            workers.reserve(jobs);
+            for (unsigned t = 0; t < jobs; ++t) workers.emplace_back(worker);
+            StopOnExit stopOnExit{ stop };
+
+            for (size_t i = 0; i < count; ++i) {
+                std::optional<Slot> slot;
+                {
+                    std::unique_lock lock(mutex);
+                    slotFilled.wait(lock, [&] { return slots[i % window].has_value(); });
+                    slot = std::move(slots[i % window]);
+                    slots[i % window].reset();
+                }
+
+                if (!slot->frame) return std::unexpected(slot->frame.error());
+
+                auto consumed = consume(i, *slot->frame);
+                if (!consumed) return consumed;
+
+                // Frees the frame before the budget it was counted against
+                uint64_t frameCost = slot->cost;
+                slot.reset();
+                {
+                    std::lock_guard lock(mutex);
+                    nextWrite = i + 1;
+                    inFlight -= frameCost;
+                }
+                slotFreed.notify_all();
+            }
+
+            return {};
+        }
     }
 
     std::expected<std::vector<std::byte>, Error> Compress(std::span<const std::byte> data, CompressionConfig config) {
@@ -27,12 +463,9 @@ namespace replicant::archive {
         size_t bound = ZSTD_compressBound(data.size());
         std::vector<std::byte> buffer(bound);
 
-        ZSTD_CCtx* cctx = ZSTD_createCCtx();
+        ZSTD_CCtx* cctx = ThreadCCtx(config);
         if (!cctx) return std::unexpected(Error{ ErrorCode::SystemError, "Failed to create ZSTD Context" });
 
-        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, config.level);
-        ZSTD_CCtx_setParameter(cctx, ZSTD_c_windowLog, config.windowLog);
-
         size_t cSize = ZSTD_compress2(
             cctx,
             buffer.data(),
@@ -41,32 +474,40 @@ namespace replicant::archive {
             data.size()
         );
 
-        ZSTD_freeCCtx(cctx);
-
         if (ZSTD_isError(cSize)) return std::unexpected(Error{ ErrorCode::SystemError, ZSTD_getErrorName(cSize) });
         buffer.resize(cSize);
         return buffer;
     }
 
+    std::expected<size_t, Error> DecompressInto(std::span<const std::byte> data, std::span<std::byte> output) {
+        if (data.empty()) return 0;
+
+        ZSTD_DCtx* dctx = ThreadDCtx();
+        if (!dctx) return std::unexpected(Error{ ErrorCode::SystemError, "Failed to create ZSTD DCtx" });
+
+        size_t dSize = ZSTD_decompressDCtx(dctx, output.data(), output.size(), data.data(), data.size());
+        if (ZSTD_isError(dSize)) {
+            return std::unexpected(Error{ ErrorCode::SystemError, ZSTD_getErrorName(dSize) });
+        }
+        return dSize;
+    }
 
     std::expected<std::vector<std::byte>, Error> Decompress(std::span<const std::byte> data, size_t decompressedSize) {
         if (data.empty()) return std::vector<std::byte>{};
 
         if (decompressedSize > 0) {
             std::vector<std::byte> output(decompressedSize);
-            size_t dSize = ZSTD_decompress(output.data(), decompressedSize, data.data(), data.size());
+            auto dSize = DecompressInto(data, output);
+            if (!dSize) return std::unexpected(dSize.error());
 
-            if (ZSTD_isError(dSize)) {
-                return std::unexpected(Error{ ErrorCode::SystemError, ZSTD_getErrorName(dSize) });
-            }
-            if (dSize != decompressedSize) {
+            if (*dSize != decompressedSize) {
                 return std::unexpected(Error{ ErrorCode::InvalidArguments, "Decompressed size mismatch" });
             }
             return output;
         }
 
         // Streaming decompression fallback if size is unknown (0)
-        ZSTD_DCtx* dctx = ZSTD_createDCtx();
+        ZSTD_DCtx* dctx = ThreadDCtx();
         if (!dctx) return std::unexpected(Error{ ErrorCode::SystemError, "Failed to create ZSTD DCtx" });
 
         std::vector<std::byte> output;
@@ -81,7 +522,6 @@ namespace replicant::archive {
             size_t const ret = ZSTD_decompressStream(dctx, &out, &input);
 
             if (ZSTD_isError(ret)) {
-                ZSTD_freeDCtx(dctx);
                 return std::unexpected(Error{ ErrorCode::SystemError, ZSTD_getErrorName(ret) });
             }
             output.insert(output.end(), outBuf.data(), outBuf.data() + out.pos);
@@ -94,18 +534,50 @@ namespace replicant::archive {
             size_t const ret = ZSTD_decompressStream(dctx, &out, &empty_input);
 
             if (ZSTD_isError(ret)) {
-                ZSTD_freeDCtx(dctx);
                 return std::unexpected(Error{ ErrorCode::SystemError, ZSTD_getErrorName(ret) });
             }
             output.insert(output.end(), outBuf.data(), outBuf.data() + out.pos);
             if (out.pos == 0) break;
         }
 
-        ZSTD_freeDCtx(dctx);
         return output;
 
     }
 
+    std::expected<uint64_t, Error> DecompressToSink(std::span<const std::byte> data, const DecompressSink& sink) {
+        if (data.empty()) return 0;
+
+        ZSTD_DCtx* dctx = ThreadDCtx();
+        if (!dctx) return std::unexpected(Error{ ErrorCode::SystemError, "Failed to create ZSTD DCtx" });
+
+        std::vector<std::byte> outBuf(DECOMPRESS_CHUNK_SIZE);
+        ZSTD_inBuffer input = { data.data(), data.size(), 0 };
+        uint64_t total = 0;
+
+        // Keep going after the input is consumed until zstd stops producing output, a full buffer may hide more
+        while (true) {
+            ZSTD_outBuffer out = { outBuf.data(), outBuf.size(), 0 };
+            size_t const ret = ZSTD_decompressStream(dctx, &out, &input);
+
+            if (ZSTD_isError(ret)) {
+                return std::unexpected(Error{ ErrorCode::SystemError, ZSTD_getErrorName(ret) });
+            }
+
+            if (out.pos > 0) {
+                auto sunk = sink(std::span<const std::byte>(outBuf.data(), out.pos));
+                if (!sunk) return std::unexpected(sunk.error());
+                total += out.pos;
+            }
+
+            if (input.pos == input.size && out.pos < out.size) {
+                if (ret != 0) return std::unexpected(Error{ ErrorCode::ParseError, "Truncated zstd frame" });
+                break;
+            }
+        }
+
+        return total;
+    }
+
     std::expected<size_t, Error> GetDecompressedSize(std::span<const std::byte> data) {
         unsigned long long size = ZSTD_getFrameContentSize(data.data(), data.size());
         if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN) {
@@ -118,151 +590,506 @@ namespace replicant::archive {
         const std::filesystem::path& outputPath,
         const std::vector<ArchiveInput>& inputs,
         BuildMode mode,
-        CompressionConfig config
+        CompressionConfig config,
+        const BuildOptions& options
     ) {
         ArchiveResult result;
         result.entries.reserve(inputs.size());
 
-        std::ofstream outArc(outputPath, std::ios::binary | std::ios::trunc);
-        if (!outArc) return std::unexpected(Error{ ErrorCode::IoError, "Failed to open output archive: " + outputPath.string() });
+        // Incremental builds read frames from the previous archive, so the new one cannot overwrite it in place
+        bool incremental = mode == BuildMode::SeparateFrames && options.cachePath.has_value();
+        std::filesystem::path writePath = outputPath;
+        if (incremental) writePath += ".tmp";
+
+        std::ofstream outArc(writePath, std::ios::binary | std::ios::trunc);
+        if (!outArc) return std::unexpected(Error{ ErrorCode::IoError, "Failed to open output archive: " + writePath.string() });
 
         if (mode == BuildMode::SingleStream) {
             // PRELOAD_DECOMPRESS (Type 0)
-            ZSTD_CStream* cstream = ZSTD_createCStream();
-            if (!cstream) return std::unexpected(Error{ ErrorCode::SystemError, "Failed to create ZSTD Stream" });
+            unsigned jobs = ResolveJobCount(config.jobs);
+
+            // Header sizes and on-disk size of every input, one open each
+            std::vector<std::expected<Pack::PackFileSizes, Error>> metadata(inputs.size());
+            ParallelFor(inputs.size(), jobs, [&](size_t i) {
+                metadata[i] = Pack::getFileSizes(inputs[i].fullPath);
+            });
 
+            // Offsets in the decompressed stream are known up front, so entries are recorded before compressing
             size_t totalPledgedSize = 0;
-            for (const auto& input : inputs) {
-                std::error_code ec;
-                uintmax_t physicalSize = std::filesystem::file_size(input.fullPath, ec);
-                if (ec) {
-                    ZSTD_freeCStream(cstream);
-                    return std::unexpected(Error{ ErrorCode::IoError, std::format("Could not determine file size for pledge: {}", input.fullPath.string()) });
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                if (!metadata[i]) {
+                    return std::unexpected(Error{ metadata[i].error().code, std::format("{}: {}", inputs[i].fullPath.string(), metadata[i].error().message) });
                 }
 
                 totalPledgedSize = align_to(totalPledgedSize, SECTOR_ALIGNMENT);
-                totalPledgedSize += physicalSize;
+
+                ArchiveEntryInfo entry;
+                entry.name = inputs[i].name;
+                entry.offset = totalPledgedSize; // Offset in DECOMPRESSED stream
+                entry.compressedSize = 0; // Type 0 uses 0 here
+                entry.packSerializedSize = metadata[i]->serializedSize;
+                entry.packResourceSize = metadata[i]->resourceSize;
+                result.entries.push_back(entry);
+
+                totalPledgedSize += metadata[i]->physicalSize;
             }
-            ZSTD_CCtx_setPledgedSrcSize(cstream, totalPledgedSize);
-            ZSTD_CCtx_setParameter(cstream, ZSTD_c_compressionLevel, config.level);
-            ZSTD_CCtx_setParameter(cstream, ZSTD_c_windowLog, config.windowLog);
 
-            std::vector<char> inBuf(STREAM_BUFFER_SIZE);
-            std::vector<char> outBuf(ZSTD_CStreamOutSize());
+            std::unique_ptr<ZSTD_CStream, decltype(&ZSTD_freeCStream)> cstream(ZSTD_createCStream(), ZSTD_freeCStream);
+            if (!cstream) return std::unexpected(Error{ ErrorCode::SystemError, "Failed to create ZSTD Stream" });
 
-            size_t currentUncompressedOffset = 0;
+            ZSTD_CCtx_setPledgedSrcSize(cstream.get(), totalPledgedSize);
+            ZSTD_CCtx_setParameter(cstream.get(), ZSTD_c_compressionLevel, config.level);
+            ZSTD_CCtx_setParameter(cstream.get(), ZSTD_c_windowLog, config.windowLog);
 
-            for (const auto& input : inputs) {
-                std::error_code ec;
-                uintmax_t physicalSize = std::filesystem::file_size(input.fullPath, ec);
-                if (ec) {
-                    return std::unexpected(Error{ ErrorCode::IoError, std::format("Could not determine file size for pledge: {}", input.fullPath.string()) });
-                }
-                auto sizesRes = replicant::Pack::getFileSizes(input.fullPath);
-                if (!sizesRes) { ZSTD_freeCStream(cstream); return std::unexpected(sizesRes.error()); }
-                auto sizes = *sizesRes;
-
-                size_t targetOffset = align_to(currentUncompressedOffset, SECTOR_ALIGNMENT);
-                size_t padding_needed = targetOffset - currentUncompressedOffset;
-                if (padding_needed > 0) {
-                    std::vector<char> zeros(padding_needed, 0);
-                    ZSTD_inBuffer zIn = { zeros.data(), zeros.size(), 0 };
-
-                    while (zIn.pos < zIn.size) {
-                        ZSTD_outBuffer zOut = { outBuf.data(), outBuf.size(), 0 };
-                        size_t ret = ZSTD_compressStream(cstream, &zOut, &zIn);
-                        if (ZSTD_isError(ret)) { ZSTD_freeCStream(cstream); return std::unexpected(Error{ ErrorCode::SystemError, ZSTD_getErrorName(ret) }); }
-                        outArc.write(outBuf.data(), zOut.pos);
+            // zstd's workers split the input into jobs but every job still uses windowLog, so the frame stays
+            // decodable by the game. Fails harmlessly (single-threaded) if zstd was built without threading
+            if (jobs > 1) {
+                ZSTD_CCtx_setParameter(cstream.get(), ZSTD_c_nbWorkers, static_cast<int>(jobs));
+            }
+
+            // Inputs and their alignment padding are read as one continuous stream, one chunk ahead of the compressor
+            struct StreamReader {
+                const std::vector<ArchiveInput>& inputs;
+                const std::vector<std::expected<Pack::PackFileSizes, Error>>& metadata;
+                size_t inputIndex = 0;
+                size_t streamOffset = 0;
+                uint64_t remainingInFile = 0;
+                std::ifstream file;
+
+                StreamReader(const std::vector<ArchiveInput>& inputs, const std::vector<std::expected<Pack::PackFileSizes, Error>>& metadata)
+                    : inputs(inputs), metadata(metadata) {}
+
+                std::expected<size_t, Error> fill(std::vector<char>& buffer) {
+                    size_t filled = 0;
+                    while (filled < buffer.size()) {
+                        if (remainingInFile == 0) {
+                            if (file.is_open()) file.close();
+                            if (inputIndex >= inputs.size()) break;
+
+                            size_t padding = align_to(streamOffset, SECTOR_ALIGNMENT) - streamOffset;
+                            if (padding > buffer.size() - filled) break;
+                            std::fill_n(buffer.data() + filled, padding, 0);
+                            filled += padding;
+                            streamOffset += padding;
+
+                            const auto& input = inputs[inputIndex++];
+                            file.open(input.fullPath, std::ios::binary);
+                            if (!file) return std::unexpected(Error{ ErrorCode::IoError, "Failed to read input: " + input.fullPath.string() });
+                            remainingInFile = metadata[inputIndex - 1]->physicalSize;
+                            continue;
+                        }
+
+                        size_t toRead = static_cast<size_t>(std::min<uint64_t>(remainingInFile, buffer.size() - filled));
+                        file.read(buffer.data() + filled, toRead);
+                        if (static_cast<size_t>(file.gcount()) != toRead) {
+                            return std::unexpected(Error{ ErrorCode::IoError, "Input changed size while archiving: " + inputs[inputIndex - 1].fullPath.string() });
+                        }
+                        filled += toRead;
+                        streamOffset += toRead;
+                        remainingInFile -= toRead;
                     }
-                    currentUncompressedOffset = targetOffset;
+                    return filled;
                 }
+            };
 
-                ArchiveEntryInfo entry;
-                entry.name = input.name;
-                entry.offset = currentUncompressedOffset; // Offset in DECOMPRESSED stream
-                entry.compressedSize = 0; // Type 0 uses 0 here
-                entry.packSerializedSize = sizes.serializedSize;
-                entry.packResourceSize = sizes.resourceSize;
-                result.entries.push_back(entry);
+            StreamReader reader(inputs, metadata);
+            std::array<std::vector<char>, 2> inBufs{ std::vector<char>(STREAM_BUFFER_SIZE), std::vector<char>(STREAM_BUFFER_SIZE) };
+            std::vector<char> outBuf(ZSTD_CStreamOutSize());
 
-                // 3. Feed File Content to Compressor
-                std::ifstream inFile(input.fullPath, std::ios::binary);
-                if (!inFile) { ZSTD_freeCStream(cstream); return std::unexpected(Error{ ErrorCode::IoError, "Failed to read input: " + input.fullPath.string() }); }
-
-                while (inFile) {
-                    inFile.read(inBuf.data(), inBuf.size());
-                    std::streamsize bytesRead = inFile.gcount();
-                    if (bytesRead == 0) break;
-
-                    ZSTD_inBuffer zIn = { inBuf.data(), static_cast<size_t>(bytesRead), 0 };
-                    while (zIn.pos < zIn.size) {
-                        ZSTD_outBuffer zOut = { outBuf.data(), outBuf.size(), 0 };
-                        size_t ret = ZSTD_compressStream(cstream, &zOut, &zIn);
-                        if (ZSTD_isError(ret)) { ZSTD_freeCStream(cstream); return std::unexpected(Error{ ErrorCode::SystemError, ZSTD_getErrorName(ret) }); }
-                        outArc.write(outBuf.data(), zOut.pos);
-                    }
+            auto pending = std::async(std::launch::async, &StreamReader::fill, &reader, std::ref(inBufs[0]));
+
+            for (size_t current = 0;; current ^= 1) {
+                auto filled = pending.get();
+                if (!filled) return std::unexpected(filled.error());
+
+                bool last = *filled == 0;
+                if (!last) {
+                    pending = std::async(std::launch::async, &StreamReader::fill, &reader, std::ref(inBufs[current ^ 1]));
                 }
-                currentUncompressedOffset += physicalSize;
-            }
 
-            // 4. Finish Stream
-            ZSTD_outBuffer zOut = { outBuf.data(), outBuf.size(), 0 };
-            size_t ret;
-            do {
-                zOut.pos = 0;
-                ret = ZSTD_endStream(cstream, &zOut);
-                if (ZSTD_isError(ret)) { ZSTD_freeCStream(cstream); return std::unexpected(Error{ ErrorCode::SystemError, ZSTD_getErrorName(ret) }); }
-                outArc.write(outBuf.data(), zOut.pos);
-            } while (ret > 0);
+                ZSTD_inBuffer zIn = { inBufs[current].data(), *filled, 0 };
+                ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_continue;
+                size_t ret;
+                do {
+                    ZSTD_outBuffer zOut = { outBuf.data(), outBuf.size(), 0 };
+                    ret = ZSTD_compressStream2(cstream.get(), &zOut, &zIn, mode);
+                    if (ZSTD_isError(ret)) return std::unexpected(Error{ ErrorCode::SystemError, ZSTD_getErrorName(ret) });
+                    outArc.write(outBuf.data(), zOut.pos);
+                } while (last ? ret > 0 : zIn.pos < zIn.size);
 
-            ZSTD_freeCStream(cstream);
+                if (last) break;
+            }
         }
         else {
             // STREAM (Type 1/2)
             // Compress each -> Align -> Record Offsets
-            for (const auto& input : inputs) {
-                auto infoRes = Pack::getFileSizes(input.fullPath);
-                if (!infoRes) {
-                    std::cerr << "Failed to get file sizes for " << input.fullPath << ": " << infoRes.error().toString() << "\n";
-                    return std::unexpected(infoRes.error());
-                };
-                auto info = *infoRes;
-
-                // Read file
-                auto fileBlob = ReadFile(input.fullPath);
-                if (!fileBlob) return std::unexpected(Error{ ErrorCode::IoError, "Failed to read " + input.fullPath.string() });
-
-                // Compress
-                auto compressRes = Compress(*fileBlob, config);
-                if (!compressRes) return std::unexpected(compressRes.error());
-
-                // Release input memory immediately
-                fileBlob->clear();
-                fileBlob->shrink_to_fit();
-
-                size_t cSize = compressRes->size();
-                size_t alignedSize = align_to(cSize, SECTOR_ALIGNMENT);
-                size_t padding = alignedSize - cSize;
+            unsigned jobs = std::min<size_t>(ResolveJobCount(config.jobs), std::max<size_t>(inputs.size(), 1));
 
-                ArchiveEntryInfo entry;
-                entry.name = input.name;
-                entry.offset = static_cast<uint64_t>(outArc.tellp());
-                entry.compressedSize = static_cast<uint32_t>(cSize);
-                entry.packSerializedSize = info.serializedSize;
-                entry.packResourceSize = info.resourceSize;
-                result.entries.push_back(entry);
+            std::optional<PreviousBuild> previous;
+            std::vector<FileStamp> stamps;
+            std::vector<uint64_t> hashes;
+            if (incremental) {
+                previous = LoadPreviousBuild(outputPath, *options.cachePath, config);
+                stamps.resize(inputs.size());
+                hashes.resize(inputs.size());
+                ParallelFor(inputs.size(), jobs, [&](size_t i) { stamps[i] = StampOf(inputs[i].fullPath); });
+            }
+
+            // Index of the earlier input with the same content, or SIZE_MAX
+            std::vector<size_t> duplicateOf;
+            if (options.deduplicate) {
+                auto dedupe = FindDuplicates(inputs, jobs, previous ? &*previous : nullptr, stamps);
+                if (!dedupe) return std::unexpected(dedupe.error());
+                duplicateOf = std::move(dedupe->duplicateOf);
+                hashes = std::move(dedupe->hashes);
+            }
+            bool hashedUpfront = options.deduplicate;
+
+            auto produce = [&](size_t i) -> std::expected<CompressedFrame, Error> {
+                if (hashedUpfront && duplicateOf[i] != SIZE_MAX) {
+                    CompressedFrame shared;
+                    shared.contentHash = hashes[i];
+                    shared.duplicateOf = duplicateOf[i];
+                    return shared;
+                }
+                if (previous) {
+                    if (auto reused = ReuseFrame(*previous, inputs[i], stamps[i])) return std::move(*reused);
+                }
+
+                auto frame = CompressFrame(inputs[i], config, incremental && !hashedUpfront);
+                if (frame && hashedUpfront) frame->contentHash = hashes[i];
+                return frame;
+            };
+
+            auto consume = [&](size_t i, const CompressedFrame& frame) {
+                if (frame.duplicateOf != SIZE_MAX) {
+                    ArchiveEntryInfo entry = result.entries[frame.duplicateOf];
+                    entry.name = inputs[i].name;
+                    result.dedupedEntries++;
+                    result.dedupedBytes += align_to(entry.compressedSize, SECTOR_ALIGNMENT);
+                    result.entries.push_back(std::move(entry));
+                }
+                else if (frame.streamed && !frame.reused) {
+                    auto streamed = StreamFrame(outArc, inputs[i], frame, config, result);
+                    if (!streamed) return streamed;
+                }
+                else {
+                    WriteFrame(outArc, inputs[i], frame, result);
+                    if (frame.reused) result.reusedFrames++;
+                }
+                if (incremental) hashes[i] = frame.contentHash;
+                return std::expected<void, Error>{};
+            };
+
+            // What a frame holds in memory until it is written: the compression buffer, or the copy of a reused frame.
+            // Shared frames hold nothing, and neither do those of large inputs, streamed or reused from the mapping
+            auto cost = [&](size_t i) -> uint64_t {
+                if (hashedUpfront && duplicateOf[i] != SIZE_MAX) return 0;
+
+                std::error_code ec;
+                uint64_t size = std::filesystem::file_size(inputs[i].fullPath, ec);
+                if (ec || size >= STREAMED_INPUT_SIZE) return 0;
+                return ZSTD_compressBound(static_cast<size_t>(size));
+            };
+
+            auto built = ProduceFramesInOrder(inputs.size(), jobs, options.maxMemory, cost, produce, consume);
+            if (!built) {
+                if (incremental) {
+                    std::error_code ec;
+                    outArc.close();
+                    std::filesystem::remove(writePath, ec);
+                }
+                return std::unexpected(built.error());
+            }
+
+            if (incremental) {
+                // The previous archive must be unmapped before it can be replaced
+                previous.reset();
+
+                outArc.close();
+                if (!outArc) return std::unexpected(Error{ ErrorCode::IoError, "Failed to write archive: " + writePath.string() });
+
+                std::error_code ec;
+                std::filesystem::rename(writePath, outputPath, ec);
+                if (ec) return std::unexpected(Error{ ErrorCode::IoError, "Failed to replace archive " + outputPath.string() + ": " + ec.message() });
+
+                BuildCache cache;
+                cache.level = config.level;
+                cache.windowLog = config.windowLog;
+                cache.entries.reserve(inputs.size());
+                for (size_t i = 0; i < inputs.size(); ++i) {
+                    const ArchiveEntryInfo& entry = result.entries[i];
+                    cache.entries.push_back({ entry.name, stamps[i].size, stamps[i].mtime, hashes[i],
+                        entry.offset, entry.compressedSize, entry.packSerializedSize, entry.packResourceSize });
+                }
+
+                auto written = WriteCache(outputPath, *options.cachePath, cache);
+                if (!written) return std::unexpected(written.error());
+            }
+        }
+
+        return result;
+    }
+    std::expected<ArchiveResult, Error> Append(
+        const std::filesystem::path& archivePath,
+        const std::vector<ArchiveInput>& inputs,
+        CompressionConfig config,
+        const AppendOptions& options
+    ) {
+        std::error_code ec;
+        uint64_t originalSize = std::filesystem::file_size(archivePath, ec);
+        if (ec) return std::unexpected(Error{ ErrorCode::IoError, "Failed to open archive to append to: " + archivePath.string() });
+
+        unsigned jobs = std::min<size_t>(ResolveJobCount(config.jobs), std::max<size_t>(inputs.size(), 1));
+
+        std::optional<BuildCache> cache;
+        if (options.cachePath) {
+            cache = LoadValidCache(archivePath, *options.cachePath);
+            if (cache && !CacheMatchesConfig(*cache, config)) cache.reset();
+        }
+
+        // An input keeps its frame if the cache shows it unchanged: same stamp, or same size and content
+        std::vector<FileStamp> stamps(inputs.size());
+        std::vector<uint64_t> hashes(inputs.size());
+        std::vector<const BuildCacheEntry*> kept(inputs.size(), nullptr);
+        ParallelFor(inputs.size(), jobs, [&](size_t i) {
+            stamps[i] = StampOf(inputs[i].fullPath);
+            if (!cache) return;
+
+            const BuildCacheEntry* entry = cache->find(inputs[i].name);
+            if (!entry || entry->fileSize != stamps[i].size) return;
+            if (entry->offset + entry->compressedSize > originalSize) return;
+
+            if (entry->mtime != stamps[i].mtime) {
+                auto file = MappedFile::Open(inputs[i].fullPath);
+                if (!file || hash64(file->data()) != entry->contentHash) return;
+            }
+            kept[i] = entry;
+            hashes[i] = entry->contentHash;
+        });
+
+        std::vector<size_t> changed;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (!kept[i]) changed.push_back(i);
+        }
 
-                // Write compressed data
-                outArc.write(reinterpret_cast<const char*>(compressRes->data()), cSize);
+        ArchiveResult appended;
+        appended.entries.reserve(changed.size());
 
-                // Write padding
-                if (padding > 0) {
-                    std::vector<char> pad(padding, 0);
-                    outArc.write(pad.data(), padding);
+        if (!changed.empty()) {
+            // Opened for update, so the existing frames are left untouched
+            std::ofstream outArc(archivePath, std::ios::binary | std::ios::in | std::ios::out);
+            if (!outArc) return std::unexpected(Error{ ErrorCode::IoError, "Failed to open archive to append to: " + archivePath.string() });
+            outArc.seekp(0, std::ios::end);
+
+            // Anything that left the archive off a sector boundary is padded over, so appended frames stay aligned
+            size_t padding = align_to(static_cast<size_t>(originalSize), SECTOR_ALIGNMENT) - static_cast<size_t>(originalSize);
+            if (padding > 0) {
+                std::array<char, SECTOR_ALIGNMENT> pad{};
+                outArc.write(pad.data(), padding);
+            }
+
+            bool hashContent = options.cachePath.has_value();
+            unsigned frameJobs = static_cast<unsigned>(std::min<size_t>(jobs, changed.size()));
+
+            auto produce = [&](size_t k) {
+                return CompressFrame(inputs[changed[k]], config, hashContent);
+            };
+
+            auto consume = [&](size_t k, const CompressedFrame& frame) {
+                size_t i = changed[k];
+                if (frame.streamed) {
+                    auto streamed = StreamFrame(outArc, inputs[i], frame, config, appended);
+                    if (!streamed) return streamed;
+                }
+                else {
+                    WriteFrame(outArc, inputs[i], frame, appended);
                 }
+                hashes[i] = frame.contentHash;
+                return std::expected<void, Error>{};
+            };
+
+            auto cost = [&](size_t k) -> uint64_t {
+                std::error_code sizeEc;
+                uint64_t size = std::filesystem::file_size(inputs[changed[k]].fullPath, sizeEc);
+                if (sizeEc || size >= STREAMED_INPUT_SIZE) return 0;
+                return ZSTD_compressBound(static_cast<size_t>(size));
+            };
+
+            auto built = ProduceFramesInOrder(changed.size(), frameJobs, options.maxMemory, cost, produce, consume);
+            outArc.close();
+            if (!built || !outArc) {
+                std::filesystem::resize_file(archivePath, originalSize, ec);
+                if (!built) return std::unexpected(built.error());
+                return std::unexpected(Error{ ErrorCode::IoError, "Failed to write archive: " + archivePath.string() });
             }
         }
 
+        ArchiveResult result;
+        result.entries.reserve(inputs.size());
+        size_t nextAppended = 0;
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            if (kept[i]) {
+                const BuildCacheEntry* entry = kept[i];
+                result.entries.push_back({ inputs[i].name, entry->offset, entry->compressedSize, entry->packSerializedSize, entry->packResourceSize });
+                result.reusedFrames++;
+            }
+            else {
+                result.entries.push_back(std::move(appended.entries[nextAppended++]));
+            }
+        }
+
+        if (options.cachePath) {
+            // Entries of files not passed this time still describe frames in the archive, so they are kept
+            BuildCache updated;
+            updated.level = config.level;
+            updated.windowLog = config.windowLog;
+            if (cache) updated.entries = cache->entries;
+
+            for (size_t i = 0; i < inputs.size(); ++i) {
+                const ArchiveEntryInfo& entry = result.entries[i];
+                BuildCacheEntry cached{ entry.name, stamps[i].size, stamps[i].mtime, hashes[i],
+                    entry.offset, entry.compressedSize, entry.packSerializedSize, entry.packResourceSize };
+
+                const BuildCacheEntry* previous = cache ? cache->find(entry.name) : nullptr;
+                if (previous) updated.entries[previous - cache->entries.data()] = std::move(cached);
+                else updated.entries.push_back(std::move(cached));
+            }
+
+            auto written = WriteCache(archivePath, *options.cachePath, updated);
+            if (!written) return std::unexpected(written.error());
+        }
+
         return result;
     }
-}
\ No newline at end of file
+
+    std::expected<CompactResult, Error> Compact(
+        const std::filesystem::path& archivePath,
+        TpArchiveFileParam& index,
+        uint8_t archiveIndex,
+        const std::optional<std::filesystem::path>& cachePath
+    ) {
+        std::error_code ec;
+        uint64_t originalSize = std::filesystem::file_size(archivePath, ec);
+        if (ec) return std::unexpected(Error{ ErrorCode::IoError, "Failed to open archive to compact: " + archivePath.string() });
+
+        CompactResult result;
+        result.archivePath = archivePath;
+        result.compactedPath = archivePath;
+        result.compactedPath += ".tmp";
+
+        std::optional<BuildCache> cache;
+        if (cachePath) {
+            cache = LoadValidCache(archivePath, *cachePath);
+            if (cache) result.cachePath = *cachePath;
+        }
+
+        // Entries sharing a frame share its new offset as well
+        std::vector<FrameRange> frames = DeadFrames::FramesOf(index, archiveIndex);
+        std::vector<uint64_t> newOffsets(frames.size());
+
+        auto fail = [&](Error error) -> std::expected<CompactResult, Error> {
+            DiscardCompact(result);
+            return std::unexpected(std::move(error));
+        };
+
+        {
+            std::ofstream outArc(result.compactedPath, std::ios::binary | std::ios::trunc);
+            if (!outArc) return std::unexpected(Error{ ErrorCode::IoError, "Failed to open output archive: " + result.compactedPath.string() });
+
+            if (!frames.empty()) {
+                // Scoped so the archive is unmapped before it is replaced
+                auto archive = MappedFile::Open(archivePath);
+                if (!archive) {
+                    outArc.close();
+                    return fail(Error{ ErrorCode::IoError, "Failed to read " + archivePath.string() });
+                }
+
+                std::array<char, SECTOR_ALIGNMENT> pad{};
+                for (size_t k = 0; k < frames.size(); ++k) {
+                    const FrameRange& frame = frames[k];
+                    if (frame.offset + frame.size > archive->size()) {
+                        outArc.close();
+                        return fail(Error{ ErrorCode::ParseError, std::format("Frame at {} runs past the end of {}", frame.offset, archivePath.string()) });
+                    }
+
+                    newOffsets[k] = static_cast<uint64_t>(outArc.tellp());
+                    outArc.write(reinterpret_cast<const char*>(archive->data().data() + frame.offset), frame.size);
+                    outArc.write(pad.data(), align_to(frame.size, SECTOR_ALIGNMENT) - frame.size);
+                }
+            }
+
+            outArc.close();
+            if (!outArc) return fail(Error{ ErrorCode::IoError, "Failed to write archive: " + result.compactedPath.string() });
+        }
+
+        // The new offset of the frame that started at `offset`, if it was kept
+        auto remap = [&](uint64_t offset) -> std::optional<uint64_t> {
+            auto it = std::lower_bound(frames.begin(), frames.end(), offset,
+                [](const FrameRange& f, uint64_t value) { return f.offset < value; });
+            if (it == frames.end() || it->offset != offset) return std::nullopt;
+            return newOffsets[it - frames.begin()];
+        };
+
+        if (cache) {
+            // Cached frames that were not kept are gone, their inputs get compressed again next time
+            std::vector<BuildCacheEntry> entries;
+            entries.reserve(cache->entries.size());
+            for (auto& entry : cache->entries) {
+                auto offset = remap(entry.offset);
+                if (!offset) continue;
+                entry.offset = *offset;
+                entries.push_back(std::move(entry));
+            }
+            cache->entries = std::move(entries);
+
+            // Stamped against the compacted archive, whose size and mtime survive the rename. If it cannot be
+            // written the cache is dropped on commit rather than failing the compaction
+            std::filesystem::path compactedCache = *cachePath;
+            compactedCache += ".tmp";
+            result.cacheRemapped = WriteCache(result.compactedPath, compactedCache, *cache).has_value();
+            if (!result.cacheRemapped) std::filesystem::remove(compactedCache, ec);
+        }
+
+        for (auto& entry : index.fileEntries) {
+            if (entry.archiveIndex == archiveIndex) entry.rawOffset = *remap(entry.rawOffset);
+        }
+
+        result.frames = frames.size();
+        result.reclaimedBytes = originalSize - StampOf(result.compactedPath).size;
+        return result;
+    }
+
+    std::expected<void, Error> CommitCompact(CompactResult& compacted) {
+        std::error_code ec;
+        std::filesystem::rename(compacted.compactedPath, compacted.archivePath, ec);
+        if (ec) {
+            DiscardCompact(compacted);
+            return std::unexpected(Error{ ErrorCode::IoError, "Failed to replace archive " + compacted.archivePath.string() + ": " + ec.message() });
+        }
+
+        if (compacted.cachePath) {
+            std::filesystem::path compactedCache = *compacted.cachePath;
+            compactedCache += ".tmp";
+
+            if (compacted.cacheRemapped) std::filesystem::rename(compactedCache, *compacted.cachePath, ec);
+            if (!compacted.cacheRemapped || ec) {
+                // Still describes the old layout, and there is no undoing the archive rename
+                std::filesystem::remove(compactedCache, ec);
+                std::filesystem::remove(*compacted.cachePath, ec);
+                compacted.cacheDropped = true;
+            }
+        }
+        return {};
+    }
+
+    void DiscardCompact(const CompactResult& compacted) {
+        std::error_code ec;
+        std::filesystem::remove(compacted.compactedPath, ec);
+        if (compacted.cachePath) {
+            std::filesystem::path compactedCache = *compacted.cachePath;
+            compactedCache += ".tmp";
+            std::filesystem::remove(compactedCache, ec);
+        }
+    }
+}
@@ -0,0 +1,189 @@
+#include "replicant/arcReader.h"
+#include "replicant/arc.h"
+#include "replicant/bxon.h"
+
+#include <algorithm>
+
+namespace replicant {
+
+    std::expected<ArcReader, Error> ArcReader::Open(const std::filesystem::path& indexPath) {
+        auto compressed = MappedFile::Open(indexPath);
+        if (!compressed) {
+            return std::unexpected(Error{ ErrorCode::IoError, compressed.error().message });
+        }
+
+        size_t dSize = 0;
+        if (auto sz = archive::GetDecompressedSize(compressed->data())) dSize = *sz;
+
+        auto bxonData = archive::Decompress(compressed->data(), dSize);
+        if (!bxonData) return std::unexpected(bxonData.error());
+
+        auto bxon = ParseBxon(*bxonData);
+        if (!bxon) return std::unexpected(bxon.error());
+
+        auto& [info, payload] = *bxon;
+        if (info.assetType != "tpArchiveFileParam") {
+            return std::unexpected(Error{ ErrorCode::ParseError, "Index is not a tpArchiveFileParam: " + info.assetType });
+        }
+
+        auto params = TpArchiveFileParam::Deserialize(payload);
+        if (!params) return std::unexpected(params.error());
+
+        ArcReader reader;
+        reader.archiveDir_ = indexPath.parent_path();
+        reader.params_ = std::move(*params);
+        reader.params_.buildLookupIndex();
+        reader.archives_.resize(reader.params_.archiveEntries.size());
+        return reader;
+    }
+
+    std::expected<ArcReader::ArchiveState*, Error> ArcReader::archive(uint8_t archiveIndex, bool preload) {
+        if (archiveIndex >= archives_.size()) {
+            return std::unexpected(Error{ ErrorCode::ParseError, "Archive index out of range: " + std::to_string(archiveIndex) });
+        }
+
+        ArchiveState& state = archives_[archiveIndex];
+        const ArchiveEntry& meta = params_.archiveEntries[archiveIndex];
+
+        if (preload && state.decompressed) return &state;
+
+        if (!state.file) {
+            auto file = MappedFile::Open(archiveDir_ / meta.filename);
+            if (!file) {
+                return std::unexpected(Error{ ErrorCode::IoError, file.error().message });
+            }
+            state.file = std::move(*file);
+        }
+
+        if (preload && !state.decompressed) {
+            size_t dSize = 0;
+            if (auto sz = archive::GetDecompressedSize(state.file->data())) dSize = *sz;
+
+            auto blob = archive::Decompress(state.file->data(), dSize);
+            if (!blob) return std::unexpected(blob.error());
+            state.blob = std::move(*blob);
+            state.decompressed = true;
+
+            // The compressed archive is no longer needed once the blob exists
+            state.file.reset();
+
+            for (const auto& entry : params_.fileEntries) {
+                if (entry.archiveIndex == archiveIndex) state.sortedOffsets.push_back(entry.rawOffset);
+            }
+            std::sort(state.sortedOffsets.begin(), state.sortedOffsets.end());
+        }
+
+        return &state;
+    }
+
+    std::expected<std::span<const std::byte>, Error> ArcReader::read(const FileEntry& entry) {
+        if (entry.archiveIndex >= params_.archiveEntries.size()) {
+            return std::unexpected(Error{ ErrorCode::ParseError, "Archive index out of range for " + entry.name });
+        }
+
+        bool preload = params_.archiveEntries[entry.archiveIndex].loadType == ArchiveLoadType::PRELOAD_DECOMPRESS;
+
+        auto state = archive(entry.archiveIndex, preload);
+        if (!state) return std::unexpected(state.error());
+
+        if (preload) {
+            const auto& blob = (*state)->blob;
+            const auto& offsets = (*state)->sortedOffsets;
+
+            // Preload entries store no size, they end where the next one in the blob starts
+            uint64_t size = entry.size;
+            if (size == 0) {
+                auto next = std::upper_bound(offsets.begin(), offsets.end(), entry.rawOffset);
+                size = (next != offsets.end() ? *next : blob.size()) - entry.rawOffset;
+            }
+
+            if (entry.rawOffset + size > blob.size()) {
+                return std::unexpected(Error{ ErrorCode::ParseError, "File " + entry.name + " out of bounds in " + params_.archiveEntries[entry.archiveIndex].filename });
+            }
+            return std::span<const std::byte>(blob.data() + entry.rawOffset, static_cast<size_t>(size));
+        }
+
+        auto data = (*state)->file->data();
+        if (entry.rawOffset + entry.size > data.size()) {
+            return std::unexpected(Error{ ErrorCode::ParseError, "Frame for " + entry.name + " out of bounds in " + params_.archiveEntries[entry.archiveIndex].filename });
+        }
+
+        auto frame = data.subspan(static_cast<size_t>(entry.rawOffset), entry.size);
+
+        auto dSize = archive::GetDecompressedSize(frame);
+        if (!dSize) {
+            auto decompressed = archive::Decompress(frame);
+            if (!decompressed) return std::unexpected(decompressed.error());
+
+            scratch_ = std::move(*decompressed);
+            return std::span<const std::byte>(scratch_);
+        }
+
+        // The scratch buffer only ever grows, so repeated reads reuse its allocation
+        if (scratch_.size() < *dSize) scratch_.resize(*dSize);
+
+        auto written = archive::DecompressInto(frame, std::span<std::byte>(scratch_.data(), *dSize));
+        if (!written) return std::unexpected(written.error());
+
+        return std::span<const std::byte>(scratch_.data(), *written);
+    }
+
+    std::expected<std::span<const std::byte>, Error> ArcReader::read(const std::string& name) {
+        const FileEntry* entry = find(name);
+        if (!entry) {
+            return std::unexpected(Error{ ErrorCode::InvalidArguments, "File not found in index: " + name });
+        }
+        return read(*entry);
+    }
+
+    std::expected<void, Error> ArcReader::extractTo(const FileEntry& entry, const std::filesystem::path& outPath) {
+        bool preload = entry.archiveIndex < params_.archiveEntries.size()
+            && params_.archiveEntries[entry.archiveIndex].loadType == ArchiveLoadType::PRELOAD_DECOMPRESS;
+
+        // Preload files are slices of the cached blob already, STREAM frames are decompressed straight to disk
+        std::span<const std::byte> frame;
+        if (preload) {
+            auto data = read(entry);
+            if (!data) return std::unexpected(data.error());
+            frame = *data;
+        }
+        else {
+            auto state = archive(entry.archiveIndex, false);
+            if (!state) return std::unexpected(state.error());
+
+            auto data = (*state)->file->data();
+            if (entry.rawOffset + entry.size > data.size()) {
+                return std::unexpected(Error{ ErrorCode::ParseError, "Frame for " + entry.name + " out of bounds in " + params_.archiveEntries[entry.archiveIndex].filename });
+            }
+            frame = data.subspan(static_cast<size_t>(entry.rawOffset), entry.size);
+        }
+
+        uint64_t expectedSize = frame.size();
+        if (!preload) {
+            auto dSize = archive::GetDecompressedSize(frame);
+            expectedSize = dSize ? *dSize : 0;
+        }
+
+        auto sink = FileSink::Create(outPath, expectedSize);
+        if (!sink) return std::unexpected(Error{ ErrorCode::IoError, sink.error().message });
+
+        auto toSink = [&](std::span<const std::byte> chunk) -> std::expected<void, Error> {
+            auto written = sink->write(chunk);
+            if (!written) return std::unexpected(Error{ ErrorCode::IoError, written.error().message });
+            return {};
+        };
+
+        if (preload) {
+            auto written = toSink(frame);
+            if (!written) return written;
+        }
+        else {
+            auto decompressed = archive::DecompressToSink(frame, toSink);
+            if (!decompressed) return std::unexpected(decompressed.error());
+        }
+
+        auto closed = sink->close();
+        if (!closed) return std::unexpected(Error{ ErrorCode::IoError, closed.error().message });
+        return {};
+    }
+}
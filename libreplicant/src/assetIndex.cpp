@@ -0,0 +1,381 @@
+#include "replicant/assetIndex.h"
+#include "replicant/core/reader.h"
+#include "replicant/core/writer.h"
+#include "replicant/core/parallel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace replicant {
+
+    namespace {
+        constexpr char IndexMagic[4] = { 'L', 'T', 'I', 'X' };
+        constexpr uint32_t IndexVersion = 1;
+
+#pragma pack(push, 1)
+        struct RawIndexHeader {
+            char     magic[4];
+            uint32_t version;
+            uint32_t packCount;
+            uint32_t offsetToPacks;
+            uint32_t entryLookupCount;
+            uint32_t offsetToEntryLookup;
+            uint32_t importLookupCount;
+            uint32_t offsetToImportLookup;
+        };
+
+        struct RawIndexPack {
+            uint32_t offsetToPath;
+            uint32_t flags;
+            int64_t  mtime;
+            uint64_t fileSize;
+            uint32_t entryCount;
+            uint32_t offsetToEntries;
+            uint32_t importCount;
+            uint32_t offsetToImports;
+        };
+
+        struct RawIndexEntry {
+            uint32_t nameHash;
+            uint32_t offsetToName;
+            uint32_t serializedSize;
+            uint32_t resourceSize;
+        };
+
+        struct RawIndexImport {
+            uint32_t pathHash;
+            uint32_t offsetToPath;
+        };
+
+        struct RawIndexLookup {
+            uint32_t hash;
+            uint32_t packIndex;
+        };
+#pragma pack(pop)
+
+        constexpr uint32_t PackFlagIsPack = 1;
+
+        template <typename T>
+        std::span<const T> ViewTable(Reader& reader, const uint32_t& offsetField, uint32_t count) {
+            if (count == 0) return {};
+            reader.seek(reader.getOffsetPtr(offsetField));
+            return reader.viewArray<T>(count);
+        }
+
+        std::string NormalizeRelative(const std::filesystem::path& path, const std::filesystem::path& root) {
+            return path.lexically_relative(root).generic_string();
+        }
+
+        AssetIndexPack ProbePack(const std::filesystem::path& path) {
+            AssetIndexPack pack;
+
+            auto probe = Pack::Probe(path);
+            if (!probe) return pack;
+
+            pack.isPack = true;
+            pack.imports = std::move(probe->imports);
+            pack.entries.reserve(probe->files.size());
+            for (auto& file : probe->files) {
+                pack.entries.push_back({ file.nameHash, std::move(file.name), file.serializedSize, file.resourceSize });
+            }
+            return pack;
+        }
+    }
+
+    AssetIndex AssetIndex::DeserializeInternal(std::span<const std::byte> data) {
+        Reader reader(data);
+        const auto* header = reader.view<RawIndexHeader>();
+
+        if (std::memcmp(header->magic, IndexMagic, 4) != 0) {
+            throw ReaderException("Invalid asset index magic");
+        }
+        if (header->version != IndexVersion) {
+            throw ReaderException("Unsupported asset index version");
+        }
+
+        AssetIndex index;
+        auto rawPacks = ViewTable<RawIndexPack>(reader, header->offsetToPacks, header->packCount);
+        index.packs.reserve(rawPacks.size());
+
+        for (const auto& rawPack : rawPacks) {
+            AssetIndexPack& pack = index.packs.emplace_back();
+            pack.path = reader.readStringRelative(rawPack.offsetToPath);
+            pack.mtime = rawPack.mtime;
+            pack.fileSize = rawPack.fileSize;
+            pack.isPack = (rawPack.flags & PackFlagIsPack) != 0;
+
+            auto rawEntries = ViewTable<RawIndexEntry>(reader, rawPack.offsetToEntries, rawPack.entryCount);
+            pack.entries.reserve(rawEntries.size());
+            for (const auto& rawEntry : rawEntries) {
+                pack.entries.push_back({ rawEntry.nameHash, reader.readStringRelative(rawEntry.offsetToName),
+                    rawEntry.serializedSize, rawEntry.resourceSize });
+            }
+
+            auto rawImports = ViewTable<RawIndexImport>(reader, rawPack.offsetToImports, rawPack.importCount);
+            pack.imports.reserve(rawImports.size());
+            for (const auto& rawImport : rawImports) {
+                pack.imports.push_back({ rawImport.pathHash, reader.readStringRelative(rawImport.offsetToPath) });
+            }
+        }
+
+        auto readLookup = [&](const uint32_t& offsetField, uint32_t count, std::vector<Lookup>& out) {
+            auto rawLookups = ViewTable<RawIndexLookup>(reader, offsetField, count);
+            out.reserve(rawLookups.size());
+            for (const auto& rawLookup : rawLookups) {
+                if (rawLookup.packIndex >= index.packs.size()) {
+                    throw ReaderException("Asset index lookup points past the pack table");
+                }
+                out.push_back({ rawLookup.hash, rawLookup.packIndex });
+            }
+        };
+        readLookup(header->offsetToEntryLookup, header->entryLookupCount, index.entryLookup_);
+        readLookup(header->offsetToImportLookup, header->importLookupCount, index.importLookup_);
+
+        return index;
+    }
+
+    std::expected<AssetIndex, Error> AssetIndex::Deserialize(std::span<const std::byte> data) {
+        try {
+            return DeserializeInternal(data);
+        }
+        catch (const ReaderException& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
+        }
+    }
+
+    std::vector<std::byte> AssetIndex::SerializeInternal() const {
+        Writer writer;
+        StringPool pool;
+
+        writer.write(IndexMagic, 4);
+        writer.write<uint32_t>(IndexVersion);
+        writer.write<uint32_t>(static_cast<uint32_t>(packs.size()));
+        size_t tokenPacks = writer.reserveOffset();
+        writer.write<uint32_t>(static_cast<uint32_t>(entryLookup_.size()));
+        size_t tokenEntryLookup = writer.reserveOffset();
+        writer.write<uint32_t>(static_cast<uint32_t>(importLookup_.size()));
+        size_t tokenImportLookup = writer.reserveOffset();
+
+        struct PackTokens {
+            size_t entries;
+            size_t imports;
+        };
+        std::vector<PackTokens> packTokens;
+        packTokens.reserve(packs.size());
+
+        writer.align(8);
+        writer.satisfyOffsetHere(tokenPacks);
+        for (const auto& pack : packs) {
+            pool.add(pack.path, writer.reserveOffset());
+            writer.write<uint32_t>(pack.isPack ? PackFlagIsPack : 0);
+            writer.write<int64_t>(pack.mtime);
+            writer.write<uint64_t>(pack.fileSize);
+            writer.write<uint32_t>(static_cast<uint32_t>(pack.entries.size()));
+            size_t tokenEntries = writer.reserveOffset();
+            writer.write<uint32_t>(static_cast<uint32_t>(pack.imports.size()));
+            size_t tokenImports = writer.reserveOffset();
+            packTokens.push_back({ tokenEntries, tokenImports });
+        }
+
+        for (size_t i = 0; i < packs.size(); ++i) {
+            if (!packs[i].entries.empty()) {
+                writer.satisfyOffsetHere(packTokens[i].entries);
+                for (const auto& entry : packs[i].entries) {
+                    writer.write<uint32_t>(entry.nameHash);
+                    pool.add(entry.name, writer.reserveOffset());
+                    writer.write<uint32_t>(entry.serializedSize);
+                    writer.write<uint32_t>(entry.resourceSize);
+                }
+            }
+            if (!packs[i].imports.empty()) {
+                writer.satisfyOffsetHere(packTokens[i].imports);
+                for (const auto& import : packs[i].imports) {
+                    writer.write<uint32_t>(import.pathHash);
+                    pool.add(import.path, writer.reserveOffset());
+                }
+            }
+        }
+
+        writer.satisfyOffsetHere(tokenEntryLookup);
+        for (const auto& lookup : entryLookup_) {
+            writer.write(RawIndexLookup{ lookup.hash, lookup.packIndex });
+        }
+
+        writer.satisfyOffsetHere(tokenImportLookup);
+        for (const auto& lookup : importLookup_) {
+            writer.write(RawIndexLookup{ lookup.hash, lookup.packIndex });
+        }
+
+        pool.flush(writer);
+        return writer.buffer();
+    }
+
+    std::expected<std::vector<std::byte>, Error> AssetIndex::Serialize() const {
+        try {
+            return SerializeInternal();
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::SystemError, ex.what() });
+        }
+    }
+
+    void AssetIndex::buildLookups() {
+        entryLookup_.clear();
+        importLookup_.clear();
+
+        for (uint32_t i = 0; i < packs.size(); ++i) {
+            for (const auto& entry : packs[i].entries) {
+                entryLookup_.push_back({ fnv1_32(entry.name), i });
+            }
+            for (const auto& import : packs[i].imports) {
+                importLookup_.push_back({ fnv1_32(import.path), i });
+            }
+        }
+
+        auto byKey = [](const Lookup& a, const Lookup& b) {
+            return a.hash != b.hash ? a.hash < b.hash : a.packIndex < b.packIndex;
+        };
+        auto sameKey = [](const Lookup& a, const Lookup& b) {
+            return a.hash == b.hash && a.packIndex == b.packIndex;
+        };
+
+        std::sort(entryLookup_.begin(), entryLookup_.end(), byKey);
+        entryLookup_.erase(std::unique(entryLookup_.begin(), entryLookup_.end(), sameKey), entryLookup_.end());
+        std::sort(importLookup_.begin(), importLookup_.end(), byKey);
+        importLookup_.erase(std::unique(importLookup_.begin(), importLookup_.end(), sameKey), importLookup_.end());
+    }
+
+    std::expected<AssetIndexUpdateStats, Error> AssetIndex::Update(const std::filesystem::path& root, unsigned jobs) {
+        struct Candidate {
+            std::filesystem::path fullPath;
+            std::string relPath;
+            int64_t mtime;
+            uint64_t fileSize;
+        };
+
+        std::vector<Candidate> candidates;
+        try {
+            for (const auto& dirEntry : std::filesystem::recursive_directory_iterator(root)) {
+                if (!dirEntry.is_regular_file()) continue;
+                if (dirEntry.path().extension() == std::filesystem::path(DefaultFileName).extension()) continue;
+
+                candidates.push_back({
+                    dirEntry.path(),
+                    NormalizeRelative(dirEntry.path(), root),
+                    static_cast<int64_t>(dirEntry.last_write_time().time_since_epoch().count()),
+                    static_cast<uint64_t>(dirEntry.file_size())
+                });
+            }
+        }
+        catch (const std::filesystem::filesystem_error& ex) {
+            return std::unexpected(Error{ ErrorCode::IoError, ex.what() });
+        }
+
+        std::unordered_map<std::string_view, size_t> previous;
+        previous.reserve(packs.size());
+        for (size_t i = 0; i < packs.size(); ++i) {
+            previous.emplace(packs[i].path, i);
+        }
+
+        AssetIndexUpdateStats stats;
+        std::vector<AssetIndexPack> updated(candidates.size());
+        std::vector<size_t> reuseFrom(candidates.size(), SIZE_MAX);
+        std::vector<size_t> toProbe;
+        std::vector<char> kept(packs.size(), 0);
+
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            auto it = previous.find(candidates[i].relPath);
+            if (it != previous.end()) {
+                kept[it->second] = 1;
+                const AssetIndexPack& old = packs[it->second];
+                if (old.mtime == candidates[i].mtime && old.fileSize == candidates[i].fileSize) {
+                    reuseFrom[i] = it->second;
+                    continue;
+                }
+            }
+            toProbe.push_back(i);
+        }
+
+        // Only moved once all lookups are done, the map keys view the old paths
+        previous.clear();
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (reuseFrom[i] != SIZE_MAX) {
+                updated[i] = std::move(packs[reuseFrom[i]]);
+                stats.reused++;
+            }
+        }
+
+        for (char k : kept) {
+            if (!k) stats.removed++;
+        }
+
+        try {
+            ParallelFor(toProbe.size(), jobs, [&](size_t job) {
+                size_t i = toProbe[job];
+                updated[i] = ProbePack(candidates[i].fullPath);
+            });
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::SystemError, ex.what() });
+        }
+        stats.scanned = toProbe.size();
+
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            updated[i].path = std::move(candidates[i].relPath);
+            updated[i].mtime = candidates[i].mtime;
+            updated[i].fileSize = candidates[i].fileSize;
+        }
+
+        std::sort(updated.begin(), updated.end(), [](const AssetIndexPack& a, const AssetIndexPack& b) {
+            return a.path < b.path;
+            });
+
+        packs = std::move(updated);
+        buildLookups();
+        return stats;
+    }
+
+    std::vector<const AssetIndexPack*> AssetIndex::findEntry(std::string_view name) const {
+        std::vector<const AssetIndexPack*> result;
+
+        Lookup key{ fnv1_32(name), 0 };
+        auto it = std::lower_bound(entryLookup_.begin(), entryLookup_.end(), key, [](const Lookup& a, const Lookup& b) {
+            return a.hash < b.hash;
+            });
+
+        for (; it != entryLookup_.end() && it->hash == key.hash; ++it) {
+            const AssetIndexPack& pack = packs[it->packIndex];
+            for (const auto& entry : pack.entries) {
+                if (entry.name == name) {
+                    result.push_back(&pack);
+                    break;
+                }
+            }
+        }
+        return result;
+    }
+
+    std::vector<const AssetIndexPack*> AssetIndex::findImporters(std::string_view path) const {
+        std::vector<const AssetIndexPack*> result;
+
+        Lookup key{ fnv1_32(path), 0 };
+        auto it = std::lower_bound(importLookup_.begin(), importLookup_.end(), key, [](const Lookup& a, const Lookup& b) {
+            return a.hash < b.hash;
+            });
+
+        for (; it != importLookup_.end() && it->hash == key.hash; ++it) {
+            const AssetIndexPack& pack = packs[it->packIndex];
+            for (const auto& import : pack.imports) {
+                if (import.path == path) {
+                    result.push_back(&pack);
+                    break;
+                }
+            }
+        }
+        return result;
+    }
+}
@@ -0,0 +1,136 @@
+#include "replicant/buildCache.h"
+#include "replicant/core/reader.h"
+#include "replicant/core/writer.h"
+
+#include <cstring>
+
+namespace replicant::archive {
+
+    namespace {
+        constexpr char CacheMagic[4] = { 'L', 'T', 'B', 'C' };
+        constexpr uint32_t CacheVersion = 1;
+
+#pragma pack(push, 1)
+        struct RawCacheHeader {
+            char     magic[4];
+            uint32_t version;
+            int32_t  level;
+            int32_t  windowLog;
+            uint64_t archiveSize;
+            int64_t  archiveMtime;
+            uint32_t entryCount;
+            uint32_t offsetToEntries;
+        };
+
+        struct RawCacheEntry {
+            uint32_t offsetToName;
+            uint32_t compressedSize;
+            uint64_t fileSize;
+            int64_t  mtime;
+            uint64_t contentHash;
+            uint64_t offset;
+            uint32_t packSerializedSize;
+            uint32_t packResourceSize;
+        };
+#pragma pack(pop)
+
+        BuildCache DeserializeInternal(std::span<const std::byte> data) {
+            Reader reader(data);
+            const auto* header = reader.view<RawCacheHeader>();
+
+            if (std::memcmp(header->magic, CacheMagic, 4) != 0) {
+                throw ReaderException("Invalid build cache magic");
+            }
+            if (header->version != CacheVersion) {
+                throw ReaderException("Unsupported build cache version");
+            }
+
+            BuildCache cache;
+            cache.level = header->level;
+            cache.windowLog = header->windowLog;
+            cache.archiveSize = header->archiveSize;
+            cache.archiveMtime = header->archiveMtime;
+
+            if (header->entryCount == 0) return cache;
+
+            reader.seek(reader.getOffsetPtr(header->offsetToEntries));
+            auto rawEntries = reader.viewArray<RawCacheEntry>(header->entryCount);
+
+            cache.entries.reserve(rawEntries.size());
+            for (const auto& raw : rawEntries) {
+                BuildCacheEntry entry;
+                entry.name = reader.readStringRelative(raw.offsetToName);
+                entry.fileSize = raw.fileSize;
+                entry.mtime = raw.mtime;
+                entry.contentHash = raw.contentHash;
+                entry.offset = raw.offset;
+                entry.compressedSize = raw.compressedSize;
+                entry.packSerializedSize = raw.packSerializedSize;
+                entry.packResourceSize = raw.packResourceSize;
+                cache.entries.push_back(std::move(entry));
+            }
+            return cache;
+        }
+    }
+
+    std::expected<BuildCache, Error> BuildCache::Deserialize(std::span<const std::byte> data) {
+        try {
+            return DeserializeInternal(data);
+        }
+        catch (const ReaderException& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
+        }
+    }
+
+    std::vector<std::byte> BuildCache::SerializeInternal() const {
+        Writer writer;
+        StringPool pool;
+
+        writer.write(CacheMagic, 4);
+        writer.write<uint32_t>(CacheVersion);
+        writer.write<int32_t>(level);
+        writer.write<int32_t>(windowLog);
+        writer.write<uint64_t>(archiveSize);
+        writer.write<int64_t>(archiveMtime);
+        writer.write<uint32_t>(static_cast<uint32_t>(entries.size()));
+        size_t tokenEntries = writer.reserveOffset();
+
+        writer.align(8);
+        writer.satisfyOffsetHere(tokenEntries);
+        for (const auto& entry : entries) {
+            pool.add(entry.name, writer.reserveOffset());
+            writer.write<uint32_t>(entry.compressedSize);
+            writer.write<uint64_t>(entry.fileSize);
+            writer.write<int64_t>(entry.mtime);
+            writer.write<uint64_t>(entry.contentHash);
+            writer.write<uint64_t>(entry.offset);
+            writer.write<uint32_t>(entry.packSerializedSize);
+            writer.write<uint32_t>(entry.packResourceSize);
+        }
+
+        pool.flush(writer);
+        return writer.buffer();
+    }
+
+    std::expected<std::vector<std::byte>, Error> BuildCache::Serialize() const {
+        try {
+            return SerializeInternal();
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::SystemError, ex.what() });
+        }
+    }
+
+    void BuildCache::buildLookupIndex() {
+        index_.reset();
+        index_.sync(entries, [](const BuildCacheEntry& e) { return fnv1_32(e.name); });
+    }
+
+    const BuildCacheEntry* BuildCache::find(const std::string& name) const {
+        size_t pos = index_.find(entries, fnv1_32(name), [&](const BuildCacheEntry& e) { return e.name == name; });
+        return pos < entries.size() ? &entries[pos] : nullptr;
+    }
+}
@@ -53,10 +53,13 @@ namespace replicant {
         const std::string& assetType,
         uint32_t version,
         uint32_t projectId,
-        std::span<const std::byte> payload
+        std::span<const std::span<const std::byte>> payloadParts
     ) {
 
-        Writer writer(64 + payload.size());
+        size_t payloadSize = 0;
+        for (const auto& part : payloadParts) payloadSize += part.size();
+
+        Writer writer(sizeof(RawBxonHeader) + assetType.length() + 1 + 32 + payloadSize);
 
         writer.write("BXON", 4);
         writer.write(version);
@@ -71,7 +74,9 @@ namespace replicant {
         writer.align(16);
 
         writer.satisfyOffsetHere(tokenAssetData);
-        writer.write(payload.data(), payload.size());
+        for (const auto& part : payloadParts) {
+            writer.write(part.data(), part.size());
+        }
 
         writer.align(16);
 
@@ -96,9 +101,19 @@ namespace replicant {
         uint32_t version,
         uint32_t projectId,
         std::span<const std::byte> payload
+    ) {
+        std::span<const std::byte> parts[] = { payload };
+        return BuildBxon(assetType, version, projectId, parts);
+    }
+
+    std::expected<std::vector<std::byte>, Error> BuildBxon(
+        const std::string& assetType,
+        uint32_t version,
+        uint32_t projectId,
+        std::span<const std::span<const std::byte>> payloadParts
     ) {
         try {
-            return BuildBxonInternal(assetType, version, projectId, payload);
+            return BuildBxonInternal(assetType, version, projectId, payloadParts);
         }
         catch (const std::exception& ex) {
             return std::unexpected(Error{ ErrorCode::SystemError, ex.what() });
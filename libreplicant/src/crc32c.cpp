@@ -0,0 +1,120 @@
+#include "replicant/core/crc32c.h"
+#include <array>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define REPLICANT_CRC32C_X86 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define REPLICANT_TARGET_SSE42
+#else
+#include <cpuid.h>
+#define REPLICANT_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+#endif
+
+namespace replicant {
+
+    namespace {
+        constexpr uint32_t POLYNOMIAL = 0x82F63B78;  // Castagnoli, reflected
+
+        // Slicing-by-8: table[k][b] is the CRC of byte b followed by k zero bytes
+        constexpr auto MakeTables() {
+            std::array<std::array<uint32_t, 256>, 8> tables{};
+            for (uint32_t b = 0; b < 256; ++b) {
+                uint32_t crc = b;
+                for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ ((crc & 1) ? POLYNOMIAL : 0);
+                tables[0][b] = crc;
+            }
+            for (uint32_t b = 0; b < 256; ++b) {
+                for (size_t k = 1; k < 8; ++k) {
+                    uint32_t prev = tables[k - 1][b];
+                    tables[k][b] = (prev >> 8) ^ tables[0][prev & 0xFF];
+                }
+            }
+            return tables;
+        }
+
+        constexpr auto Tables = MakeTables();
+
+        uint32_t Crc32cSoftware(const uint8_t* p, size_t size, uint32_t crc) {
+            while (size >= 8) {
+                uint32_t lo, hi;
+                std::memcpy(&lo, p, 4);
+                std::memcpy(&hi, p + 4, 4);
+                lo ^= crc;
+                crc = Tables[7][lo & 0xFF] ^ Tables[6][(lo >> 8) & 0xFF] ^ Tables[5][(lo >> 16) & 0xFF] ^ Tables[4][lo >> 24] ^
+                    Tables[3][hi & 0xFF] ^ Tables[2][(hi >> 8) & 0xFF] ^ Tables[1][(hi >> 16) & 0xFF] ^ Tables[0][hi >> 24];
+                p += 8;
+                size -= 8;
+            }
+            while (size--) crc = (crc >> 8) ^ Tables[0][(crc ^ *p++) & 0xFF];
+            return crc;
+        }
+
+#ifdef REPLICANT_CRC32C_X86
+        bool DetectSse42() {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 20)) != 0;
+#else
+            unsigned eax, ebx, ecx, edx;
+            if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+            return (ecx & bit_SSE4_2) != 0;
+#endif
+        }
+
+        REPLICANT_TARGET_SSE42 uint32_t Crc32cHardware(const uint8_t* p, size_t size, uint32_t crc) {
+            while (size > 0 && (reinterpret_cast<uintptr_t>(p) & 7) != 0) {
+                crc = _mm_crc32_u8(crc, *p++);
+                --size;
+            }
+#if defined(_M_X64) || defined(__x86_64__)
+            uint64_t crc64 = crc;
+            while (size >= 8) {
+                uint64_t word;
+                std::memcpy(&word, p, 8);
+                crc64 = _mm_crc32_u64(crc64, word);
+                p += 8;
+                size -= 8;
+            }
+            crc = static_cast<uint32_t>(crc64);
+#endif
+            while (size >= 4) {
+                uint32_t word;
+                std::memcpy(&word, p, 4);
+                crc = _mm_crc32_u32(crc, word);
+                p += 4;
+                size -= 4;
+            }
+            while (size--) crc = _mm_crc32_u8(crc, *p++);
+            return crc;
+        }
+
+        const bool s_hasSse42 = DetectSse42();
+#endif
+    }
+
+    bool crc32cAccelerated() {
+#ifdef REPLICANT_CRC32C_X86
+        return s_hasSse42;
+#else
+        return false;
+#endif
+    }
+
+    uint32_t crc32c(std::span<const std::byte> data, uint32_t crc) {
+        const auto* p = reinterpret_cast<const uint8_t*>(data.data());
+        crc = ~crc;
+#ifdef REPLICANT_CRC32C_X86
+        if (s_hasSse42) return ~Crc32cHardware(p, data.size(), crc);
+#endif
+        return ~Crc32cSoftware(p, data.size(), crc);
+    }
+
+    uint32_t crc32cSoftware(std::span<const std::byte> data, uint32_t crc) {
+        return ~Crc32cSoftware(reinterpret_cast<const uint8_t*>(data.data()), data.size(), ~crc);
+    }
+}
@@ -1,8 +1,11 @@
 #define NOMINMAX
 #include "replicant/dds.h"
+#include "replicant/bxon.h"
 #include <DirectXTex.h>
 #include <unordered_map>
 #include <algorithm>
+#include <cstring>
+#include <fstream>
 
 namespace {
     using namespace replicant;
@@ -72,6 +75,74 @@ namespace {
         default:                              return TextureFormat::UNKNOWN;
         }
     }
+
+    // The game header for an image, with every subresource packed back to back (items, then mips) from offset 0.
+    // The pixels of each subresource are appended to `subresources` in that order, so callers can copy them
+    // wherever the data has to end up without an intermediate blob
+    TextureHeader BuildGameHeader(const DirectX::ScratchImage& image, std::vector<std::span<const std::byte>>& subresources) {
+        const auto& meta = image.GetMetadata();
+        TextureHeader header;
+
+        header.width = static_cast<uint32_t>(meta.width);
+        header.height = static_cast<uint32_t>(meta.height);
+        header.depth = static_cast<uint32_t>(meta.depth);
+        header.mipCount = static_cast<uint32_t>(meta.mipLevels);
+        header.format = DXGIToXon(meta.format);
+
+        if (meta.dimension == DirectX::TEX_DIMENSION_TEXTURE3D) {
+            header.dimension = TextureDimension::Texture3D;
+        }
+        else if (meta.miscFlags & DirectX::TEX_MISC_TEXTURECUBE) {
+            header.dimension = TextureDimension::CubeMap;
+        }
+        else {
+            header.dimension = TextureDimension::Texture2D;
+        }
+
+        header.mips.reserve(meta.arraySize * meta.mipLevels);
+        subresources.reserve(subresources.size() + meta.arraySize * meta.mipLevels);
+        uint32_t currentOffset = 0;
+
+        for (size_t item = 0; item < meta.arraySize; ++item) {
+            for (size_t mip = 0; mip < meta.mipLevels; ++mip) {
+
+                const DirectX::Image* img = image.GetImage(mip, item, 0);
+                if (!img) continue;
+
+                MipSurface surface;
+                surface.offset = currentOffset;
+
+                size_t rowBytes, numRows;
+                DirectX::ComputePitch(meta.format, img->width, img->height, rowBytes, numRows, DirectX::CP_FLAGS_NONE);
+
+                surface.rowPitch = static_cast<uint32_t>(rowBytes);
+                surface.rowCount = static_cast<uint32_t>(numRows);
+                surface.sliceSize = static_cast<uint32_t>(img->slicePitch);
+
+                surface.width = static_cast<uint32_t>(img->width);
+                surface.height = static_cast<uint32_t>(img->height);
+
+                if (meta.dimension == DirectX::TEX_DIMENSION_TEXTURE3D) {
+                    size_t mipDepth = meta.depth >> mip;
+                    if (mipDepth < 1) mipDepth = 1;
+                    surface.depth = static_cast<uint32_t>(mipDepth);
+                }
+                else {
+                    surface.depth = 1;
+                }
+
+                header.mips.push_back(surface);
+
+                // The slices of a 3D mip follow each other in the ScratchImage, as they do in the game's layout
+                size_t totalBytesForSubresource = img->slicePitch * surface.depth;
+                subresources.emplace_back(reinterpret_cast<const std::byte*>(img->pixels), totalBytesForSubresource);
+                currentOffset += static_cast<uint32_t>(totalBytesForSubresource);
+            }
+        }
+
+        header.totalPixelSize = currentOffset;
+        return header;
+    }
 }
 
 namespace replicant::dds {
@@ -171,69 +242,98 @@ namespace replicant::dds {
         return file;
     }
 
-    std::pair<TextureHeader, std::vector<std::byte>> DDSFile::ToGameFormat() const {
-        const auto& meta = image_->GetMetadata();
-        TextureHeader header;
-
-        header.width = static_cast<uint32_t>(meta.width);
-        header.height = static_cast<uint32_t>(meta.height);
-        header.depth = static_cast<uint32_t>(meta.depth);
-        header.mipCount = static_cast<uint32_t>(meta.mipLevels);
-        header.format = DXGIToXon(meta.format);
-
-        if (meta.dimension == DirectX::TEX_DIMENSION_TEXTURE3D) {
-            header.dimension = TextureDimension::Texture3D;
-        }
-        else if (meta.miscFlags & DirectX::TEX_MISC_TEXTURECUBE) {
-            header.dimension = TextureDimension::CubeMap;
-        }
-        else {
-            header.dimension = TextureDimension::Texture2D;
-        }
+    std::expected<void, Error> DDSFile::SaveGameData(
+        const TextureHeader& header,
+        std::span<const std::byte> pixelData,
+        const std::filesystem::path& path
+    ) {
+        if (header.mipCount == 0) return std::unexpected(Error{ ErrorCode::InvalidArguments,"Invalid mip count (0)" });
 
-        std::vector<std::byte> pixelBlob;
-        uint32_t currentOffset = 0;
+        DXGI_FORMAT dxgiFmt = XonToDXGI(header.format);
+        if (dxgiFmt == DXGI_FORMAT_UNKNOWN) return std::unexpected(Error{ ErrorCode::InvalidArguments,"Unsupported Texture Format" });
 
-        for (size_t item = 0; item < meta.arraySize; ++item) {
-            for (size_t mip = 0; mip < meta.mipLevels; ++mip) {
+        // Same metadata CreateFromGameData initializes its ScratchImage with
+        DirectX::TexMetadata meta = {};
+        meta.width = header.width;
+        meta.height = header.height;
+        meta.depth = header.dimension == TextureDimension::Texture3D ? header.depth : 1;
+        meta.arraySize = header.dimension == TextureDimension::Texture3D ? 1 : header.calculateArraySize();
+        meta.mipLevels = header.mipCount;
+        meta.format = dxgiFmt;
+        meta.dimension = header.dimension == TextureDimension::Texture3D ? DirectX::TEX_DIMENSION_TEXTURE3D : DirectX::TEX_DIMENSION_TEXTURE2D;
+
+        // The pixel data can be written as is if it holds every subresource back to back with DirectXTex's pitches,
+        // which is how ToGameFormat lays it out. Anything else goes through a ScratchImage to be repacked
+        bool packed = header.mips.size() == meta.arraySize * meta.mipLevels;
+        size_t expectedOffset = 0;
+
+        for (size_t i = 0; packed && i < header.mips.size(); ++i) {
+            const auto& mipInfo = header.mips[i];
+            size_t mip = i % meta.mipLevels;
+            size_t mipWidth = std::max<size_t>(meta.width >> mip, 1);
+            size_t mipHeight = std::max<size_t>(meta.height >> mip, 1);
+            size_t mipDepth = std::max<size_t>(meta.depth >> mip, 1);
+
+            size_t rowPitch, slicePitch;
+            if (FAILED(DirectX::ComputePitch(dxgiFmt, mipWidth, mipHeight, rowPitch, slicePitch, DirectX::CP_FLAGS_NONE))) {
+                packed = false;
+                break;
+            }
 
-                const DirectX::Image* img = image_->GetImage(mip, item, 0);
-                if (!img) continue;
+            packed = mipInfo.offset == expectedOffset && mipInfo.rowPitch == rowPitch && mipInfo.sliceSize == slicePitch &&
+                mipInfo.depth == mipDepth;
+            expectedOffset += slicePitch * mipDepth;
+        }
 
-                MipSurface surface;
-                surface.offset = currentOffset;
+        if (!packed || expectedOffset > pixelData.size()) {
+            auto file = CreateFromGameData(header, pixelData);
+            if (!file) return std::unexpected(file.error());
+            return file->Save(path);
+        }
 
-                size_t rowBytes, numRows, numBytes;
-                DirectX::ComputePitch(meta.format, img->width, img->height, rowBytes, numRows, DirectX::CP_FLAGS_NONE);
+        size_t headerSize = 0;
+        if (FAILED(DirectX::EncodeDDSHeader(meta, DirectX::DDS_FLAGS_NONE, nullptr, 0, headerSize))) {
+            return std::unexpected(Error{ ErrorCode::InvalidArguments, "EncodeDDSHeader failed" });
+        }
+        std::vector<std::byte> ddsHeader(headerSize);
+        if (FAILED(DirectX::EncodeDDSHeader(meta, DirectX::DDS_FLAGS_NONE, ddsHeader.data(), ddsHeader.size(), headerSize))) {
+            return std::unexpected(Error{ ErrorCode::InvalidArguments, "EncodeDDSHeader failed" });
+        }
 
-                surface.rowPitch = static_cast<uint32_t>(rowBytes);
-                surface.rowCount = static_cast<uint32_t>(numRows);
-                surface.sliceSize = static_cast<uint32_t>(img->slicePitch);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out) return std::unexpected(Error{ ErrorCode::IoError, "Could not open " + path.string() + " for writing" });
 
-                surface.width = static_cast<uint32_t>(img->width);
-                surface.height = static_cast<uint32_t>(img->height);
+        out.write(reinterpret_cast<const char*>(ddsHeader.data()), headerSize);
+        out.write(reinterpret_cast<const char*>(pixelData.data()), static_cast<std::streamsize>(expectedOffset));
+        if (!out) return std::unexpected(Error{ ErrorCode::IoError, "Failed to write " + path.string() });
+        return {};
+    }
 
-                if (meta.dimension == DirectX::TEX_DIMENSION_TEXTURE3D) {
-                    size_t mipDepth = meta.depth >> mip;
-                    if (mipDepth < 1) mipDepth = 1;
-                    surface.depth = static_cast<uint32_t>(mipDepth);
-                }
-                else {
-                    surface.depth = 1;
-                }
+    std::pair<TextureHeader, std::vector<std::byte>> DDSFile::ToGameFormat() const {
+        std::vector<std::span<const std::byte>> subresources;
+        TextureHeader header = BuildGameHeader(*image_, subresources);
+
+        // Sized up front, each subresource is copied exactly once
+        std::vector<std::byte> pixelBlob(header.totalPixelSize);
+        std::byte* dst = pixelBlob.data();
+        for (const auto& subresource : subresources) {
+            std::memcpy(dst, subresource.data(), subresource.size());
+            dst += subresource.size();
+        }
 
-                header.mips.push_back(surface);
+        return { std::move(header), std::move(pixelBlob) };
+    }
 
-                size_t totalBytesForSubresource = img->slicePitch * surface.depth;
-                const std::byte* srcBytes = reinterpret_cast<const std::byte*>(img->pixels);
+    std::expected<std::vector<std::byte>, Error> DDSFile::ToRtex() const {
+        std::vector<std::span<const std::byte>> parts(1);
+        TextureHeader header = BuildGameHeader(*image_, parts);
 
-                pixelBlob.insert(pixelBlob.end(), srcBytes, srcBytes + totalBytesForSubresource);
-                currentOffset += static_cast<uint32_t>(totalBytesForSubresource);
-            }
-        }
+        auto texHead = SerializeTexHead(header);
+        if (!texHead) return std::unexpected(texHead.error());
+        parts[0] = *texHead;
 
-        header.totalPixelSize = static_cast<uint32_t>(pixelBlob.size());
-        return { header, pixelBlob };
+        // BuildBxon gathers the header and every subresource straight into the output buffer
+        return BuildBxon("tpGxTexHead", 3, 0x2ea74106, parts);
     }
 
     uint32_t DDSFile::getWidth() const { return static_cast<uint32_t>(image_->GetMetadata().width); }
@@ -0,0 +1,302 @@
+#include "replicant/dds.h"
+#include <algorithm>
+#include <cstring>
+#include <optional>
+
+// DDS header parsing without DirectXTex, kept apart from dds.cpp so it can be used where DirectXTex is not linked
+
+namespace {
+    using namespace replicant;
+
+    constexpr uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+    constexpr size_t DDS_HEADER_SIZE = 124;
+    constexpr size_t DDS_PIXELFORMAT_SIZE = 32;
+
+    constexpr uint32_t DDSD_DEPTH = 0x800000;
+    constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+    constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+    constexpr uint32_t DDSCAPS2_CUBEMAP_ALLFACES = 0xFC00;
+    constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+
+    constexpr uint32_t DDPF_ALPHAPIXELS = 0x1;
+    constexpr uint32_t DDPF_FOURCC = 0x4;
+    constexpr uint32_t DDPF_RGB = 0x40;
+    constexpr uint32_t DDPF_LUMINANCE = 0x20000;
+
+    constexpr uint32_t DX10_DIMENSION_TEXTURE1D = 2;
+    constexpr uint32_t DX10_DIMENSION_TEXTURE2D = 3;
+    constexpr uint32_t DX10_DIMENSION_TEXTURE3D = 4;
+    constexpr uint32_t DX10_MISC_TEXTURECUBE = 0x4;
+
+    // Direct3D 11 limits, which also keep the size arithmetic below far from overflowing
+    constexpr uint32_t MAX_DIMENSION = 16384;
+    constexpr uint32_t MAX_ARRAY_SIZE = 2048;
+    constexpr uint32_t MAX_MIP_LEVELS = 15;
+
+#pragma pack(push, 1)
+    struct RawPixelFormat {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t fourCC;
+        uint32_t rgbBitCount;
+        uint32_t rBitMask;
+        uint32_t gBitMask;
+        uint32_t bBitMask;
+        uint32_t aBitMask;
+    };
+
+    struct RawDDSHeader {
+        uint32_t magic;
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved1[11];
+        RawPixelFormat pixelFormat;
+        uint32_t caps;
+        uint32_t caps2;
+        uint32_t caps3;
+        uint32_t caps4;
+        uint32_t reserved2;
+    };
+
+    struct RawDX10Header {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(RawDDSHeader) == 4 + DDS_HEADER_SIZE);
+    static_assert(sizeof(RawPixelFormat) == DDS_PIXELFORMAT_SIZE);
+
+    constexpr uint32_t FourCC(char a, char b, char c, char d) {
+        return static_cast<uint32_t>(static_cast<uint8_t>(a)) | (static_cast<uint32_t>(static_cast<uint8_t>(b)) << 8) |
+            (static_cast<uint32_t>(static_cast<uint8_t>(c)) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24);
+    }
+
+    // DXGI_FORMAT values, same mapping as DXGIToXon in dds.cpp
+    TextureFormat FromDXGI(uint32_t format) {
+        switch (format) {
+        case 2:  return TextureFormat::R32G32B32A32_FLOAT;
+        case 6:  return TextureFormat::R32G32B32_FLOAT;
+        case 16: return TextureFormat::R32G32_FLOAT;
+        case 41: return TextureFormat::R32_FLOAT;
+        case 10: return TextureFormat::R16G16B16A16_FLOAT;
+        case 34: return TextureFormat::R16G16_FLOAT;
+        case 54: return TextureFormat::R16_FLOAT;
+        case 28: return TextureFormat::R8G8B8A8_UNORM;
+        case 29: return TextureFormat::R8G8B8A8_UNORM_SRGB;
+        case 49: return TextureFormat::R8G8_UNORM;
+        case 61: return TextureFormat::R8_UNORM;
+        case 87: return TextureFormat::B8G8R8A8_UNORM;
+        case 91: return TextureFormat::B8G8R8A8_UNORM_SRGB;
+        case 88: return TextureFormat::B8G8R8X8_UNORM;
+        case 93: return TextureFormat::B8G8R8X8_UNORM_SRGB;
+        case 71: return TextureFormat::BC1_UNORM;
+        case 72: return TextureFormat::BC1_UNORM_SRGB;
+        case 74: return TextureFormat::BC2_UNORM;
+        case 75: return TextureFormat::BC2_UNORM_SRGB;
+        case 77: return TextureFormat::BC3_UNORM;
+        case 78: return TextureFormat::BC3_UNORM_SRGB;
+        case 80: return TextureFormat::BC4_UNORM;
+        case 83: return TextureFormat::BC5_UNORM;
+        case 95: return TextureFormat::BC6H_UF16;
+        case 96: return TextureFormat::BC6H_SF16;
+        case 98: return TextureFormat::BC7_UNORM;
+        case 99: return TextureFormat::BC7_UNORM_SRGB;
+        default: return TextureFormat::UNKNOWN;
+        }
+    }
+
+    // Pre-DX10 pixel formats, as DirectXTex reads them with DDS_FLAGS_NONE
+    TextureFormat FromLegacy(const RawPixelFormat& pf) {
+        if (pf.flags & DDPF_FOURCC) {
+            switch (pf.fourCC) {
+            case FourCC('D', 'X', 'T', '1'): return TextureFormat::BC1_UNORM;
+            case FourCC('D', 'X', 'T', '2'):
+            case FourCC('D', 'X', 'T', '3'): return TextureFormat::BC2_UNORM;
+            case FourCC('D', 'X', 'T', '4'):
+            case FourCC('D', 'X', 'T', '5'): return TextureFormat::BC3_UNORM;
+            case FourCC('A', 'T', 'I', '1'):
+            case FourCC('B', 'C', '4', 'U'): return TextureFormat::BC4_UNORM;
+            case FourCC('A', 'T', 'I', '2'):
+            case FourCC('B', 'C', '5', 'U'): return TextureFormat::BC5_UNORM;
+            case 111: return TextureFormat::R16_FLOAT;          // D3DFMT_R16F
+            case 112: return TextureFormat::R16G16_FLOAT;       // D3DFMT_G16R16F
+            case 113: return TextureFormat::R16G16B16A16_FLOAT; // D3DFMT_A16B16G16R16F
+            case 114: return TextureFormat::R32_FLOAT;          // D3DFMT_R32F
+            case 115: return TextureFormat::R32G32_FLOAT;       // D3DFMT_G32R32F
+            case 116: return TextureFormat::R32G32B32A32_FLOAT; // D3DFMT_A32B32G32R32F
+            default:  return TextureFormat::UNKNOWN;
+            }
+        }
+
+        auto masks = [&](uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+            return pf.rBitMask == r && pf.gBitMask == g && pf.bBitMask == b && pf.aBitMask == a;
+        };
+
+        if ((pf.flags & DDPF_RGB) && pf.rgbBitCount == 32) {
+            uint32_t alpha = (pf.flags & DDPF_ALPHAPIXELS) ? pf.aBitMask : 0;
+            if (pf.rBitMask == 0x000000ff && pf.gBitMask == 0x0000ff00 && pf.bBitMask == 0x00ff0000) return TextureFormat::R8G8B8A8_UNORM;
+            if (pf.rBitMask == 0x00ff0000 && pf.gBitMask == 0x0000ff00 && pf.bBitMask == 0x000000ff) {
+                return alpha == 0xff000000 ? TextureFormat::B8G8R8A8_UNORM : TextureFormat::B8G8R8X8_UNORM;
+            }
+            return TextureFormat::UNKNOWN;
+        }
+
+        if (pf.flags & DDPF_LUMINANCE) {
+            if (pf.rgbBitCount == 8 && pf.rBitMask == 0xff) return TextureFormat::R8_UNORM;
+            if (pf.rgbBitCount == 16 && masks(0x00ff, 0, 0, 0xff00)) return TextureFormat::R8G8_UNORM;
+        }
+
+        return TextureFormat::UNKNOWN;
+    }
+
+    struct FormatLayout {
+        uint32_t bytes;     // Per pixel, or per 4x4 block if compressed
+        bool compressed;
+    };
+
+    std::optional<FormatLayout> LayoutOf(TextureFormat format) {
+        using enum TextureFormat;
+        switch (format) {
+        case R32G32B32A32_FLOAT: return FormatLayout{ 16, false };
+        case R32G32B32_FLOAT:    return FormatLayout{ 12, false };
+        case R32G32_FLOAT:
+        case R16G16B16A16_FLOAT: return FormatLayout{ 8, false };
+        case R32_FLOAT:
+        case R16G16_FLOAT:
+        case R8G8B8A8_UNORM:
+        case R8G8B8A8_UNORM_SRGB:
+        case B8G8R8A8_UNORM:
+        case B8G8R8A8_UNORM_SRGB:
+        case B8G8R8X8_UNORM:
+        case B8G8R8X8_UNORM_SRGB: return FormatLayout{ 4, false };
+        case R16_FLOAT:
+        case R8G8_UNORM:         return FormatLayout{ 2, false };
+        case R8_UNORM:           return FormatLayout{ 1, false };
+        case BC1_UNORM:
+        case BC1_UNORM_SRGB:
+        case BC4_UNORM:          return FormatLayout{ 8, true };
+        case BC2_UNORM:
+        case BC2_UNORM_SRGB:
+        case BC3_UNORM:
+        case BC3_UNORM_SRGB:
+        case BC5_UNORM:
+        case BC6H_UF16:
+        case BC6H_SF16:
+        case BC7_UNORM:
+        case BC7_UNORM_SRGB:     return FormatLayout{ 16, true };
+        default:                 return std::nullopt;
+        }
+    }
+
+    // Every surface packed back to back, items outermost, as DDS stores them
+    uint64_t PixelDataSize(const dds::DDSHeaderInfo& info, FormatLayout layout) {
+        uint64_t perItem = 0;
+        for (uint32_t mip = 0; mip < info.mipLevels; ++mip) {
+            uint64_t w = std::max<uint32_t>(info.width >> mip, 1);
+            uint64_t h = std::max<uint32_t>(info.height >> mip, 1);
+            uint64_t d = std::max<uint32_t>(info.depth >> mip, 1);
+
+            uint64_t slice = layout.compressed
+                ? ((w + 3) / 4) * ((h + 3) / 4) * layout.bytes
+                : w * h * layout.bytes;
+            perItem += slice * d;
+        }
+        return perItem * info.arraySize;
+    }
+}
+
+namespace replicant::dds {
+
+    std::expected<DDSHeaderInfo, Error> ProbeHeader(std::span<const std::byte> data) {
+        return ProbeHeader(data, data.size());
+    }
+
+    std::expected<DDSHeaderInfo, Error> ProbeHeader(std::span<const std::byte> data, uint64_t fileSize) {
+        auto invalid = [](const char* message) { return std::unexpected(Error{ ErrorCode::ParseError, message }); };
+
+        if (fileSize < data.size()) return invalid("Header larger than the file it was read from");
+        if (data.size() < sizeof(RawDDSHeader)) return invalid("File too small for a DDS header");
+
+        RawDDSHeader header;
+        std::memcpy(&header, data.data(), sizeof(header));
+        if (header.magic != DDS_MAGIC) return invalid("Invalid DDS magic");
+        if (header.size != DDS_HEADER_SIZE || header.pixelFormat.size != DDS_PIXELFORMAT_SIZE) return invalid("Invalid DDS header size");
+
+        DDSHeaderInfo info;
+        info.width = header.width;
+        info.height = header.height;
+        info.mipLevels = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount > 0 ? header.mipMapCount : 1;
+        info.dataOffset = sizeof(RawDDSHeader);
+
+        bool dx10 = (header.pixelFormat.flags & DDPF_FOURCC) && header.pixelFormat.fourCC == FourCC('D', 'X', '1', '0');
+        if (dx10) {
+            if (data.size() < sizeof(RawDDSHeader) + sizeof(RawDX10Header)) return invalid("File too small for a DX10 header");
+
+            RawDX10Header ext;
+            std::memcpy(&ext, data.data() + sizeof(RawDDSHeader), sizeof(ext));
+            info.dataOffset += sizeof(RawDX10Header);
+            info.format = FromDXGI(ext.dxgiFormat);
+
+            if (ext.arraySize == 0) return invalid("DX10 header with an array size of 0");
+            // Checked before cube maps multiply it by 6, which could wrap around
+            if (ext.arraySize > MAX_ARRAY_SIZE) return invalid("Texture dimensions out of range");
+            info.arraySize = ext.arraySize;
+
+            switch (ext.resourceDimension) {
+            case DX10_DIMENSION_TEXTURE1D:
+                info.height = 1;
+                break;
+            case DX10_DIMENSION_TEXTURE2D:
+                if (ext.miscFlag & DX10_MISC_TEXTURECUBE) {
+                    info.arraySize *= 6;
+                    info.dimension = TextureDimension::CubeMap;
+                }
+                break;
+            case DX10_DIMENSION_TEXTURE3D:
+                if (ext.arraySize != 1) return invalid("Volume texture with an array size other than 1");
+                info.depth = (header.flags & DDSD_DEPTH) ? header.depth : 1;
+                info.dimension = TextureDimension::Texture3D;
+                break;
+            default:
+                return invalid("Unknown DX10 resource dimension");
+            }
+        }
+        else {
+            info.format = FromLegacy(header.pixelFormat);
+
+            if (header.caps2 & DDSCAPS2_VOLUME) {
+                info.depth = header.depth;
+                info.dimension = TextureDimension::Texture3D;
+            }
+            else if (header.caps2 & DDSCAPS2_CUBEMAP) {
+                // Partial cube maps cannot be represented, DirectXTex rejects them as well
+                if ((header.caps2 & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES) return invalid("Cube map without all six faces");
+                info.arraySize = 6;
+                info.dimension = TextureDimension::CubeMap;
+            }
+        }
+
+        if (info.width == 0 || info.height == 0 || info.depth == 0) return invalid("Texture with a zero dimension");
+        if (info.width > MAX_DIMENSION || info.height > MAX_DIMENSION || info.depth > MAX_DIMENSION ||
+            info.arraySize > MAX_ARRAY_SIZE * 6 || info.mipLevels > MAX_MIP_LEVELS) {
+            return invalid("Texture dimensions out of range");
+        }
+
+        if (auto layout = LayoutOf(info.format)) {
+            uint64_t size = PixelDataSize(info, *layout);
+            if (size > fileSize - info.dataOffset) return invalid("File too small for the pixel data its header describes");
+            info.dataSize = static_cast<size_t>(size);
+        }
+
+        return info;
+    }
+}
@@ -0,0 +1,130 @@
+#include "replicant/deadFrames.h"
+#include "replicant/core/reader.h"
+#include "replicant/core/writer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace replicant::archive {
+
+    namespace {
+        constexpr char DeadFramesMagic[4] = { 'L', 'T', 'D', 'F' };
+        constexpr uint32_t DeadFramesVersion = 1;
+        constexpr uint64_t SECTOR_ALIGNMENT = 16;
+
+#pragma pack(push, 1)
+        struct RawDeadFramesHeader {
+            char     magic[4];
+            uint32_t version;
+            uint64_t archiveSize;
+            int64_t  archiveMtime;
+            uint32_t frameCount;
+            uint32_t offsetToFrames;
+        };
+
+        struct RawFrameRange {
+            uint64_t offset;
+            uint32_t size;
+            uint32_t padding;
+        };
+#pragma pack(pop)
+
+        DeadFrames DeserializeInternal(std::span<const std::byte> data) {
+            Reader reader(data);
+            const auto* header = reader.view<RawDeadFramesHeader>();
+
+            if (std::memcmp(header->magic, DeadFramesMagic, 4) != 0) {
+                throw ReaderException("Invalid dead frame list magic");
+            }
+            if (header->version != DeadFramesVersion) {
+                throw ReaderException("Unsupported dead frame list version");
+            }
+
+            DeadFrames dead;
+            dead.archiveSize = header->archiveSize;
+            dead.archiveMtime = header->archiveMtime;
+
+            if (header->frameCount == 0) return dead;
+
+            reader.seek(reader.getOffsetPtr(header->offsetToFrames));
+            auto rawFrames = reader.viewArray<RawFrameRange>(header->frameCount);
+
+            dead.frames.reserve(rawFrames.size());
+            for (const auto& raw : rawFrames) {
+                dead.frames.push_back({ raw.offset, raw.size });
+            }
+            return dead;
+        }
+    }
+
+    std::expected<DeadFrames, Error> DeadFrames::Deserialize(std::span<const std::byte> data) {
+        try {
+            return DeserializeInternal(data);
+        }
+        catch (const ReaderException& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
+        }
+    }
+
+    std::vector<std::byte> DeadFrames::SerializeInternal() const {
+        Writer writer;
+
+        writer.write(DeadFramesMagic, 4);
+        writer.write<uint32_t>(DeadFramesVersion);
+        writer.write<uint64_t>(archiveSize);
+        writer.write<int64_t>(archiveMtime);
+        writer.write<uint32_t>(static_cast<uint32_t>(frames.size()));
+        size_t tokenFrames = writer.reserveOffset();
+
+        writer.align(8);
+        writer.satisfyOffsetHere(tokenFrames);
+        for (const auto& frame : frames) {
+            writer.write<uint64_t>(frame.offset);
+            writer.write<uint32_t>(frame.size);
+            writer.write<uint32_t>(0);
+        }
+        return writer.buffer();
+    }
+
+    std::expected<std::vector<std::byte>, Error> DeadFrames::Serialize() const {
+        try {
+            return SerializeInternal();
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::SystemError, ex.what() });
+        }
+    }
+
+    uint64_t DeadFrames::wastedBytes() const {
+        uint64_t total = 0;
+        for (const auto& frame : frames) {
+            total += (frame.size + SECTOR_ALIGNMENT - 1) & ~(SECTOR_ALIGNMENT - 1);
+        }
+        return total;
+    }
+
+    std::vector<FrameRange> DeadFrames::FramesOf(const TpArchiveFileParam& index, uint8_t archiveIndex) {
+        std::vector<FrameRange> result;
+        for (const auto& entry : index.fileEntries) {
+            if (entry.archiveIndex == archiveIndex) result.push_back({ entry.rawOffset, entry.size });
+        }
+
+        std::sort(result.begin(), result.end(), [](const FrameRange& a, const FrameRange& b) { return a.offset < b.offset; });
+        result.erase(std::unique(result.begin(), result.end(),
+            [](const FrameRange& a, const FrameRange& b) { return a.offset == b.offset; }), result.end());
+        return result;
+    }
+
+    void DeadFrames::addUnreferenced(std::span<const FrameRange> previous, const TpArchiveFileParam& index, uint8_t archiveIndex) {
+        std::vector<FrameRange> live = FramesOf(index, archiveIndex);
+
+        for (const auto& frame : previous) {
+            auto it = std::lower_bound(live.begin(), live.end(), frame.offset,
+                [](const FrameRange& f, uint64_t offset) { return f.offset < offset; });
+            if (it == live.end() || it->offset != frame.offset) frames.push_back(frame);
+        }
+    }
+}
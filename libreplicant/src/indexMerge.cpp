@@ -0,0 +1,554 @@
+#include "replicant/indexMerge.h"
+#include "replicant/tpArchiveFileParam.h"
+#include "replicant/arc.h"
+#include "replicant/bxon.h"
+#include "replicant/core/io.h"
+#include "replicant/core/reader.h"
+#include "replicant/core/writer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <format>
+
+namespace replicant {
+
+    namespace {
+        constexpr char FingerprintMagic[4] = { 'L', 'T', 'P', 'F' };
+
+        // Bump whenever the merge changes what it produces from the same inputs, so old outputs are rebuilt
+        constexpr uint32_t FingerprintVersion = 3;
+
+        constexpr uint64_t CONSOLIDATE_ALIGNMENT = 16;
+        constexpr uint32_t CONSOLIDATE_OFFSET_SCALE = 4;
+        constexpr size_t MAX_ARCHIVES = 256;
+
+#pragma pack(push, 1)
+        struct RawFingerprintHeader {
+            char     magic[4];
+            uint32_t version;
+            uint64_t baseSize;
+            int64_t  baseMtime;
+            uint64_t baseHash;
+            uint32_t consolidated;
+            uint32_t modCount;
+            uint32_t offsetToMods;
+            uint32_t dependencyCount;
+            uint32_t offsetToDependencies;
+            uint32_t outputCount;
+            uint32_t offsetToOutputs;
+        };
+
+        struct RawModStamp {
+            uint32_t offsetToId;
+            uint32_t offsetToIndexPath;
+            uint64_t size;
+            int64_t  mtime;
+        };
+
+        struct RawFileStamp {
+            uint32_t offsetToPath;
+            uint32_t padding;
+            uint64_t size;
+            int64_t  mtime;
+        };
+#pragma pack(pop)
+
+        std::filesystem::path ConsolidatedArchivePath(const ConsolidateOptions& options, size_t n) {
+            return options.outputDir / std::format("{}_{:03}.arc", options.baseName, n);
+        }
+
+        struct LoadedIndex {
+            BxonHeaderInfo header;
+            TpArchiveFileParam param;
+        };
+
+        std::expected<LoadedIndex, Error> LoadIndex(std::span<const std::byte> compressed) {
+            auto size = archive::GetDecompressedSize(compressed);
+            if (!size) return std::unexpected(size.error());
+
+            auto decompressed = archive::Decompress(compressed, *size);
+            if (!decompressed) return std::unexpected(decompressed.error());
+
+            auto bxon = ParseBxon(*decompressed);
+            if (!bxon) return std::unexpected(bxon.error());
+
+            auto& [header, payload] = *bxon;
+            auto param = TpArchiveFileParam::Deserialize(payload);
+            if (!param) return std::unexpected(param.error());
+
+            return LoadedIndex{ std::move(header), std::move(*param) };
+        }
+
+        void MergeMod(IndexMerger& merger, const ModIndexSource& source, const std::filesystem::path& dataRoot,
+            ModMergeResult& result) {
+            auto file = MappedFile::Open(source.indexPath);
+            if (!file) {
+                result.error = "Could not read index: " + file.error().message;
+                return;
+            }
+
+            auto loaded = LoadIndex(file->data());
+            if (!loaded) {
+                result.error = "Could not parse index: " + loaded.error().toString();
+                return;
+            }
+
+            const auto& modParam = loaded->param;
+            if (modParam.archiveEntries.empty()) {
+                result.error = "Index does not reference an archive";
+                return;
+            }
+
+            const std::string& archiveName = modParam.archiveEntries[0].filename;
+            std::filesystem::path archivePath = source.indexPath.parent_path() / archiveName;
+            result.archivePath = archivePath;
+
+            std::error_code ec;
+            if (!std::filesystem::exists(archivePath, ec)) {
+                result.error = "Index requires archive '" + archiveName + "' but it was not found";
+                return;
+            }
+
+            std::string relativePath = std::filesystem::relative(archivePath, dataRoot, ec).generic_string();
+            if (ec || relativePath.empty()) {
+                result.error = "Archive '" + archivePath.string() + "' cannot be referenced from " + dataRoot.string();
+                return;
+            }
+
+            result.stats = merger.apply(modParam, relativePath);
+            result.applied = true;
+        }
+
+        PatchFingerprint DeserializeInternal(std::span<const std::byte> data) {
+            Reader reader(data);
+            const auto* header = reader.view<RawFingerprintHeader>();
+
+            if (std::memcmp(header->magic, FingerprintMagic, 4) != 0) {
+                throw ReaderException("Invalid fingerprint magic");
+            }
+            if (header->version != FingerprintVersion) {
+                throw ReaderException("Unsupported fingerprint version");
+            }
+
+            PatchFingerprint fingerprint;
+            fingerprint.baseSize = header->baseSize;
+            fingerprint.baseMtime = header->baseMtime;
+            fingerprint.baseHash = header->baseHash;
+            fingerprint.consolidated = header->consolidated != 0;
+
+            if (header->modCount > 0) {
+                reader.seek(reader.getOffsetPtr(header->offsetToMods));
+                auto rawMods = reader.viewArray<RawModStamp>(header->modCount);
+
+                fingerprint.mods.reserve(rawMods.size());
+                for (const auto& raw : rawMods) {
+                    PatchFingerprint::ModStamp mod;
+                    mod.id = reader.readStringRelative(raw.offsetToId);
+                    mod.indexPath = reader.readStringRelative(raw.offsetToIndexPath);
+                    mod.size = raw.size;
+                    mod.mtime = raw.mtime;
+                    fingerprint.mods.push_back(std::move(mod));
+                }
+            }
+
+            auto readStamps = [&](uint32_t count, const uint32_t& offsetField, std::vector<PatchFingerprint::FileStamp>& out) {
+                if (count == 0) return;
+                reader.seek(reader.getOffsetPtr(offsetField));
+                auto rawStamps = reader.viewArray<RawFileStamp>(count);
+
+                out.reserve(rawStamps.size());
+                for (const auto& raw : rawStamps) {
+                    out.push_back({ reader.readStringRelative(raw.offsetToPath), raw.size, raw.mtime });
+                }
+            };
+            readStamps(header->dependencyCount, header->offsetToDependencies, fingerprint.dependencies);
+            readStamps(header->outputCount, header->offsetToOutputs, fingerprint.outputs);
+
+            return fingerprint;
+        }
+    }
+
+    IndexMerger::IndexMerger(TpArchiveFileParam base) : param_(std::move(base)) {
+        // Lookups here go through index_, keyed on the cached hashes
+        param_.dropLookupIndex();
+
+        hashes_.reserve(param_.fileEntries.size());
+        archiveOf_.reserve(param_.fileEntries.size());
+        for (const auto& entry : param_.fileEntries) {
+            hashes_.push_back(fnv1_32(entry.name));
+            archiveOf_.push_back(entry.archiveIndex);
+        }
+        index_.reset();
+        baseArchiveCount_ = param_.archiveEntries.size();
+    }
+
+    size_t IndexMerger::find(const std::string& name, uint32_t hash) {
+        index_.sync(hashes_, [](uint32_t h) { return h; });
+        return index_.find(param_.fileEntries, hash, [&](const FileEntry& e) { return e.name == name; });
+    }
+
+    MergeStats IndexMerger::apply(const TpArchiveFileParam& mod, const std::string& archivePath) {
+        MergeStats stats;
+        if (mod.archiveEntries.empty()) return stats;
+
+        // Not addArchiveEntry, its index is 8-bit
+        uint32_t archiveIndex = static_cast<uint32_t>(param_.archiveEntries.size());
+        param_.archiveEntries.push_back({ archivePath, mod.archiveEntries[0].arcOffsetScale, mod.archiveEntries[0].loadType });
+
+        for (const auto& modEntry : mod.fileEntries) {
+            uint32_t hash = fnv1_32(modEntry.name);
+            size_t pos = find(modEntry.name, hash);
+
+            if (pos < param_.fileEntries.size()) {
+                if (archiveOf_[pos] >= baseArchiveCount_) shadowedEntries_++;
+
+                FileEntry& existing = param_.fileEntries[pos];
+                existing.rawOffset = modEntry.rawOffset;
+                existing.size = modEntry.size;
+                existing.packFileSerializedSize = modEntry.packFileSerializedSize;
+                existing.packFileResourceSize = modEntry.packFileResourceSize;
+                archiveOf_[pos] = archiveIndex;
+                stats.overwritten++;
+            }
+            else {
+                param_.fileEntries.push_back(modEntry);
+                hashes_.push_back(hash);
+                archiveOf_.push_back(archiveIndex);
+                stats.added++;
+            }
+        }
+        return stats;
+    }
+
+    std::expected<ConsolidateStats, Error> IndexMerger::consolidate(const std::filesystem::path& dataRoot,
+        const ConsolidateOptions& options) {
+        if (options.maxArchiveSize == 0 || options.maxArchiveSize > (uint64_t{ UINT32_MAX } + 1) << CONSOLIDATE_OFFSET_SCALE) {
+            return std::unexpected(Error{ ErrorCode::InvalidArguments, "maxArchiveSize is not addressable with an offset scale of 4" });
+        }
+
+        ConsolidateStats stats;
+        stats.shadowedEntries = shadowedEntries_;
+
+        std::vector<char> consolidated(param_.archiveEntries.size(), 0);
+        for (size_t a = baseArchiveCount_; a < param_.archiveEntries.size(); ++a) {
+            consolidated[a] = param_.archiveEntries[a].loadType == ArchiveLoadType::STREAM;
+        }
+
+        // Entries still pointing at a mod archive, in source order so every source is read front to back once
+        std::vector<uint32_t> live;
+        for (size_t i = 0; i < param_.fileEntries.size(); ++i) {
+            if (consolidated[archiveOf_[i]]) live.push_back(static_cast<uint32_t>(i));
+        }
+        std::sort(live.begin(), live.end(), [&](uint32_t a, uint32_t b) {
+            if (archiveOf_[a] != archiveOf_[b]) return archiveOf_[a] < archiveOf_[b];
+            if (param_.fileEntries[a].rawOffset != param_.fileEntries[b].rawOffset) {
+                return param_.fileEntries[a].rawOffset < param_.fileEntries[b].rawOffset;
+            }
+            return a < b;
+        });
+
+        std::error_code ec;
+        std::filesystem::create_directories(options.outputDir, ec);
+        if (ec) {
+            return std::unexpected(Error{ ErrorCode::IoError, "Failed to create " + options.outputDir.string() + ": " + ec.message() });
+        }
+
+        std::ofstream out;
+        uint64_t outSize = 0;
+        std::vector<std::pair<uint32_t, uint64_t>> placement(live.size());   // (new archive number, offset)
+
+        MappedFile source;
+        uint32_t sourceArchive = UINT32_MAX;
+        uint64_t lastOffset = 0;
+
+        for (size_t k = 0; k < live.size(); ++k) {
+            const FileEntry& entry = param_.fileEntries[live[k]];
+            uint32_t archive = archiveOf_[live[k]];
+
+            // Entries sharing a frame (deduplicated inputs) follow each other, the frame is copied once
+            if (archive == sourceArchive && k > 0 && entry.rawOffset == lastOffset) {
+                placement[k] = placement[k - 1];
+                continue;
+            }
+
+            if (archive != sourceArchive) {
+                std::filesystem::path sourcePath = dataRoot / param_.archiveEntries[archive].filename;
+                auto mapped = MappedFile::Open(sourcePath);
+                if (!mapped) {
+                    return std::unexpected(Error{ ErrorCode::IoError, "Failed to open " + sourcePath.string() + ": " + mapped.error().message });
+                }
+                source = std::move(*mapped);
+                sourceArchive = archive;
+                stats.sources.push_back(sourcePath);
+            }
+
+            if (entry.rawOffset + entry.size > source.size()) {
+                return std::unexpected(Error{ ErrorCode::ParseError,
+                    "Entry '" + entry.name + "' lies outside " + param_.archiveEntries[archive].filename });
+            }
+
+            uint64_t alignedSize = (entry.size + CONSOLIDATE_ALIGNMENT - 1) & ~(CONSOLIDATE_ALIGNMENT - 1);
+            if (!out.is_open() || (outSize > 0 && outSize + alignedSize > options.maxArchiveSize)) {
+                if (out.is_open()) {
+                    out.close();
+                    if (!out) return std::unexpected(Error{ ErrorCode::IoError, "Failed to write " + stats.archives.back().string() });
+                }
+                stats.archives.push_back(ConsolidatedArchivePath(options, stats.archives.size()));
+                out.open(stats.archives.back(), std::ios::binary | std::ios::trunc);
+                if (!out) return std::unexpected(Error{ ErrorCode::IoError, "Failed to create " + stats.archives.back().string() });
+                outSize = 0;
+            }
+
+            placement[k] = { static_cast<uint32_t>(stats.archives.size() - 1), outSize };
+
+            static constexpr char zeros[CONSOLIDATE_ALIGNMENT] = {};
+            out.write(reinterpret_cast<const char*>(source.data().data() + entry.rawOffset), entry.size);
+            out.write(zeros, static_cast<std::streamsize>(alignedSize - entry.size));
+            if (!out) return std::unexpected(Error{ ErrorCode::IoError, "Failed to write " + stats.archives.back().string() });
+
+            outSize += alignedSize;
+            lastOffset = entry.rawOffset;
+            stats.frames++;
+            stats.bytes += entry.size;
+        }
+
+        if (out.is_open()) {
+            out.close();
+            if (!out) return std::unexpected(Error{ ErrorCode::IoError, "Failed to write " + stats.archives.back().string() });
+        }
+
+        // Leftovers from an earlier run that needed more archives
+        RemoveConsolidatedArchives(options, stats.archives.size());
+
+        // Drop the sources and append the new archives, then repoint everything
+        std::vector<uint32_t> remap(param_.archiveEntries.size(), UINT32_MAX);
+        std::vector<ArchiveEntry> archives;
+        for (size_t a = 0; a < param_.archiveEntries.size(); ++a) {
+            if (consolidated[a]) continue;
+            remap[a] = static_cast<uint32_t>(archives.size());
+            archives.push_back(std::move(param_.archiveEntries[a]));
+        }
+
+        uint32_t firstNew = static_cast<uint32_t>(archives.size());
+        for (const auto& path : stats.archives) {
+            std::string relativePath = std::filesystem::relative(path, dataRoot, ec).generic_string();
+            if (ec || relativePath.empty()) {
+                return std::unexpected(Error{ ErrorCode::InvalidArguments, path.string() + " cannot be referenced from " + dataRoot.string() });
+            }
+            archives.push_back({ relativePath, CONSOLIDATE_OFFSET_SCALE, ArchiveLoadType::STREAM });
+        }
+
+        for (size_t i = 0; i < archiveOf_.size(); ++i) {
+            if (!consolidated[archiveOf_[i]]) archiveOf_[i] = remap[archiveOf_[i]];
+        }
+        for (size_t k = 0; k < live.size(); ++k) {
+            archiveOf_[live[k]] = firstNew + placement[k].first;
+            param_.fileEntries[live[k]].rawOffset = placement[k].second;
+        }
+
+        param_.archiveEntries = std::move(archives);
+        return stats;
+    }
+
+    std::expected<TpArchiveFileParam, Error> IndexMerger::finish() {
+        if (param_.archiveEntries.size() > MAX_ARCHIVES) {
+            return std::unexpected(Error{ ErrorCode::UnsupportedFeature,
+                std::format("{} archives referenced, at most {} are addressable", param_.archiveEntries.size(), MAX_ARCHIVES) });
+        }
+
+        // Sort (hash, position) pairs rather than the entries so names are never rehashed and each entry moves once.
+        // Position breaks ties between colliding names, keeping the output deterministic
+        std::vector<std::pair<uint32_t, uint32_t>> order;
+        order.reserve(hashes_.size());
+        for (size_t i = 0; i < hashes_.size(); ++i) {
+            order.emplace_back(hashes_[i], static_cast<uint32_t>(i));
+        }
+        std::sort(order.begin(), order.end());
+
+        std::vector<FileEntry> sorted;
+        sorted.reserve(order.size());
+        for (const auto& [hash, pos] : order) {
+            sorted.push_back(std::move(param_.fileEntries[pos]));
+            sorted.back().archiveIndex = static_cast<uint8_t>(archiveOf_[pos]);
+        }
+
+        TpArchiveFileParam result = std::move(param_);
+        result.fileEntries = std::move(sorted);
+
+        param_ = {};
+        hashes_.clear();
+        archiveOf_.clear();
+        index_.disable();
+        return result;
+    }
+
+    size_t RemoveConsolidatedArchives(const ConsolidateOptions& options, size_t keep) {
+        std::error_code ec;
+        size_t removed = 0;
+        for (size_t n = keep; std::filesystem::exists(ConsolidatedArchivePath(options, n), ec); ++n) {
+            if (std::filesystem::remove(ConsolidatedArchivePath(options, n), ec)) removed++;
+        }
+        return removed;
+    }
+
+    bool IndexMergeResult::anyApplied() const {
+        return std::any_of(mods.begin(), mods.end(), [](const ModMergeResult& m) { return m.applied; });
+    }
+
+    std::expected<IndexMergeResult, Error> MergeModIndices(std::span<const std::byte> baseIndex,
+        const std::vector<ModIndexSource>& mods, const std::filesystem::path& dataRoot, const MergeOptions& options) {
+        try {
+            auto base = LoadIndex(baseIndex);
+            if (!base) {
+                return std::unexpected(Error{ base.error().code, "Base index: " + base.error().message });
+            }
+
+            IndexMerger merger(std::move(base->param));
+
+            IndexMergeResult result;
+            result.mods.reserve(mods.size());
+            for (const auto& mod : mods) {
+                ModMergeResult& modResult = result.mods.emplace_back();
+                modResult.id = mod.id;
+                MergeMod(merger, mod, dataRoot, modResult);
+            }
+
+            if (!result.anyApplied()) return result;
+
+            if (options.consolidate) {
+                auto consolidation = merger.consolidate(dataRoot, *options.consolidate);
+                if (!consolidation) {
+                    return std::unexpected(Error{ consolidation.error().code, "Consolidation: " + consolidation.error().message });
+                }
+                result.consolidation = std::move(*consolidation);
+            }
+
+            auto param = merger.finish();
+            if (!param) return std::unexpected(param.error());
+
+            auto payload = param->Serialize();
+            if (!payload) return std::unexpected(payload.error());
+
+            auto bxon = BuildBxon(base->header.assetType, base->header.version, base->header.projectId, *payload);
+            if (!bxon) return std::unexpected(bxon.error());
+
+            auto compressed = archive::Compress(*bxon);
+            if (!compressed) return std::unexpected(compressed.error());
+
+            result.compressedIndex = std::move(*compressed);
+            return result;
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::SystemError, ex.what() });
+        }
+    }
+
+    PatchFingerprint PatchFingerprint::Compute(const std::filesystem::path& baseIndexPath,
+        std::span<const std::byte> baseIndex, const std::vector<ModIndexSource>& mods) {
+        PatchFingerprint fingerprint;
+
+        auto base = StampOf(baseIndexPath);
+        fingerprint.baseSize = base.size;
+        fingerprint.baseMtime = base.mtime;
+        fingerprint.baseHash = hash64(baseIndex);
+
+        fingerprint.mods.reserve(mods.size());
+        for (const auto& mod : mods) {
+            auto stamp = StampOf(mod.indexPath);
+            fingerprint.mods.push_back({ mod.id, mod.indexPath.generic_string(), stamp.size, stamp.mtime });
+        }
+        return fingerprint;
+    }
+
+    void PatchFingerprint::addDependency(const std::filesystem::path& path) {
+        auto stamp = StampOf(path);
+        dependencies.push_back({ path.generic_string(), stamp.size, stamp.mtime });
+    }
+
+    void PatchFingerprint::addOutput(const std::filesystem::path& path) {
+        auto stamp = StampOf(path);
+        outputs.push_back({ path.generic_string(), stamp.size, stamp.mtime });
+    }
+
+    bool PatchFingerprint::isUpToDate(const PatchFingerprint& current) const {
+        if (baseSize != current.baseSize || baseMtime != current.baseMtime || baseHash != current.baseHash ||
+            consolidated != current.consolidated || mods != current.mods) {
+            return false;
+        }
+
+        // Nothing recorded means the outputs were never confirmed as written
+        if (outputs.empty()) return false;
+
+        auto unchanged = [](const FileStamp& recorded) {
+            auto stamp = StampOf(recorded.path);
+            return stamp.size == recorded.size && stamp.mtime == recorded.mtime;
+        };
+        return std::all_of(dependencies.begin(), dependencies.end(), unchanged) &&
+            std::all_of(outputs.begin(), outputs.end(), unchanged);
+    }
+
+    std::expected<PatchFingerprint, Error> PatchFingerprint::Deserialize(std::span<const std::byte> data) {
+        try {
+            return DeserializeInternal(data);
+        }
+        catch (const ReaderException& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
+        }
+    }
+
+    std::vector<std::byte> PatchFingerprint::SerializeInternal() const {
+        Writer writer;
+        StringPool pool;
+
+        writer.write(FingerprintMagic, 4);
+        writer.write<uint32_t>(FingerprintVersion);
+        writer.write<uint64_t>(baseSize);
+        writer.write<int64_t>(baseMtime);
+        writer.write<uint64_t>(baseHash);
+        writer.write<uint32_t>(consolidated ? 1 : 0);
+        writer.write<uint32_t>(static_cast<uint32_t>(mods.size()));
+        size_t tokenMods = writer.reserveOffset();
+        writer.write<uint32_t>(static_cast<uint32_t>(dependencies.size()));
+        size_t tokenDependencies = writer.reserveOffset();
+        writer.write<uint32_t>(static_cast<uint32_t>(outputs.size()));
+        size_t tokenOutputs = writer.reserveOffset();
+
+        writer.align(8);
+        writer.satisfyOffsetHere(tokenMods);
+        for (const auto& mod : mods) {
+            pool.add(mod.id, writer.reserveOffset());
+            pool.add(mod.indexPath, writer.reserveOffset());
+            writer.write<uint64_t>(mod.size);
+            writer.write<int64_t>(mod.mtime);
+        }
+
+        auto writeStamps = [&](size_t token, const std::vector<FileStamp>& stamps) {
+            writer.align(8);
+            writer.satisfyOffsetHere(token);
+            for (const auto& stamp : stamps) {
+                pool.add(stamp.path, writer.reserveOffset());
+                writer.write<uint32_t>(0);
+                writer.write<uint64_t>(stamp.size);
+                writer.write<int64_t>(stamp.mtime);
+            }
+        };
+        writeStamps(tokenDependencies, dependencies);
+        writeStamps(tokenOutputs, outputs);
+
+        pool.flush(writer);
+        return writer.buffer();
+    }
+
+    std::expected<std::vector<std::byte>, Error> PatchFingerprint::Serialize() const {
+        try {
+            return SerializeInternal();
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::SystemError, ex.what() });
+        }
+    }
+}
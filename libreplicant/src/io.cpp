@@ -0,0 +1,286 @@
+#include "replicant/core/io.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace replicant {
+
+    namespace {
+
+        // Returns nullptr if the file could not be mapped, the caller falls back to a buffered read
+        void* MapReadOnly(const std::filesystem::path& path, size_t& outSize) {
+            outSize = 0;
+#ifdef _WIN32
+            HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+            LARGE_INTEGER size{};
+            if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+                CloseHandle(file);
+                return nullptr;
+            }
+
+            HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            CloseHandle(file);
+            if (!mapping) return nullptr;
+
+            // The view keeps the mapping object alive, so both handles can be closed here
+            void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+            if (!view) return nullptr;
+
+            outSize = static_cast<size_t>(size.QuadPart);
+            return view;
+#else
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) return nullptr;
+
+            struct stat st {};
+            if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+                ::close(fd);
+                return nullptr;
+            }
+
+            void* view = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (view == MAP_FAILED) return nullptr;
+
+            outSize = static_cast<size_t>(st.st_size);
+            return view;
+#endif
+        }
+
+        void Unmap(void* view, size_t size) {
+#ifdef _WIN32
+            (void)size;
+            UnmapViewOfFile(view);
+#else
+            ::munmap(view, size);
+#endif
+        }
+    }
+
+    MappedFile::~MappedFile() {
+        release();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+        : data_(other.data_), view_(other.view_), buffer_(std::move(other.buffer_)) {
+        other.data_ = {};
+        other.view_ = nullptr;
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            release();
+            data_ = other.data_;
+            view_ = other.view_;
+            buffer_ = std::move(other.buffer_);
+            other.data_ = {};
+            other.view_ = nullptr;
+        }
+        return *this;
+    }
+
+    void MappedFile::release() {
+        if (view_) {
+            Unmap(view_, data_.size());
+            view_ = nullptr;
+        }
+        buffer_.clear();
+        buffer_.shrink_to_fit();
+        data_ = {};
+    }
+
+    void MappedFile::prefetch(size_t offset, size_t size) const {
+        if (!view_ || offset >= data_.size()) return;
+        size = std::min(size, data_.size() - offset);
+        if (size == 0) return;
+
+#ifdef _WIN32
+        WIN32_MEMORY_RANGE_ENTRY range{ const_cast<std::byte*>(data_.data() + offset), size };
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+        // madvise wants a page aligned start
+        static const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        uintptr_t start = reinterpret_cast<uintptr_t>(data_.data() + offset);
+        uintptr_t aligned = start & ~(static_cast<uintptr_t>(pageSize) - 1);
+        ::madvise(reinterpret_cast<void*>(aligned), size + (start - aligned), MADV_WILLNEED);
+#endif
+    }
+
+    std::expected<MappedFile, IOError> MappedFile::Open(const std::filesystem::path& path) {
+        MappedFile file;
+
+        size_t mappedSize = 0;
+        if (void* view = MapReadOnly(path, mappedSize)) {
+            file.view_ = view;
+            file.data_ = std::span<const std::byte>(static_cast<const std::byte*>(view), mappedSize);
+            return file;
+        }
+
+        // Empty files cannot be mapped, and some filesystems refuse to map at all
+        auto buffered = ReadFile(path);
+        if (!buffered) {
+            return std::unexpected(buffered.error());
+        }
+
+        file.buffer_ = std::move(*buffered);
+        file.data_ = file.buffer_;
+        return file;
+    }
+
+    std::expected<void, IOError> DirectoryCache::ensure(const std::filesystem::path& directory) {
+        if (directory.empty()) return {};
+
+        std::string key = directory.generic_string();
+        {
+            std::lock_guard lock(mutex_);
+            if (known_.contains(key)) return {};
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec) {
+            return std::unexpected(IOError{ IOErrorCode::DirectoryCreationError, "Failed to create directory: " + directory.string() });
+        }
+
+        // Ancestors exist now as well, recording them saves the check for sibling folders
+        std::lock_guard lock(mutex_);
+        for (auto dir = directory; !dir.empty() && known_.insert(dir.generic_string()).second; dir = dir.parent_path()) {
+            if (dir == dir.parent_path()) break;
+        }
+        return {};
+    }
+
+    FileSink::~FileSink() {
+        release();
+    }
+
+    FileSink::FileSink(FileSink&& other) noexcept
+        : handle_(other.handle_), path_(std::move(other.path_)), written_(other.written_), preallocated_(other.preallocated_) {
+        other.handle_ = InvalidHandle;
+    }
+
+    FileSink& FileSink::operator=(FileSink&& other) noexcept {
+        if (this != &other) {
+            release();
+            handle_ = other.handle_;
+            path_ = std::move(other.path_);
+            written_ = other.written_;
+            preallocated_ = other.preallocated_;
+            other.handle_ = InvalidHandle;
+        }
+        return *this;
+    }
+
+    void FileSink::release() {
+        if (handle_ == InvalidHandle) return;
+#ifdef _WIN32
+        CloseHandle(handle_);
+#else
+        ::close(handle_);
+#endif
+        handle_ = InvalidHandle;
+    }
+
+    std::expected<FileSink, IOError> FileSink::Create(const std::filesystem::path& path, uint64_t expectedSize, DirectoryCache* directories) {
+        if (path.has_parent_path()) {
+            if (directories) {
+                auto ensured = directories->ensure(path.parent_path());
+                if (!ensured) return std::unexpected(ensured.error());
+            }
+            else {
+                std::error_code ec;
+                std::filesystem::create_directories(path.parent_path(), ec);
+                if (ec) {
+                    return std::unexpected(IOError{ IOErrorCode::DirectoryCreationError, "Failed to create directories for: " + path.string() });
+                }
+            }
+        }
+
+        FileSink sink;
+        sink.path_ = path;
+
+#ifdef _WIN32
+        sink.handle_ = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (sink.handle_ == InvalidHandle) {
+            return std::unexpected(IOError{ IOErrorCode::FileWriteError, "Failed to open file for writing (check permissions): " + path.string() });
+        }
+
+        // Reserves clusters without moving end of file, so nothing has to be zero filled. A hint only
+        if (expectedSize > 0) {
+            FILE_ALLOCATION_INFO allocation{};
+            allocation.AllocationSize.QuadPart = static_cast<LONGLONG>(expectedSize);
+            if (SetFileInformationByHandle(sink.handle_, FileAllocationInfo, &allocation, sizeof(allocation))) {
+                sink.preallocated_ = expectedSize;
+            }
+        }
+#else
+        sink.handle_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (sink.handle_ == InvalidHandle) {
+            return std::unexpected(IOError{ IOErrorCode::FileWriteError, "Failed to open file for writing (check permissions): " + path.string() });
+        }
+
+        // Extends the file, close() trims it back if less was written. A hint only
+        if (expectedSize > 0 && ::posix_fallocate(sink.handle_, 0, static_cast<off_t>(expectedSize)) == 0) {
+            sink.preallocated_ = expectedSize;
+        }
+#endif
+        return sink;
+    }
+
+    std::expected<void, IOError> FileSink::write(std::span<const std::byte> data) {
+        if (handle_ == InvalidHandle) {
+            return std::unexpected(IOError{ IOErrorCode::FileWriteError, "Write to closed file: " + path_.string() });
+        }
+
+        while (!data.empty()) {
+            // Both APIs take at most a 32-bit count per call
+            size_t chunk = std::min<size_t>(data.size(), 1u << 30);
+#ifdef _WIN32
+            DWORD done = 0;
+            if (!::WriteFile(handle_, data.data(), static_cast<DWORD>(chunk), &done, nullptr) || done == 0) {
+#else
+            ssize_t done = ::write(handle_, data.data(), chunk);
+            if (done <= 0) {
+#endif
+                return std::unexpected(IOError{ IOErrorCode::FileWriteError, "Stream error while writing (disk full?): " + path_.string() });
+            }
+            written_ += static_cast<uint64_t>(done);
+            data = data.subspan(static_cast<size_t>(done));
+        }
+        return {};
+    }
+
+    std::expected<void, IOError> FileSink::close() {
+        if (handle_ == InvalidHandle) return {};
+
+        bool ok = true;
+#ifdef _WIN32
+        // Closing releases any allocation past end of file, the file size is already what was written
+        ok = CloseHandle(handle_) != 0;
+#else
+        if (preallocated_ > written_) {
+            ok = ::ftruncate(handle_, static_cast<off_t>(written_)) == 0;
+        }
+        ok = (::close(handle_) == 0) && ok;
+#endif
+        handle_ = InvalidHandle;
+
+        if (!ok) {
+            return std::unexpected(IOError{ IOErrorCode::FileWriteError, "Failed to finalize file: " + path_.string() });
+        }
+        return {};
+    }
+}
@@ -2,6 +2,7 @@
 #include "replicant/core/reader.h"
 #include "replicant/core/writer.h"
 #include <cstring>
+#include <utility>
 
 namespace replicant {
 
@@ -13,57 +14,57 @@ namespace replicant {
             uint32_t unknown;
         };
 #pragma pack(pop)
-    }
 
-    KpkFile DeserializeInternal(std::span<const std::byte> data) {
-        Reader reader(data);
+        KpkFile DeserializeInternal(std::span<const std::byte> data) {
+            Reader reader(data);
 
-        const RawKpkHeader* header = reader.view<RawKpkHeader>();
+            const RawKpkHeader* header = reader.view<RawKpkHeader>();
 
-        // Magic can be either "KPK\x7F" or "KPKy"
-        if (std::strncmp(header->magic, "KPK\x7F", 4) != 0 && std::strncmp(header->magic, "KPKy", 4) != 0) {
-            throw ReaderException("Invalid KPK magic");
-        }
+            // Magic can be either "KPK\x7F" or "KPKy"
+            if (std::strncmp(header->magic, "KPK\x7F", 4) != 0 && std::strncmp(header->magic, "KPKy", 4) != 0) {
+                throw ReaderException("Invalid KPK magic");
+            }
 
-        KpkFile file;
-        std::memcpy(file.magic.data(), header->magic, 4);
-        file.unknown = header->unknown;
+            KpkFile file;
+            std::memcpy(file.magic.data(), header->magic, 4);
+            file.unknown = header->unknown;
 
-        auto offsets = reader.viewArray<uint32_t>(header->fileCount);
-        auto sizes = reader.viewArray<uint32_t>(header->fileCount);
+            auto offsets = reader.viewArray<uint32_t>(header->fileCount);
+            auto sizes = reader.viewArray<uint32_t>(header->fileCount);
 
-        uint32_t fileNameSize = *reader.view<uint32_t>();
+            uint32_t fileNameSize = *reader.view<uint32_t>();
 
-        std::span<const char> names;
-        if (fileNameSize > 0) {
-            names = reader.viewArray<char>(static_cast<size_t>(header->fileCount) * fileNameSize);
-        }
+            std::span<const char> names;
+            if (fileNameSize > 0) {
+                names = reader.viewArray<char>(static_cast<size_t>(header->fileCount) * fileNameSize);
+            }
 
-        file.entries.reserve(header->fileCount);
+            file.entries.reserve(header->fileCount);
 
-        for (uint32_t i = 0; i < header->fileCount; i++) {
-            KpkEntry entry;
+            for (uint32_t i = 0; i < header->fileCount; i++) {
+                KpkEntry entry;
 
-            if (fileNameSize > 0) {
-                const char* namePtr = names.data() + (static_cast<size_t>(i) * fileNameSize);
-                size_t len = strnlen(namePtr, fileNameSize);
-                entry.name = std::string(namePtr, len);
-            }
+                if (fileNameSize > 0) {
+                    const char* namePtr = names.data() + (static_cast<size_t>(i) * fileNameSize);
+                    size_t len = strnlen(namePtr, fileNameSize);
+                    entry.name = std::string(namePtr, len);
+                }
 
-            // Read Data
-            if (offsets[i] > 0) {
-                // KPK uses absolute offsets relative to the start of the file
-                if (offsets[i] + sizes[i] > data.size()) {
-                    throw ReaderException("KPK entry data exceeds file bounds");
+                // Read Data
+                if (offsets[i] > 0) {
+                    // KPK uses absolute offsets relative to the start of the file
+                    if (offsets[i] + sizes[i] > data.size()) {
+                        throw ReaderException("KPK entry data exceeds file bounds");
+                    }
+                    const std::byte* entryData = data.data() + offsets[i];
+                    entry.data.assign(entryData, entryData + sizes[i]);
                 }
-                const std::byte* entryData = data.data() + offsets[i];
-                entry.data.assign(entryData, entryData + sizes[i]);
+
+                file.entries.push_back(std::move(entry));
             }
 
-            file.entries.push_back(std::move(entry));
+            return file;
         }
-
-        return file;
     }
 
     std::expected<KpkFile, Error> KpkFile::Deserialize(std::span<const std::byte> data) {
@@ -148,17 +149,23 @@ namespace replicant {
     }
 
     KpkEntry* KpkFile::findFile(const std::string& name) {
-        for (auto& entry : entries) {
-            if (entry.name == name) return &entry;
-        }
-        return nullptr;
+        index_.sync(entries, [](const KpkEntry& e) { return fnv1_32(e.name); });
+        return const_cast<KpkEntry*>(std::as_const(*this).findFile(name));
     }
 
     const KpkEntry* KpkFile::findFile(const std::string& name) const {
-        for (const auto& entry : entries) {
-            if (entry.name == name) return &entry;
-        }
-        return nullptr;
+        size_t pos = index_.find(entries, fnv1_32(name), [&](const KpkEntry& e) { return e.name == name; });
+        return pos < entries.size() ? &entries[pos] : nullptr;
+    }
+
+    KpkEntry* KpkFile::findByHash(uint32_t nameHash) {
+        index_.sync(entries, [](const KpkEntry& e) { return fnv1_32(e.name); });
+        return const_cast<KpkEntry*>(std::as_const(*this).findByHash(nameHash));
+    }
+
+    const KpkEntry* KpkFile::findByHash(uint32_t nameHash) const {
+        size_t pos = index_.find(entries, nameHash, [&](const KpkEntry& e) { return fnv1_32(e.name) == nameHash; });
+        return pos < entries.size() ? &entries[pos] : nullptr;
     }
 
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <utility>
 
 namespace replicant {
 
@@ -50,7 +51,7 @@ namespace replicant {
         };
     }
 
-    Pack DeserializeInternal(std::span<const std::byte> data, bool skipResources) {
+    PackView DeserializeInternal(std::span<const std::byte> data, bool skipResources) {
         Reader reader(data);
 
         // Header
@@ -61,10 +62,11 @@ namespace replicant {
 			throw ReaderException("Invalid PACK magic");
         }
 
-        Pack pack;
+        PackView pack;
         pack.info.version = rawHeader->version;
 
-        if (rawHeader->totalSize > data.size()) {
+        // Without resources only the serialized block is passed in
+        if (!skipResources && rawHeader->totalSize > data.size()) {
 			throw ReaderException("TotalSize exceeds file size");
         }
 
@@ -83,10 +85,10 @@ namespace replicant {
 
             pack.imports.reserve(rawHeader->importsCount);
             for (uint32_t i = 0; i < rawHeader->importsCount; i++) {
-                ImportEntry entry;
+                ImportView entry;
                 entry.pathHash = rawImports[i].pathHash;
 
-                entry.path = reader.readStringRelative(rawImports[i].offsetToPath);
+                entry.path = reader.readStringViewRelative(rawImports[i].offsetToPath);
 
                 pack.imports.push_back(entry);
             }
@@ -99,16 +101,16 @@ namespace replicant {
 
             pack.assetPackages.reserve(rawHeader->assetPackagesCount);
             for (uint32_t i = 0; i < rawHeader->assetPackagesCount; i++) {
-                AssetPackageEntry entry;
+                AssetPackageView entry;
                 entry.nameHash = rawAP[i].nameHash;
 
-                entry.name = reader.readStringRelative(rawAP[i].offsetToName);
+                entry.name = reader.readStringViewRelative(rawAP[i].offsetToName);
 
                 auto contentPtrRes = reader.getOffsetPtr(rawAP[i].offsetToContentStart);
                 if (contentPtrRes) {
-                    const std::byte* start = reinterpret_cast<const std::byte*>(*contentPtrRes);
+                    const std::byte* start = reinterpret_cast<const std::byte*>(contentPtrRes);
                     if (start >= data.data() && start + rawAP[i].contentSize <= data.data() + data.size()) {
-                        entry.content.assign(start, start + rawAP[i].contentSize);
+                        entry.content = std::span<const std::byte>(start, rawAP[i].contentSize);
                     }
                 }
                 pack.assetPackages.push_back(entry);
@@ -125,17 +127,17 @@ namespace replicant {
             pack.files.reserve(rawHeader->filesCount);
 
             for (uint32_t i = 0; i < rawHeader->filesCount; i++) {
-                PackFileEntry entry;
+                PackFileView entry;
                 entry.nameHash = rawFiles[i].nameHash;
 
-                entry.name = reader.readStringRelative(rawFiles[i].offsetToName);
+                entry.name = reader.readStringViewRelative(rawFiles[i].offsetToName);
 
                 // Serialized Data
                 auto contentPtrRes = reader.getOffsetPtr(rawFiles[i].offsetToContent);
                 if (contentPtrRes) {
                     const std::byte* start = reinterpret_cast<const std::byte*>(contentPtrRes);
                     if (start >= data.data() && start + rawFiles[i].contentSize <= data.data() + data.size()) {
-                        entry.serializedData.assign(start, start + rawFiles[i].contentSize);
+                        entry.serializedData = std::span<const std::byte>(start, rawFiles[i].contentSize);
                     }
                 }
 
@@ -177,9 +179,9 @@ namespace replicant {
 						throw ReaderException("Resource data exceeds file size");
                     }
 
-                    pack.files[resources[i].fileIndex].resourceData.assign(
+                    pack.files[resources[i].fileIndex].resourceData = std::span<const std::byte>(
                         resourceBlockBase + currentOffset,
-                        resourceBlockBase + currentOffset + size
+                        size
                     );
                 }
             }
@@ -188,7 +190,7 @@ namespace replicant {
         return pack;
     }
 
-    std::expected<Pack, Error> Pack::Deserialize(std::span<const std::byte> data) {
+    std::expected<PackView, Error> PackView::Deserialize(std::span<const std::byte> data) {
         try {
             return DeserializeInternal(data, false);
         }
@@ -200,6 +202,56 @@ namespace replicant {
         }
     }
 
+    Pack PackView::toPack() const {
+        Pack pack;
+        pack.info = info;
+
+        pack.imports.reserve(imports.size());
+        for (const auto& imp : imports) {
+            pack.imports.push_back({ imp.pathHash, std::string(imp.path) });
+        }
+
+        pack.assetPackages.reserve(assetPackages.size());
+        for (const auto& ap : assetPackages) {
+            AssetPackageEntry entry;
+            entry.nameHash = ap.nameHash;
+            entry.name = ap.name;
+            entry.content.assign(ap.content.begin(), ap.content.end());
+            pack.assetPackages.push_back(std::move(entry));
+        }
+
+        pack.files.reserve(files.size());
+        for (const auto& f : files) {
+            PackFileEntry entry;
+            entry.nameHash = f.nameHash;
+            entry.name = f.name;
+            entry.serializedData.assign(f.serializedData.begin(), f.serializedData.end());
+            entry.resourceData.assign(f.resourceData.begin(), f.resourceData.end());
+            pack.files.push_back(std::move(entry));
+        }
+
+        return pack;
+    }
+
+    const PackFileView* PackView::findFile(std::string_view name) const {
+        for (const auto& f : files) {
+            if (f.name == name) return &f;
+        }
+        return nullptr;
+    }
+
+    std::expected<Pack, Error> Pack::Deserialize(std::span<const std::byte> data) {
+        try {
+            return DeserializeInternal(data, false).toPack();
+        }
+        catch (const ReaderException& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what()});
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
+        }
+    }
+
     std::vector<std::byte> Pack::SerializeInternal() const {
         Writer writer;
         StringPool stringPool;
@@ -368,7 +420,7 @@ namespace replicant {
                 throw ReaderException("Failed to read serialized data");
             }
 
-            return DeserializeInternal(serializedData, true);
+            return DeserializeInternal(serializedData, true).toPack();
         }
         catch (const ReaderException& ex) {
             return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
@@ -395,10 +447,17 @@ namespace replicant {
                 throw ReaderException("Invalid PACK magic");
 			}
 
+            file.seekg(0, std::ios::end);
+            std::streamoff physicalSize = file.tellg();
+            if (physicalSize < 0) {
+                throw ReaderException("Failed to determine file size");
+            }
+
             return PackFileSizes{
                 .serializedSize = rawHeader.serializedSize,
                 .resourceSize = rawHeader.resourceSize,
-				.fileSize = rawHeader.totalSize
+				.fileSize = rawHeader.totalSize,
+                .physicalSize = static_cast<uint64_t>(physicalSize)
             };
         }
         catch (const ReaderException& ex) {
@@ -410,6 +469,169 @@ namespace replicant {
     }
 
 
+    PackProbe ProbeInternal(const std::filesystem::path& filePath) {
+        std::ifstream file(filePath, std::ios::binary);
+        if (!file) {
+            throw ReaderException("Failed to open file for reading");
+        }
+
+        RawPackHeader rawHeader{};
+        file.read(reinterpret_cast<char*>(&rawHeader), sizeof(RawPackHeader));
+        if (file.gcount() != sizeof rawHeader) {
+            throw ReaderException("Failed to read RawPackHeader");
+        }
+
+        if (std::strncmp(rawHeader.magic, "PACK", 4) != 0) {
+            throw ReaderException("Invalid PACK magic");
+        }
+
+        if (rawHeader.serializedSize < sizeof(RawPackHeader) || rawHeader.serializedSize > std::filesystem::file_size(filePath)) {
+            throw ReaderException("Invalid serialized size");
+        }
+
+        // Table offsets are relative to the header field holding them
+
+        auto tableEnd = [&](const uint32_t& field, uint32_t count, size_t stride) -> uint64_t {
+            if (count == 0) return sizeof(RawPackHeader);
+            uint64_t fieldPos = reinterpret_cast<const char*>(&field) - reinterpret_cast<const char*>(&rawHeader);
+            return fieldPos + field + static_cast<uint64_t>(count) * stride;
+        };
+
+        uint64_t tablesEnd = std::max({
+            tableEnd(rawHeader.offsetToImports, rawHeader.importsCount, sizeof(RawImport)),
+            tableEnd(rawHeader.offsetToAssetPackages, rawHeader.assetPackagesCount, sizeof(RawAssetPackage)),
+            tableEnd(rawHeader.offsetToFiles, rawHeader.filesCount, sizeof(RawFile))
+        });
+
+        if (tablesEnd > rawHeader.serializedSize) {
+            throw ReaderException("PACK tables exceed serialized size");
+        }
+
+        auto readRange = [&](std::vector<std::byte>& buffer, uint64_t begin, uint64_t end) {
+            buffer.resize(end);
+            file.seekg(begin, std::ios::beg);
+            file.read(reinterpret_cast<char*>(buffer.data() + begin), end - begin);
+            if (file.gcount() != static_cast<std::streamsize>(end - begin)) {
+                throw ReaderException("Failed to read PACK tables");
+            }
+        };
+
+        std::vector<std::byte> buffer;
+        readRange(buffer, 0, tablesEnd);
+
+        // The string pool sits between the tables and the first content block, so only read up to there
+
+        uint64_t poolEnd = rawHeader.serializedSize;
+        uint64_t lastNameStart = 0;
+        {
+            Reader reader(buffer);
+            const RawPackHeader* header = reader.view<RawPackHeader>();
+
+            auto targetPos = [&](const uint32_t& field) -> uint64_t {
+                return static_cast<uint64_t>(reinterpret_cast<const std::byte*>(&field) - buffer.data()) + field;
+            };
+            auto noteContent = [&](const uint32_t& field) {
+                uint64_t pos = targetPos(field);
+                if (pos >= tablesEnd && pos < poolEnd) poolEnd = pos;
+            };
+            auto noteName = [&](const uint32_t& field) {
+                if (field != 0) lastNameStart = std::max(lastNameStart, targetPos(field));
+            };
+
+            if (header->importsCount > 0) {
+                auto rawImports = reinterpret_cast<const RawImport*>(reader.getOffsetPtr(header->offsetToImports));
+                for (uint32_t i = 0; i < header->importsCount; i++) noteName(rawImports[i].offsetToPath);
+            }
+            if (header->assetPackagesCount > 0) {
+                auto rawAP = reinterpret_cast<const RawAssetPackage*>(reader.getOffsetPtr(header->offsetToAssetPackages));
+                for (uint32_t i = 0; i < header->assetPackagesCount; i++) {
+                    noteName(rawAP[i].offsetToName);
+                    noteContent(rawAP[i].offsetToContentStart);
+                }
+            }
+            if (header->filesCount > 0) {
+                auto rawFiles = reinterpret_cast<const RawFile*>(reader.getOffsetPtr(header->offsetToFiles));
+                for (uint32_t i = 0; i < header->filesCount; i++) {
+                    noteName(rawFiles[i].offsetToName);
+                    noteContent(rawFiles[i].offsetToContent);
+                }
+            }
+        }
+
+        // Unusual layout with names after the content, fall back to the whole serialized block
+        if (lastNameStart >= poolEnd) {
+            poolEnd = rawHeader.serializedSize;
+        }
+        if (poolEnd > tablesEnd) {
+            readRange(buffer, tablesEnd, poolEnd);
+        }
+
+        Reader reader(buffer);
+        const RawPackHeader* header = reader.view<RawPackHeader>();
+
+        PackProbe probe;
+        probe.info.version = header->version;
+        probe.serializedSize = header->serializedSize;
+        probe.resourceSize = header->resourceSize;
+
+        if (header->importsCount > 0) {
+            auto rawImports = reinterpret_cast<const RawImport*>(reader.getOffsetPtr(header->offsetToImports));
+            probe.imports.reserve(header->importsCount);
+            for (uint32_t i = 0; i < header->importsCount; i++) {
+                probe.imports.push_back({ rawImports[i].pathHash, reader.readStringRelative(rawImports[i].offsetToPath) });
+            }
+        }
+
+        if (header->assetPackagesCount > 0) {
+            auto rawAP = reinterpret_cast<const RawAssetPackage*>(reader.getOffsetPtr(header->offsetToAssetPackages));
+            probe.assetPackages.reserve(header->assetPackagesCount);
+            for (uint32_t i = 0; i < header->assetPackagesCount; i++) {
+                probe.assetPackages.push_back({ rawAP[i].nameHash, reader.readStringRelative(rawAP[i].offsetToName), rawAP[i].contentSize, 0 });
+            }
+        }
+
+        if (header->filesCount > 0) {
+            auto rawFiles = reinterpret_cast<const RawFile*>(reader.getOffsetPtr(header->offsetToFiles));
+
+            std::vector<ResourceInfo> resources;
+            probe.files.reserve(header->filesCount);
+            for (uint32_t i = 0; i < header->filesCount; i++) {
+                probe.files.push_back({ rawFiles[i].nameHash, reader.readStringRelative(rawFiles[i].offsetToName), rawFiles[i].contentSize, 0 });
+
+                if (rawFiles[i].dataOffset.has_data) {
+                    resources.push_back({ rawFiles[i].dataOffset.offset, i });
+                }
+            }
+
+            // Same inference as DeserializeInternal, each resource runs up to the next one
+            std::sort(resources.begin(), resources.end(), [](const ResourceInfo& a, const ResourceInfo& b) {
+                return a.offset < b.offset;
+                });
+
+            for (size_t i = 0; i < resources.size(); ++i) {
+                uint32_t nextOffset = (i + 1 < resources.size()) ? resources[i + 1].offset : header->resourceSize;
+                if (nextOffset < resources[i].offset) {
+                    throw ReaderException("Resource offsets are out of order");
+                }
+                probe.files[resources[i].fileIndex].resourceSize = nextOffset - resources[i].offset;
+            }
+        }
+
+        return probe;
+    }
+
+    std::expected<PackProbe, Error> Pack::Probe(const std::filesystem::path& filePath) {
+        try {
+            return ProbeInternal(filePath);
+        }
+        catch (const ReaderException& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
+        }
+    }
+
     std::expected<std::vector<std::byte>, Error> Pack::Serialize() const {
         try {
             return SerializeInternal();
@@ -420,16 +642,23 @@ namespace replicant {
     }
 
     PackFileEntry* Pack::findFile(const std::string& name) {
-        for (auto& f : files) {
-            if (f.name == name) return &f;
-        }
-        return nullptr;
+        index_.sync(files, [](const PackFileEntry& f) { return fnv1_32(f.name); });
+        return const_cast<PackFileEntry*>(std::as_const(*this).findFile(name));
     }
 
     const PackFileEntry* Pack::findFile(const std::string& name) const {
-        for (const auto& f : files) {
-            if (f.name == name) return &f;
-        }
-        return nullptr;
+        size_t pos = index_.find(files, fnv1_32(name), [&](const PackFileEntry& f) { return f.name == name; });
+        return pos < files.size() ? &files[pos] : nullptr;
+    }
+
+    PackFileEntry* Pack::findByHash(uint32_t nameHash) {
+        hashIndex_.sync(files, [](const PackFileEntry& f) { return f.nameHash; });
+        return const_cast<PackFileEntry*>(std::as_const(*this).findByHash(nameHash));
+    }
+
+    // Stored hashes are not guaranteed to match the name (tools may leave them unset), so they get their own index
+    const PackFileEntry* Pack::findByHash(uint32_t nameHash) const {
+        size_t pos = hashIndex_.find(files, nameHash, [&](const PackFileEntry& f) { return f.nameHash == nameHash; });
+        return pos < files.size() ? &files[pos] : nullptr;
     }
 }
\ No newline at end of file
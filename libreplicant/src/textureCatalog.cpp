@@ -0,0 +1,119 @@
+#include "replicant/textureCatalog.h"
+#include "replicant/core/io.h"
+#include "replicant/core/parallel.h"
+#include "replicant/textureHashIndex.h"
+#include <fstream>
+#include <mutex>
+#include <optional>
+
+namespace replicant::dds {
+
+    namespace {
+        // Enough for the DDS header and the DX10 extension header
+        constexpr size_t PROBE_SIZE = 148;
+
+        std::expected<DDSHeaderInfo, Error> ProbeFile(const std::filesystem::path& path) {
+            std::error_code ec;
+            uint64_t fileSize = std::filesystem::file_size(path, ec);
+            if (ec) return std::unexpected(Error{ ErrorCode::IoError, "Could not get file size: " + path.string() });
+
+            std::ifstream file(path, std::ios::binary);
+            if (!file) return std::unexpected(Error{ ErrorCode::IoError, "Could not open " + path.string() });
+
+            std::byte header[PROBE_SIZE];
+            file.read(reinterpret_cast<char*>(header), sizeof(header));
+            size_t read = static_cast<size_t>(file.gcount());
+
+            return ProbeHeader(std::span<const std::byte>(header, read), fileSize);
+        }
+
+        bool SameLayout(const DDSHeaderInfo& a, const DDSHeaderInfo& b) {
+            return a.width == b.width && a.height == b.height && a.depth == b.depth && a.mipLevels == b.mipLevels &&
+                a.arraySize == b.arraySize && a.format == b.format && a.dimension == b.dimension &&
+                a.dataOffset == b.dataOffset && a.dataSize == b.dataSize;
+        }
+    }
+
+    struct TextureCatalog::Slot {
+        std::once_flag loaded;
+        std::vector<std::byte> file;
+        std::optional<Error> error;
+    };
+
+    TextureCatalog::TextureCatalog() = default;
+    TextureCatalog::~TextureCatalog() = default;
+    TextureCatalog::TextureCatalog(TextureCatalog&&) noexcept = default;
+    TextureCatalog& TextureCatalog::operator=(TextureCatalog&&) noexcept = default;
+
+    bool TextureCatalog::IsHashName(std::string_view name) {
+        return TextureHashIndex::ParseHashName(name).has_value();
+    }
+
+    TextureCatalog TextureCatalog::Build(std::span<const TextureSource> sources, unsigned jobs) {
+        TextureCatalog catalog;
+
+        // Resolve overrides first so replaced files are never probed
+        std::unordered_map<std::string_view, size_t> winner;
+        for (size_t i = 0; i < sources.size(); ++i) winner[sources[i].name] = i;
+
+        std::vector<size_t> toProbe;
+        toProbe.reserve(winner.size());
+        for (size_t i = 0; i < sources.size(); ++i) {
+            if (winner[sources[i].name] == i) toProbe.push_back(i);
+        }
+
+        std::vector<std::optional<std::expected<DDSHeaderInfo, Error>>> probes(toProbe.size());
+        ParallelFor(toProbe.size(), jobs, [&](size_t job) {
+            probes[job] = ProbeFile(sources[toProbe[job]].path);
+        });
+
+        catalog.textures_.reserve(toProbe.size());
+        for (size_t job = 0; job < toProbe.size(); ++job) {
+            const TextureSource& source = sources[toProbe[job]];
+            auto& probe = *probes[job];
+
+            if (!probe) {
+                catalog.rejected_.push_back({ source.name, source.path, std::move(probe.error()) });
+                continue;
+            }
+
+            catalog.byName_.emplace(source.name, catalog.textures_.size());
+            catalog.textures_.push_back({ source.name, source.path, *probe });
+            catalog.hasHashNames_ |= IsHashName(source.name);
+        }
+
+        catalog.slots_ = std::make_unique<Slot[]>(catalog.textures_.size());
+        return catalog;
+    }
+
+    const CatalogTexture* TextureCatalog::find(std::string_view name) const {
+        auto it = byName_.find(name);
+        return it != byName_.end() ? &textures_[it->second] : nullptr;
+    }
+
+    std::expected<std::span<const std::byte>, Error> TextureCatalog::pixels(const CatalogTexture& texture) const {
+        if (&texture < textures_.data() || &texture >= textures_.data() + textures_.size()) {
+            return std::unexpected(Error{ ErrorCode::InvalidArguments, "Texture is not part of this catalog" });
+        }
+        Slot& slot = slots_[&texture - textures_.data()];
+
+        std::call_once(slot.loaded, [&] {
+            auto data = ReadFile(texture.path);
+            if (!data) {
+                slot.error = Error{ ErrorCode::IoError, data.error().message };
+                return;
+            }
+
+            // The file may have been swapped since the catalog was built, the header checks were made against the old one
+            auto probe = ProbeHeader(*data);
+            if (!probe || !SameLayout(*probe, texture.header)) {
+                slot.error = Error{ ErrorCode::ParseError, texture.path.string() + " changed since the mods were scanned" };
+                return;
+            }
+            slot.file = std::move(*data);
+        });
+
+        if (slot.error) return std::unexpected(*slot.error);
+        return std::span<const std::byte>(slot.file).subspan(texture.header.dataOffset, texture.header.dataSize);
+    }
+}
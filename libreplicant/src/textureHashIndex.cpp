@@ -0,0 +1,338 @@
+#include "replicant/textureHashIndex.h"
+#include "replicant/core/reader.h"
+#include "replicant/core/writer.h"
+#include "replicant/core/parallel.h"
+#include "replicant/core/crc32c.h"
+#include "replicant/core/io.h"
+#include "replicant/assetIndex.h"
+#include "replicant/pack.h"
+#include "replicant/bxon.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+namespace replicant {
+
+    namespace {
+        constexpr char IndexMagic[4] = { 'L', 'T', 'T', 'H' };
+        constexpr uint32_t IndexVersion = 1;
+
+#pragma pack(push, 1)
+        struct RawIndexHeader {
+            char     magic[4];
+            uint32_t version;
+            uint32_t packCount;
+            uint32_t offsetToPacks;
+            uint32_t lookupCount;
+            uint32_t offsetToLookup;
+        };
+
+        struct RawIndexPack {
+            uint32_t offsetToPath;
+            uint32_t textureCount;
+            int64_t  mtime;
+            uint64_t fileSize;
+            uint32_t offsetToTextures;
+        };
+
+        struct RawIndexTexture {
+            uint32_t crc;
+            uint32_t offsetToName;
+        };
+
+        struct RawIndexLookup {
+            uint32_t crc;
+            uint32_t packIndex;
+            uint32_t textureIndex;
+        };
+#pragma pack(pop)
+
+        template <typename T>
+        std::span<const T> ViewTable(Reader& reader, const uint32_t& offsetField, uint32_t count) {
+            if (count == 0) return {};
+            reader.seek(reader.getOffsetPtr(offsetField));
+            return reader.viewArray<T>(count);
+        }
+
+        bool IsIndexFile(const std::filesystem::path& path) {
+            auto ext = path.extension();
+            return ext == std::filesystem::path(TextureHashIndex::DefaultFileName).extension() ||
+                ext == std::filesystem::path(AssetIndex::DefaultFileName).extension();
+        }
+
+        // Files that fail to map or are not PACKs come back without textures
+        std::vector<TextureHashEntry> HashPack(const std::filesystem::path& path) {
+            std::vector<TextureHashEntry> textures;
+
+            auto file = MappedFile::Open(path);
+            if (!file) return textures;
+
+            auto view = PackView::Deserialize(file->data());
+            if (!view) return textures;
+
+            for (const auto& entry : view->files) {
+                if (!entry.hasResource()) continue;
+
+                auto bxon = ParseBxon(entry.serializedData);
+                if (!bxon || bxon->first.assetType != "tpGxTexHead") continue;
+
+                auto header = DeserializeTexHead(bxon->second);
+                if (!header) continue;
+
+                auto crc = TextureHashIndex::HashTexture(*header, entry.resourceData);
+                if (crc) textures.push_back({ *crc, std::string(entry.name) });
+            }
+            return textures;
+        }
+    }
+
+    TextureHashIndex TextureHashIndex::DeserializeInternal(std::span<const std::byte> data) {
+        Reader reader(data);
+        const auto* header = reader.view<RawIndexHeader>();
+
+        if (std::memcmp(header->magic, IndexMagic, 4) != 0) {
+            throw ReaderException("Invalid texture hash index magic");
+        }
+        if (header->version != IndexVersion) {
+            throw ReaderException("Unsupported texture hash index version");
+        }
+
+        TextureHashIndex index;
+        auto rawPacks = ViewTable<RawIndexPack>(reader, header->offsetToPacks, header->packCount);
+        index.packs.reserve(rawPacks.size());
+
+        for (const auto& rawPack : rawPacks) {
+            TextureHashPack& pack = index.packs.emplace_back();
+            pack.path = reader.readStringRelative(rawPack.offsetToPath);
+            pack.mtime = rawPack.mtime;
+            pack.fileSize = rawPack.fileSize;
+
+            auto rawTextures = ViewTable<RawIndexTexture>(reader, rawPack.offsetToTextures, rawPack.textureCount);
+            pack.textures.reserve(rawTextures.size());
+            for (const auto& rawTexture : rawTextures) {
+                pack.textures.push_back({ rawTexture.crc, reader.readStringRelative(rawTexture.offsetToName) });
+            }
+        }
+
+        auto rawLookups = ViewTable<RawIndexLookup>(reader, header->offsetToLookup, header->lookupCount);
+        index.lookup_.reserve(rawLookups.size());
+        for (const auto& rawLookup : rawLookups) {
+            if (rawLookup.packIndex >= index.packs.size() ||
+                rawLookup.textureIndex >= index.packs[rawLookup.packIndex].textures.size()) {
+                throw ReaderException("Texture hash lookup points past the texture tables");
+            }
+            index.lookup_.push_back({ rawLookup.crc, rawLookup.packIndex, rawLookup.textureIndex });
+        }
+
+        return index;
+    }
+
+    std::expected<TextureHashIndex, Error> TextureHashIndex::Deserialize(std::span<const std::byte> data) {
+        try {
+            return DeserializeInternal(data);
+        }
+        catch (const ReaderException& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::ParseError, ex.what() });
+        }
+    }
+
+    std::vector<std::byte> TextureHashIndex::SerializeInternal() const {
+        Writer writer;
+        StringPool pool;
+
+        writer.write(IndexMagic, 4);
+        writer.write<uint32_t>(IndexVersion);
+        writer.write<uint32_t>(static_cast<uint32_t>(packs.size()));
+        size_t tokenPacks = writer.reserveOffset();
+        writer.write<uint32_t>(static_cast<uint32_t>(lookup_.size()));
+        size_t tokenLookup = writer.reserveOffset();
+
+        std::vector<size_t> textureTokens;
+        textureTokens.reserve(packs.size());
+
+        writer.align(8);
+        writer.satisfyOffsetHere(tokenPacks);
+        for (const auto& pack : packs) {
+            pool.add(pack.path, writer.reserveOffset());
+            writer.write<uint32_t>(static_cast<uint32_t>(pack.textures.size()));
+            writer.write<int64_t>(pack.mtime);
+            writer.write<uint64_t>(pack.fileSize);
+            textureTokens.push_back(writer.reserveOffset());
+        }
+
+        for (size_t i = 0; i < packs.size(); ++i) {
+            if (packs[i].textures.empty()) continue;
+            writer.satisfyOffsetHere(textureTokens[i]);
+            for (const auto& texture : packs[i].textures) {
+                writer.write<uint32_t>(texture.crc);
+                pool.add(texture.name, writer.reserveOffset());
+            }
+        }
+
+        writer.satisfyOffsetHere(tokenLookup);
+        for (const auto& lookup : lookup_) {
+            writer.write(RawIndexLookup{ lookup.crc, lookup.packIndex, lookup.textureIndex });
+        }
+
+        pool.flush(writer);
+        return writer.buffer();
+    }
+
+    std::expected<std::vector<std::byte>, Error> TextureHashIndex::Serialize() const {
+        try {
+            return SerializeInternal();
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::SystemError, ex.what() });
+        }
+    }
+
+    void TextureHashIndex::buildLookup() {
+        lookup_.clear();
+        for (uint32_t p = 0; p < packs.size(); ++p) {
+            for (uint32_t t = 0; t < packs[p].textures.size(); ++t) {
+                lookup_.push_back({ packs[p].textures[t].crc, p, t });
+            }
+        }
+
+        std::sort(lookup_.begin(), lookup_.end(), [](const Lookup& a, const Lookup& b) {
+            if (a.crc != b.crc) return a.crc < b.crc;
+            return a.packIndex != b.packIndex ? a.packIndex < b.packIndex : a.textureIndex < b.textureIndex;
+            });
+    }
+
+    std::expected<TextureHashIndexUpdateStats, Error> TextureHashIndex::Update(const std::filesystem::path& root, unsigned jobs) {
+        struct Candidate {
+            std::filesystem::path fullPath;
+            std::string relPath;
+            int64_t mtime;
+            uint64_t fileSize;
+        };
+
+        std::vector<Candidate> candidates;
+        try {
+            for (const auto& dirEntry : std::filesystem::recursive_directory_iterator(root)) {
+                if (!dirEntry.is_regular_file()) continue;
+                if (IsIndexFile(dirEntry.path())) continue;
+
+                candidates.push_back({
+                    dirEntry.path(),
+                    dirEntry.path().lexically_relative(root).generic_string(),
+                    static_cast<int64_t>(dirEntry.last_write_time().time_since_epoch().count()),
+                    static_cast<uint64_t>(dirEntry.file_size())
+                });
+            }
+        }
+        catch (const std::filesystem::filesystem_error& ex) {
+            return std::unexpected(Error{ ErrorCode::IoError, ex.what() });
+        }
+
+        std::unordered_map<std::string_view, size_t> previous;
+        previous.reserve(packs.size());
+        for (size_t i = 0; i < packs.size(); ++i) {
+            previous.emplace(packs[i].path, i);
+        }
+
+        TextureHashIndexUpdateStats stats;
+        std::vector<TextureHashPack> updated(candidates.size());
+        std::vector<size_t> reuseFrom(candidates.size(), SIZE_MAX);
+        std::vector<size_t> toScan;
+        std::vector<char> kept(packs.size(), 0);
+
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            auto it = previous.find(candidates[i].relPath);
+            if (it != previous.end()) {
+                kept[it->second] = 1;
+                const TextureHashPack& old = packs[it->second];
+                if (old.mtime == candidates[i].mtime && old.fileSize == candidates[i].fileSize) {
+                    reuseFrom[i] = it->second;
+                    continue;
+                }
+            }
+            toScan.push_back(i);
+        }
+
+        // Only moved once all lookups are done, the map keys view the old paths
+        previous.clear();
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (reuseFrom[i] != SIZE_MAX) {
+                updated[i] = std::move(packs[reuseFrom[i]]);
+                stats.reused++;
+            }
+        }
+
+        for (char k : kept) {
+            if (!k) stats.removed++;
+        }
+
+        try {
+            ParallelFor(toScan.size(), jobs, [&](size_t job) {
+                size_t i = toScan[job];
+                updated[i].textures = HashPack(candidates[i].fullPath);
+            });
+        }
+        catch (const std::exception& ex) {
+            return std::unexpected(Error{ ErrorCode::SystemError, ex.what() });
+        }
+        stats.scanned = toScan.size();
+
+        for (size_t i : toScan) stats.textures += updated[i].textures.size();
+
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            updated[i].path = std::move(candidates[i].relPath);
+            updated[i].mtime = candidates[i].mtime;
+            updated[i].fileSize = candidates[i].fileSize;
+        }
+
+        std::sort(updated.begin(), updated.end(), [](const TextureHashPack& a, const TextureHashPack& b) {
+            return a.path < b.path;
+            });
+
+        packs = std::move(updated);
+        buildLookup();
+        return stats;
+    }
+
+    std::vector<TextureHashMatch> TextureHashIndex::find(uint32_t crc) const {
+        std::vector<TextureHashMatch> result;
+
+        auto it = std::lower_bound(lookup_.begin(), lookup_.end(), crc, [](const Lookup& a, uint32_t value) {
+            return a.crc < value;
+            });
+
+        for (; it != lookup_.end() && it->crc == crc; ++it) {
+            const TextureHashPack& pack = packs[it->packIndex];
+            result.push_back({ &pack, &pack.textures[it->textureIndex] });
+        }
+        return result;
+    }
+
+    std::optional<uint32_t> TextureHashIndex::HashTexture(const TextureHeader& header, std::span<const std::byte> pixelData) {
+        // The loader hashes sliceSize bytes from the start of the pixel data, whatever the first mip's offset
+        if (header.mips.empty() || header.mips[0].sliceSize > pixelData.size()) return std::nullopt;
+        return crc32c(pixelData.first(header.mips[0].sliceSize));
+    }
+
+    std::optional<uint32_t> TextureHashIndex::ParseHashName(std::string_view fileName) {
+        if (fileName.size() != 12) return std::nullopt;
+
+        std::string_view ext = fileName.substr(8);
+        if (ext[0] != '.' || (ext[1] | 0x20) != 'd' || (ext[2] | 0x20) != 'd' || (ext[3] | 0x20) != 's') return std::nullopt;
+
+        uint32_t crc = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            char c = fileName[i];
+            uint32_t digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            else return std::nullopt;
+            crc = (crc << 4) | digit;
+        }
+        return crc;
+    }
+}
@@ -37,73 +37,72 @@ namespace replicant {
         };
 #pragma pack(pop)
 
-    }
-
-    TpArchiveFileParam DeserializeInternal(std::span<const std::byte> payload) {
+        TpArchiveFileParam DeserializeInternal(std::span<const std::byte> payload) {
 
-        Reader reader(payload);
+            Reader reader(payload);
 
-        auto rawHeader = reader.view<RawHeader>();
+            auto rawHeader = reader.view<RawHeader>();
 
-        TpArchiveFileParam asset;
+            TpArchiveFileParam asset;
 
-        if (rawHeader->numArchives > 0) {
-            auto arcArray = reader.getOffsetPtr(rawHeader->offsetToArray);
+            if (rawHeader->numArchives > 0) {
+                auto arcArray = reader.getOffsetPtr(rawHeader->offsetToArray);
 
-            const std::byte* start = reinterpret_cast<const std::byte*>(arcArray);
-            const std::byte* end = payload.data() + payload.size();
-            if (start + (rawHeader->numArchives * sizeof(RawArchiveEntry)) > end) {
-				throw ReaderException("Archive array exceeds buffer size");
-            }
+                const std::byte* start = reinterpret_cast<const std::byte*>(arcArray);
+                const std::byte* end = payload.data() + payload.size();
+                if (start + (rawHeader->numArchives * sizeof(RawArchiveEntry)) > end) {
+                    throw ReaderException("Archive array exceeds buffer size");
+                }
 
-            const RawArchiveEntry* rawArcs = reinterpret_cast<const RawArchiveEntry*>(arcArray);
-            asset.archiveEntries.reserve(rawHeader->numArchives);
+                const RawArchiveEntry* rawArcs = reinterpret_cast<const RawArchiveEntry*>(arcArray);
+                asset.archiveEntries.reserve(rawHeader->numArchives);
 
-            for (uint32_t i = 0; i < rawHeader->numArchives; i++) {
-                ArchiveEntry entry;
-                entry.arcOffsetScale = rawArcs[i].arcOffsetScale;
-                entry.loadType = rawArcs[i].loadType;
+                for (uint32_t i = 0; i < rawHeader->numArchives; i++) {
+                    ArchiveEntry entry;
+                    entry.arcOffsetScale = rawArcs[i].arcOffsetScale;
+                    entry.loadType = rawArcs[i].loadType;
 
-                entry.filename = reader.readStringRelative(rawArcs[i].offsetToFilename);
+                    entry.filename = reader.readStringRelative(rawArcs[i].offsetToFilename);
 
-                asset.archiveEntries.push_back(std::move(entry));
+                    asset.archiveEntries.push_back(std::move(entry));
+                }
             }
-        }
 
-        if (rawHeader->fileEntryCount > 0) {
-            const char* fileTable = reader.getOffsetPtr(rawHeader->offsetToFileTable);
+            if (rawHeader->fileEntryCount > 0) {
+                const char* fileTable = reader.getOffsetPtr(rawHeader->offsetToFileTable);
 
-            const std::byte* start = reinterpret_cast<const std::byte*>(fileTable);
-            const std::byte* end = payload.data() + payload.size();
-            if (start + (rawHeader->fileEntryCount * sizeof(RawFileEntry)) > end) {
-				throw ReaderException("File table exceeds buffer size");
-            }
+                const std::byte* start = reinterpret_cast<const std::byte*>(fileTable);
+                const std::byte* end = payload.data() + payload.size();
+                if (start + (rawHeader->fileEntryCount * sizeof(RawFileEntry)) > end) {
+                    throw ReaderException("File table exceeds buffer size");
+                }
 
-            const RawFileEntry* rawFiles = reinterpret_cast<const RawFileEntry*>(fileTable);
-            asset.fileEntries.reserve(rawHeader->fileEntryCount);
+                const RawFileEntry* rawFiles = reinterpret_cast<const RawFileEntry*>(fileTable);
+                asset.fileEntries.reserve(rawHeader->fileEntryCount);
 
-            for (uint32_t i = 0; i < rawHeader->fileEntryCount; i++) {
-                FileEntry entry;
+                for (uint32_t i = 0; i < rawHeader->fileEntryCount; i++) {
+                    FileEntry entry;
 
-                entry.size = rawFiles[i].compressedSize;
-                entry.packFileSerializedSize = rawFiles[i].packFileSerializedSize;
-                entry.packFileResourceSize = rawFiles[i].packFileResourceSize;
-                entry.archiveIndex = rawFiles[i].archiveIndex;
-                entry.flags = rawFiles[i].flags;
+                    entry.size = rawFiles[i].compressedSize;
+                    entry.packFileSerializedSize = rawFiles[i].packFileSerializedSize;
+                    entry.packFileResourceSize = rawFiles[i].packFileResourceSize;
+                    entry.archiveIndex = rawFiles[i].archiveIndex;
+                    entry.flags = rawFiles[i].flags;
 
-                entry.name = reader.readStringRelative(rawFiles[i].nameOffset);
+                    entry.name = reader.readStringRelative(rawFiles[i].nameOffset);
 
-                uint32_t scale = 0;
-                if (entry.archiveIndex < asset.archiveEntries.size()) {
-                    scale = asset.archiveEntries[entry.archiveIndex].arcOffsetScale;
-                }
-                entry.rawOffset = static_cast<uint64_t>(rawFiles[i].scaledOffset) << scale;
+                    uint32_t scale = 0;
+                    if (entry.archiveIndex < asset.archiveEntries.size()) {
+                        scale = asset.archiveEntries[entry.archiveIndex].arcOffsetScale;
+                    }
+                    entry.rawOffset = static_cast<uint64_t>(rawFiles[i].scaledOffset) << scale;
 
-                asset.fileEntries.push_back(std::move(entry));
+                    asset.fileEntries.push_back(std::move(entry));
+                }
             }
-        }
 
-        return asset;
+            return asset;
+        }
     }
 
     std::expected<TpArchiveFileParam, Error> TpArchiveFileParam::Deserialize(std::span<const std::byte> payload) {
@@ -211,16 +210,26 @@ namespace replicant {
     }
 
     FileEntry* TpArchiveFileParam::findFile(const std::string& name) {
-        for (auto& entry : fileEntries) {
-            if (entry.name == name) return &entry;
-        }
-        return nullptr;
+        index_.sync(fileEntries, [](const FileEntry& e) { return fnv1_32(e.name); });
+        size_t pos = index_.find(fileEntries, fnv1_32(name), [&](const FileEntry& e) { return e.name == name; });
+        return pos < fileEntries.size() ? &fileEntries[pos] : nullptr;
+    }
+
+    FileEntry* TpArchiveFileParam::findByHash(uint32_t pathHash) {
+        index_.sync(fileEntries, [](const FileEntry& e) { return fnv1_32(e.name); });
+        size_t pos = index_.find(fileEntries, pathHash, [&](const FileEntry& e) { return fnv1_32(e.name) == pathHash; });
+        return pos < fileEntries.size() ? &fileEntries[pos] : nullptr;
     }
 
     void TpArchiveFileParam::registerArchive(
         uint8_t archiveIndex,
         const std::vector<archive::ArchiveEntryInfo>& builtEntries
     ) {
+        if (!index_.enabled()) {
+            index_.reset();
+        }
+        fileEntries.reserve(fileEntries.size() + builtEntries.size());
+
         for (const auto& built : builtEntries) {
             FileEntry* existing = findFile(built.name);
 
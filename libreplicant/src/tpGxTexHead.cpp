@@ -61,8 +61,14 @@ namespace replicant {
 
     }
 
+    size_t SerializedTexHeadSize(const TextureHeader& header) {
+        // The mip table follows the fixed header, 16 byte aligned
+        size_t fixedSize = (sizeof(RawTexHeader) + 15) & ~size_t(15);
+        return fixedSize + header.mips.size() * sizeof(RawMipSurface);
+    }
+
     std::vector<std::byte> SerializeTexHeadInternal(const TextureHeader& header) {
-        Writer writer;
+        Writer writer(SerializedTexHeadSize(header));
 
         writer.write(header.width);
         writer.write(header.height);
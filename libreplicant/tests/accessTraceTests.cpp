@@ -0,0 +1,119 @@
+#include "testing.h"
+#include "replicant/accessTrace.h"
+#include "replicant/pack.h"
+
+using namespace replicant;
+using namespace replicant::archive;
+using replicant::test::TempDir;
+using replicant::test::WriteFixture;
+
+namespace {
+
+    void WritePack(const std::filesystem::path& path, std::initializer_list<std::string> entries) {
+        Pack pack;
+        pack.info.version = 1;
+        for (const auto& name : entries) {
+            PackFileEntry file;
+            file.name = name;
+            file.nameHash = fnv1_32(name);
+            file.serializedData = test::Bytes("serialized");
+            pack.files.push_back(std::move(file));
+        }
+        auto data = pack.Serialize();
+        REQUIRE(data.has_value());
+        WriteFixture(path, *data);
+    }
+
+    // An extracted data folder, as archives are built from: textures live in packs, next to files that are not packs
+    struct DataFixture {
+        TempDir dir;
+        std::filesystem::path root = dir / "data";
+        AssetIndex index;
+
+        DataFixture() {
+            WritePack(root / "ui/title.xap", { "logo.rtex", "title_bg.rtex" });
+            WritePack(root / "field/field_a.xap", { "grass.rtex", "shared.rtex" });
+            WritePack(root / "common/common.xap", { "font.rtex", "shared.rtex" });
+            WriteFixture(root / "sound/bgm.bin", "not a pack");
+            REQUIRE(index.Update(root).has_value());
+        }
+
+        std::vector<ArchiveInput> inputs(std::initializer_list<std::string> names) const {
+            std::vector<ArchiveInput> result;
+            for (const auto& name : names) result.push_back({ name, root / name });
+            return result;
+        }
+    };
+
+    // Events as the loader records them: archives by the path the game opens, textures and tables by entry name
+    std::vector<std::byte> RecordedTrace() {
+        std::vector<std::byte> data = TraceEncoder::Header();
+        TraceEncoder encoder;
+        encoder.encode(data, TraceEvent::Archive, 10, "boot", "data/info.arc");
+        encoder.encode(data, TraceEvent::Texture, 20, "boot", "font.rtex");
+        encoder.encode(data, TraceEvent::Texture, 30, "boot", "logo.rtex");
+        encoder.encode(data, TraceEvent::Texture, 40, "boot", "title_bg.rtex");
+        encoder.encode(data, TraceEvent::Archive, 50, "field", "data/stream/field.arc");
+        encoder.encode(data, TraceEvent::Texture, 60, "field", "grass.rtex");
+        encoder.encode(data, TraceEvent::Texture, 70, "field", "shared.rtex");
+        encoder.encode(data, TraceEvent::Texture, 80, "field", "font.rtex");
+        encoder.encode(data, TraceEvent::Table, 90, "field", "unknown.stbl");
+        return data;
+    }
+
+    std::vector<std::string> NamesOf(const std::vector<ArchiveInput>& inputs) {
+        std::vector<std::string> names;
+        for (const auto& input : inputs) names.push_back(input.name);
+        return names;
+    }
+}
+
+TEST(RecordedTraceNamesNoArchiveInputs) {
+    DataFixture data;
+    auto trace = AccessTrace::Deserialize(RecordedTrace());
+    REQUIRE(trace.has_value());
+
+    auto inputs = data.inputs({ "sound/bgm.bin", "field/field_a.xap", "ui/title.xap", "common/common.xap" });
+    LayoutStats stats = OrderByTrace(inputs, *trace);
+    CHECK(stats.traced == 0);
+    CHECK(stats.untraced == 4);
+}
+
+TEST(MapToPacksNamesTheContainingPacks) {
+    DataFixture data;
+    auto trace = AccessTrace::Deserialize(RecordedTrace());
+    REQUIRE(trace.has_value());
+
+    PackMapStats stats = MapToPacks(*trace, std::span(&data.index, 1));
+    CHECK(stats.mapped == 6);
+    CHECK(stats.kept == 1);
+    CHECK(stats.dropped == 2);
+
+    // shared.rtex is in two packs and maps to both, repeats of a pack right after each other collapse
+    std::vector<std::string> names;
+    for (const auto& access : trace->accesses) names.push_back(access.name);
+    std::vector<std::string> expected = {
+        "common/common.xap", "ui/title.xap",
+        "field/field_a.xap", "common/common.xap", "field/field_a.xap", "common/common.xap", "unknown.stbl",
+    };
+    CHECK(names == expected);
+    CHECK(trace->accesses[2].phase == 1);
+    CHECK(trace->accesses[2].time == 60);
+}
+
+TEST(OrderByTraceLaysOutRecordedTrace) {
+    DataFixture data;
+    auto trace = AccessTrace::Deserialize(RecordedTrace());
+    REQUIRE(trace.has_value());
+    MapToPacks(*trace, std::span(&data.index, 1));
+
+    auto inputs = data.inputs({ "sound/bgm.bin", "field/field_a.xap", "ui/title.xap", "common/common.xap" });
+    LayoutStats stats = OrderByTrace(inputs, *trace);
+    CHECK(stats.traced == 3);
+    CHECK(stats.shared == 1);
+    CHECK(stats.untraced == 1);
+
+    // Boot first, led by common.xap which the field phase loads again, then the field phase, then untraced inputs
+    std::vector<std::string> expected = { "common/common.xap", "ui/title.xap", "field/field_a.xap", "sound/bgm.bin" };
+    CHECK(NamesOf(inputs) == expected);
+}
@@ -0,0 +1,196 @@
+#include "testing.h"
+#include "replicant/arc.h"
+#include "replicant/tpArchiveFileParam.h"
+#include "replicant/core/io.h"
+
+#include <cstring>
+#include <random>
+
+using namespace replicant;
+using replicant::test::TempDir;
+using replicant::test::WriteFixture;
+using replicant::test::ReadFixture;
+
+namespace {
+
+    // Large enough for the builder to stream it (32 MiB and up) rather than compress it into memory
+    constexpr size_t LARGE_INPUT_SIZE = 40ull * 1024 * 1024;
+
+    // Inputs only need a PACK header for the builder to read their sizes from. The rest alternates between random
+    // and repetitive runs, so frames are neither trivial nor incompressible
+    std::vector<std::byte> PackFixture(size_t size, uint32_t seed) {
+        std::vector<std::byte> data(size);
+        std::mt19937 random(seed);
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = (i / 4096) % 3 == 0 ? std::byte(random()) : std::byte("fixture"[i % 7]);
+        }
+        std::memcpy(data.data(), "PACK", 4);
+        std::memset(data.data() + 4, 0, 60);
+        return data;
+    }
+
+    const FileEntry& EntryOf(const TpArchiveFileParam& index, std::string_view name) {
+        for (const auto& entry : index.fileEntries) {
+            if (entry.name == name) return entry;
+        }
+        throw std::runtime_error("no index entry for " + std::string(name));
+    }
+
+    std::span<const std::byte> FrameOf(std::span<const std::byte> archiveData, const archive::ArchiveEntryInfo& entry) {
+        return archiveData.subspan(static_cast<size_t>(entry.offset), entry.compressedSize);
+    }
+
+    struct ArchiveFixture {
+        TempDir dir;
+        std::vector<archive::ArchiveInput> inputs;
+        std::vector<std::vector<std::byte>> contents;
+
+        ArchiveFixture() {
+            add("small_a.xap", PackFixture(100 * 1024, 1));
+            add("large.xap", PackFixture(LARGE_INPUT_SIZE, 2));
+            add("small_b.xap", PackFixture(3000, 3));
+        }
+
+        void add(std::string name, std::vector<std::byte> content) {
+            WriteFixture(dir / "in" / name, content);
+            inputs.push_back({ name, dir / "in" / name });
+            contents.push_back(std::move(content));
+        }
+    };
+}
+
+TEST(LargeInputFramesMatchCompress) {
+    ArchiveFixture fixture;
+    archive::CompressionConfig config;
+    config.jobs = 4;
+
+    archive::BuildOptions options;
+    options.maxMemory = 1;
+
+    auto built = archive::Build(fixture.dir / "parallel.arc", fixture.inputs, archive::BuildMode::SeparateFrames, config, options);
+    REQUIRE(built.has_value());
+    REQUIRE(built->entries.size() == fixture.inputs.size());
+
+    auto archiveData = ReadFixture(fixture.dir / "parallel.arc");
+
+    // Streamed or not, every frame is what the single-threaded Compress produces at the same settings
+    for (size_t i = 0; i < fixture.inputs.size(); ++i) {
+        auto expected = archive::Compress(fixture.contents[i], config);
+        REQUIRE(expected.has_value());
+        auto frame = FrameOf(archiveData, built->entries[i]);
+        CHECK(frame.size() == expected->size());
+        CHECK(std::equal(frame.begin(), frame.end(), expected->begin(), expected->end()));
+        CHECK(built->entries[i].offset % 16 == 0);
+    }
+
+    config.jobs = 1;
+    auto single = archive::Build(fixture.dir / "single.arc", fixture.inputs, archive::BuildMode::SeparateFrames, config);
+    REQUIRE(single.has_value());
+    CHECK(ReadFixture(fixture.dir / "single.arc") == archiveData);
+}
+
+TEST(IncrementalBuildReusesLargeFrames) {
+    ArchiveFixture fixture;
+    archive::CompressionConfig config;
+    config.jobs = 4;
+
+    archive::BuildOptions options;
+    options.cachePath = fixture.dir / "out.arc.cache";
+    options.maxMemory = 1;
+
+    auto first = archive::Build(fixture.dir / "out.arc", fixture.inputs, archive::BuildMode::SeparateFrames, config, options);
+    REQUIRE(first.has_value());
+    CHECK(first->reusedFrames == 0);
+    auto firstData = ReadFixture(fixture.dir / "out.arc");
+
+    auto second = archive::Build(fixture.dir / "out.arc", fixture.inputs, archive::BuildMode::SeparateFrames, config, options);
+    REQUIRE(second.has_value());
+    CHECK(second->reusedFrames == fixture.inputs.size());
+    CHECK(ReadFixture(fixture.dir / "out.arc") == firstData);
+
+    // A changed small input is recompressed, the large frame still comes from the previous archive
+    fixture.contents[2] = PackFixture(5000, 4);
+    WriteFixture(fixture.inputs[2].fullPath, fixture.contents[2]);
+
+    auto third = archive::Build(fixture.dir / "out.arc", fixture.inputs, archive::BuildMode::SeparateFrames, config, options);
+    REQUIRE(third.has_value());
+    CHECK(third->reusedFrames == 2);
+
+    auto thirdData = ReadFixture(fixture.dir / "out.arc");
+    auto expected = archive::Compress(fixture.contents[1], config);
+    REQUIRE(expected.has_value());
+    auto frame = FrameOf(thirdData, third->entries[1]);
+    CHECK(std::equal(frame.begin(), frame.end(), expected->begin(), expected->end()));
+}
+
+TEST(CompactReplacesNothingUntilCommitted) {
+    ArchiveFixture fixture;
+    archive::CompressionConfig config;
+    std::filesystem::path archivePath = fixture.dir / "out.arc";
+    std::filesystem::path cachePath = fixture.dir / "out.arc.cache";
+
+    archive::BuildOptions options;
+    options.cachePath = cachePath;
+    auto built = archive::Build(archivePath, fixture.inputs, archive::BuildMode::SeparateFrames, config, options);
+    REQUIRE(built.has_value());
+
+    TpArchiveFileParam index;
+    uint8_t archiveIndex = index.addArchiveEntry("out.arc", ArchiveLoadType::STREAM);
+    index.registerArchive(archiveIndex, built->entries);
+
+    // The replaced frame of small_a is left behind as dead space
+    fixture.contents[0] = PackFixture(90 * 1024, 5);
+    WriteFixture(fixture.inputs[0].fullPath, fixture.contents[0]);
+
+    archive::AppendOptions appendOptions;
+    appendOptions.cachePath = cachePath;
+    auto appended = archive::Append(archivePath, fixture.inputs, config, appendOptions);
+    REQUIRE(appended.has_value());
+    CHECK(appended->reusedFrames == 2);
+    index.registerArchive(archiveIndex, appended->entries);
+
+    auto appendedData = ReadFixture(archivePath);
+    auto appendedCache = ReadFixture(cachePath);
+    TpArchiveFileParam appendedIndex = index;
+
+    auto compacted = archive::Compact(archivePath, index, archiveIndex, cachePath);
+    REQUIRE(compacted.has_value());
+    CHECK(compacted->frames == 3);
+    CHECK(compacted->reclaimedBytes > 0);
+    CHECK(compacted->cacheRemapped);
+
+    // Only the index in memory moved, what is on disk still matches the index as it was
+    CHECK(ReadFixture(archivePath) == appendedData);
+    CHECK(ReadFixture(cachePath) == appendedCache);
+    CHECK(std::filesystem::exists(compacted->compactedPath));
+
+    // Backing out leaves nothing behind
+    archive::DiscardCompact(*compacted);
+    CHECK(!std::filesystem::exists(compacted->compactedPath));
+    CHECK(!std::filesystem::exists(fixture.dir / "out.arc.cache.tmp"));
+    CHECK(ReadFixture(archivePath) == appendedData);
+
+    index = appendedIndex;
+    compacted = archive::Compact(archivePath, index, archiveIndex, cachePath);
+    REQUIRE(compacted.has_value());
+    REQUIRE(archive::CommitCompact(*compacted).has_value());
+    CHECK(!compacted->cacheDropped);
+    CHECK(!std::filesystem::exists(compacted->compactedPath));
+    CHECK(std::filesystem::file_size(archivePath) == appendedData.size() - compacted->reclaimedBytes);
+
+    auto compactedData = ReadFixture(archivePath);
+    for (size_t i = 0; i < fixture.inputs.size(); ++i) {
+        const FileEntry& entry = EntryOf(index, fixture.inputs[i].name);
+        auto expected = archive::Compress(fixture.contents[i], config);
+        REQUIRE(expected.has_value());
+        REQUIRE(entry.rawOffset + expected->size() <= compactedData.size());
+        auto frame = std::span<const std::byte>(compactedData).subspan(static_cast<size_t>(entry.rawOffset), expected->size());
+        CHECK(std::equal(frame.begin(), frame.end(), expected->begin(), expected->end()));
+    }
+
+    // The remapped cache describes the compacted archive, so nothing needs compressing again
+    auto rebuilt = archive::Append(archivePath, fixture.inputs, config, appendOptions);
+    REQUIRE(rebuilt.has_value());
+    CHECK(rebuilt->reusedFrames == fixture.inputs.size());
+    CHECK(std::filesystem::file_size(archivePath) == compactedData.size());
+}
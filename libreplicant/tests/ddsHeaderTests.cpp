@@ -0,0 +1,25 @@
+#include "testing.h"
+#include "replicant/dds.h"
+
+using namespace replicant;
+
+using replicant::test::DX10DDSFixture;
+
+TEST(ProbeHeaderReadsDX10CubeArrays) {
+    auto data = DX10DDSFixture(2, true, 12);
+    auto info = dds::ProbeHeader(data);
+    REQUIRE(info.has_value());
+    CHECK(info->arraySize == 12);
+    CHECK(info->dimension == TextureDimension::CubeMap);
+    CHECK(info->dataOffset == 148);
+    CHECK(info->dataSize == 12 * 4 * 4 * 4);
+}
+
+TEST(ProbeHeaderRejectsCubeArraySizeThatWraps) {
+    // 0x2AAAAAAB cubes are 0x100000002 faces, 2 once truncated to 32 bits
+    auto data = DX10DDSFixture(0x2AAAAAAB, true, 2);
+    CHECK(!dds::ProbeHeader(data).has_value());
+
+    auto oversized = DX10DDSFixture(2049, false, 0);
+    CHECK(!dds::ProbeHeader(oversized, uint64_t{ 1 } << 40).has_value());
+}
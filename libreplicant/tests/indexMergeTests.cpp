@@ -0,0 +1,365 @@
+#include "testing.h"
+#include "replicant/indexMerge.h"
+#include "replicant/tpArchiveFileParam.h"
+#include "replicant/arc.h"
+#include "replicant/bxon.h"
+#include "replicant/core/io.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <map>
+
+using namespace replicant;
+using replicant::test::TempDir;
+using replicant::test::WriteFixture;
+using replicant::test::ReadFixture;
+
+namespace {
+
+    // A mod's archive: frames written 16-byte aligned, as SeparateFrames builds lay them out
+    struct FixtureArchive {
+        std::vector<std::byte> data;
+
+        uint64_t add(std::string_view frame) {
+            uint64_t offset = data.size();
+            auto bytes = test::Bytes(frame);
+            data.insert(data.end(), bytes.begin(), bytes.end());
+            data.resize((data.size() + 15) & ~size_t{ 15 });
+            return offset;
+        }
+    };
+
+    FileEntry Entry(std::string name, uint64_t rawOffset, uint32_t size) {
+        FileEntry entry;
+        entry.name = std::move(name);
+        entry.rawOffset = rawOffset;
+        entry.size = size;
+        return entry;
+    }
+
+    TpArchiveFileParam Index(std::string archiveName, ArchiveLoadType loadType, std::vector<FileEntry> entries) {
+        TpArchiveFileParam param;
+        param.archiveEntries.push_back({ std::move(archiveName), 4, loadType });
+        param.fileEntries = std::move(entries);
+        return param;
+    }
+
+    // The stored form of an info.arc: a tpArchiveFileParam BXON, zstd compressed
+    std::vector<std::byte> CompressIndex(const TpArchiveFileParam& param) {
+        auto payload = param.Serialize();
+        REQUIRE(payload.has_value());
+        auto bxon = BuildBxon("tpArchiveFileParam", 0x20090422, 0x54455354, *payload);
+        REQUIRE(bxon.has_value());
+        auto compressed = archive::Compress(*bxon);
+        REQUIRE(compressed.has_value());
+        return std::move(*compressed);
+    }
+
+    TpArchiveFileParam DecompressIndex(std::span<const std::byte> compressed) {
+        auto size = archive::GetDecompressedSize(compressed);
+        REQUIRE(size.has_value());
+        auto decompressed = archive::Decompress(compressed, *size);
+        REQUIRE(decompressed.has_value());
+        auto bxon = ParseBxon(*decompressed);
+        REQUIRE(bxon.has_value());
+        REQUIRE(bxon->first.assetType == "tpArchiveFileParam");
+        auto param = TpArchiveFileParam::Deserialize(bxon->second);
+        REQUIRE(param.has_value());
+        return std::move(*param);
+    }
+
+    const FileEntry* FindEntry(const TpArchiveFileParam& param, std::string_view name) {
+        auto it = std::find_if(param.fileEntries.begin(), param.fileEntries.end(), [&](const FileEntry& e) { return e.name == name; });
+        return it != param.fileEntries.end() ? &*it : nullptr;
+    }
+
+    bool SortedByHash(const TpArchiveFileParam& param) {
+        return std::is_sorted(param.fileEntries.begin(), param.fileEntries.end(), [](const FileEntry& a, const FileEntry& b) {
+            return fnv1_32(a.name) < fnv1_32(b.name);
+        });
+    }
+
+    // data/info.arc with two base entries, and two STREAM mods next to data/:
+    //   mods/a: "shared" (overrides the base), "a/only", "both", and "a/dup1"/"a/dup2" sharing one frame
+    //   mods/b: "both" (overrides mod a)
+    struct MergeFixture {
+        TempDir dir;
+        std::filesystem::path dataRoot = dir / "data";
+        std::vector<std::byte> baseIndex;
+        std::vector<ModIndexSource> mods;
+        std::map<std::string, std::string> modContent;     // Name -> frame bytes of the winning mod entry
+
+        MergeFixture() {
+            baseIndex = CompressIndex(Index("data000.arc", ArchiveLoadType::STREAM, {
+                Entry("base/keep", 0, 10),
+                Entry("shared", 16, 10),
+            }));
+            WriteFixture(dataRoot / "info.arc", baseIndex);
+
+            FixtureArchive a;
+            uint64_t shared = a.add("a:shared");
+            uint64_t only = a.add("a:only");
+            uint64_t both = a.add("a:both, shadowed by b");
+            uint64_t dup = a.add("a:dup");
+            WriteFixture(dir / "mods/a/a.arc", a.data);
+            WriteFixture(dir / "mods/a/info.arc", CompressIndex(Index("a.arc", ArchiveLoadType::STREAM, {
+                Entry("shared", shared, 8),
+                Entry("a/only", only, 6),
+                Entry("both", both, 21),
+                Entry("a/dup1", dup, 5),
+                Entry("a/dup2", dup, 5),
+            })));
+
+            FixtureArchive b;
+            uint64_t bBoth = b.add("b:both");
+            WriteFixture(dir / "mods/b/b.arc", b.data);
+            WriteFixture(dir / "mods/b/info.arc", CompressIndex(Index("b.arc", ArchiveLoadType::STREAM, {
+                Entry("both", bBoth, 6),
+            })));
+
+            mods = { { "a", dir / "mods/a/info.arc" }, { "b", dir / "mods/b/info.arc" } };
+            modContent = {
+                { "shared", "a:shared" }, { "a/only", "a:only" }, { "a/dup1", "a:dup" }, { "a/dup2", "a:dup" }, { "both", "b:both" },
+            };
+        }
+    };
+}
+
+TEST(MergeModIndicesAppliesModsInOrder) {
+    MergeFixture fixture;
+    auto mods = fixture.mods;
+    mods.push_back({ "missing-index", fixture.dir / "mods/missing/info.arc" });
+
+    WriteFixture(fixture.dir / "mods/no-archive/info.arc", CompressIndex(Index("gone.arc", ArchiveLoadType::STREAM, { Entry("x", 0, 1) })));
+    mods.push_back({ "missing-archive", fixture.dir / "mods/no-archive/info.arc" });
+
+    auto merged = MergeModIndices(fixture.baseIndex, mods, fixture.dataRoot);
+    REQUIRE(merged.has_value());
+    REQUIRE(merged->mods.size() == 4);
+    CHECK(merged->anyApplied());
+    CHECK(!merged->consolidation);
+
+    CHECK(merged->mods[0].id == "a");
+    CHECK(merged->mods[0].applied);
+    CHECK(merged->mods[0].stats.overwritten == 1);
+    CHECK(merged->mods[0].stats.added == 4);
+    CHECK(merged->mods[1].applied);
+    CHECK(merged->mods[1].stats.overwritten == 1);
+    CHECK(merged->mods[1].stats.added == 0);
+    CHECK(!merged->mods[2].applied && !merged->mods[2].error.empty());
+    CHECK(!merged->mods[3].applied && !merged->mods[3].error.empty());
+
+    TpArchiveFileParam param = DecompressIndex(merged->compressedIndex);
+    CHECK(SortedByHash(param));
+    REQUIRE(param.archiveEntries.size() == 3);
+    CHECK(param.archiveEntries[0].filename == "data000.arc");
+    CHECK(param.archiveEntries[1].filename == "../mods/a/a.arc");
+    CHECK(param.archiveEntries[2].filename == "../mods/b/b.arc");
+    CHECK(param.fileEntries.size() == 6);
+
+    const FileEntry* keep = FindEntry(param, "base/keep");
+    REQUIRE(keep);
+    CHECK(keep->archiveIndex == 0 && keep->rawOffset == 0 && keep->size == 10);
+
+    const FileEntry* shared = FindEntry(param, "shared");
+    REQUIRE(shared);
+    CHECK(shared->archiveIndex == 1 && shared->rawOffset == 0 && shared->size == 8);
+
+    const FileEntry* both = FindEntry(param, "both");
+    REQUIRE(both);
+    CHECK(both->archiveIndex == 2 && both->rawOffset == 0 && both->size == 6);
+}
+
+TEST(MergeModIndicesWithoutUsableModsProducesNoIndex) {
+    MergeFixture fixture;
+    std::vector<ModIndexSource> mods = { { "missing", fixture.dir / "mods/missing/info.arc" } };
+
+    auto merged = MergeModIndices(fixture.baseIndex, mods, fixture.dataRoot);
+    REQUIRE(merged.has_value());
+    CHECK(!merged->anyApplied());
+    CHECK(merged->compressedIndex.empty());
+
+    auto broken = MergeModIndices(test::Bytes("not an index"), fixture.mods, fixture.dataRoot);
+    CHECK(!broken.has_value());
+}
+
+TEST(PatchFingerprintRoundTrip) {
+    MergeFixture fixture;
+    auto output = fixture.dir / "LunarTear/LunarTear.arc";
+    WriteFixture(output, "patched");
+
+    auto fingerprint = PatchFingerprint::Compute(fixture.dataRoot / "info.arc", fixture.baseIndex, fixture.mods);
+    fingerprint.consolidated = true;
+    fingerprint.addDependency(fixture.dir / "mods/a/a.arc");
+    fingerprint.addOutput(output);
+
+    CHECK(fingerprint.baseSize == fixture.baseIndex.size());
+    CHECK(fingerprint.baseHash == hash64(fixture.baseIndex));
+    REQUIRE(fingerprint.mods.size() == 2);
+    CHECK(fingerprint.mods[0].id == "a");
+    CHECK(fingerprint.mods[1].id == "b");
+
+    auto serialized = fingerprint.Serialize();
+    REQUIRE(serialized.has_value());
+    auto loaded = PatchFingerprint::Deserialize(*serialized);
+    REQUIRE(loaded.has_value());
+    CHECK(*loaded == fingerprint);
+    CHECK(!PatchFingerprint::Deserialize(test::Bytes("LTPF but truncated")).has_value());
+
+    auto current = [&] {
+        auto fresh = PatchFingerprint::Compute(fixture.dataRoot / "info.arc", fixture.baseIndex, fixture.mods);
+        fresh.consolidated = true;
+        return fresh;
+    };
+    CHECK(loaded->isUpToDate(current()));
+
+    auto notConsolidated = current();
+    notConsolidated.consolidated = false;
+    CHECK(!loaded->isUpToDate(notConsolidated));
+
+    auto reordered = fixture.mods;
+    std::swap(reordered[0], reordered[1]);
+    auto reorderedFingerprint = PatchFingerprint::Compute(fixture.dataRoot / "info.arc", fixture.baseIndex, reordered);
+    reorderedFingerprint.consolidated = true;
+    CHECK(!loaded->isUpToDate(reorderedFingerprint));
+
+    // Nothing recorded as written: never trusted
+    auto withoutOutputs = fingerprint;
+    withoutOutputs.outputs.clear();
+    CHECK(!withoutOutputs.isUpToDate(current()));
+
+    WriteFixture(output, "patched, but rewritten");
+    CHECK(!loaded->isUpToDate(current()));
+    WriteFixture(output, "patched");
+
+    WriteFixture(fixture.dir / "mods/a/a.arc", "a changed dependency");
+    CHECK(!loaded->isUpToDate(current()));
+
+    WriteFixture(fixture.dir / "mods/b/info.arc", "a changed mod index");
+    CHECK(!fingerprint.isUpToDate(current()));
+}
+
+TEST(PatchFingerprintTracksModArchives) {
+    MergeFixture fixture;
+    auto output = fixture.dir / "LunarTear/LunarTear.arc";
+    WriteFixture(output, "patched");
+
+    // Mod b is skipped for now, its archive is not installed yet
+    std::filesystem::path bArchive = fixture.dir / "mods/b/b.arc";
+    auto bFrames = ReadFixture(bArchive);
+    std::filesystem::remove(bArchive);
+
+    // Recorded the way the loader records it after merging, without consolidation
+    auto record = [&] {
+        auto merged = MergeModIndices(fixture.baseIndex, fixture.mods, fixture.dataRoot);
+        REQUIRE(merged.has_value());
+        auto fingerprint = PatchFingerprint::Compute(fixture.dataRoot / "info.arc", fixture.baseIndex, fixture.mods);
+        for (const auto& mod : merged->mods) {
+            if (!mod.archivePath.empty()) fingerprint.addDependency(mod.archivePath);
+        }
+        fingerprint.addOutput(output);
+        return std::make_pair(std::move(*merged), fingerprint);
+    };
+    auto current = [&] { return PatchFingerprint::Compute(fixture.dataRoot / "info.arc", fixture.baseIndex, fixture.mods); };
+
+    auto [withoutB, fingerprint] = record();
+    CHECK(!withoutB.mods[1].applied);
+    CHECK(withoutB.mods[1].archivePath == bArchive);
+    REQUIRE(fingerprint.dependencies.size() == 2);
+    CHECK(fingerprint.isUpToDate(current()));
+
+    WriteFixture(bArchive, bFrames);
+    CHECK(!fingerprint.isUpToDate(current()));
+
+    auto [withB, rebuilt] = record();
+    CHECK(withB.mods[1].applied);
+    CHECK(rebuilt.isUpToDate(current()));
+
+    std::filesystem::remove(fixture.dir / "mods/a/a.arc");
+    CHECK(!rebuilt.isUpToDate(current()));
+
+    // Fingerprints from before mod archives were recorded are not trusted
+    auto serialized = rebuilt.Serialize();
+    REQUIRE(serialized.has_value());
+    uint32_t oldVersion = 2;
+    std::memcpy(serialized->data() + 4, &oldVersion, sizeof(oldVersion));
+    CHECK(!PatchFingerprint::Deserialize(*serialized).has_value());
+}
+
+TEST(ConsolidationRoundTrip) {
+    MergeFixture fixture;
+    auto outputDir = fixture.dir / "LunarTear";
+
+    // Two frames per archive at most, so the output has to be split
+    MergeOptions options;
+    options.consolidate = ConsolidateOptions{ outputDir };
+    options.consolidate->maxArchiveSize = 32;
+
+    auto merged = MergeModIndices(fixture.baseIndex, fixture.mods, fixture.dataRoot, options);
+    REQUIRE(merged.has_value());
+    REQUIRE(merged->consolidation.has_value());
+
+    const ConsolidateStats& stats = *merged->consolidation;
+    CHECK(stats.sources.size() == 2);
+    CHECK(stats.shadowedEntries == 1);
+    CHECK(stats.frames == 4);       // "a:dup" is shared by two entries, "a:both" is shadowed by mod b
+    CHECK(stats.bytes == 8 + 6 + 5 + 6);
+    REQUIRE(stats.archives.size() == 2);
+    CHECK(stats.archives[0] == outputDir / "LunarTearMods_000.arc");
+    CHECK(stats.archives[1] == outputDir / "LunarTearMods_001.arc");
+
+    TpArchiveFileParam param = DecompressIndex(merged->compressedIndex);
+    CHECK(SortedByHash(param));
+    REQUIRE(param.archiveEntries.size() == 3);
+    CHECK(param.archiveEntries[0].filename == "data000.arc");
+    CHECK(param.archiveEntries[1].filename == "../LunarTear/LunarTearMods_000.arc");
+    CHECK(param.archiveEntries[2].filename == "../LunarTear/LunarTearMods_001.arc");
+    CHECK(param.archiveEntries[1].loadType == ArchiveLoadType::STREAM);
+
+    const FileEntry* keep = FindEntry(param, "base/keep");
+    REQUIRE(keep);
+    CHECK(keep->archiveIndex == 0);
+
+    // Every mod entry reads back its own frame from the consolidated archives
+    for (const auto& [name, content] : fixture.modContent) {
+        const FileEntry* entry = FindEntry(param, name);
+        REQUIRE(entry);
+        REQUIRE(entry->archiveIndex >= 1);
+        CHECK(entry->rawOffset % 16 == 0);
+
+        auto archiveData = ReadFile(fixture.dataRoot / param.archiveEntries[entry->archiveIndex].filename);
+        REQUIRE(archiveData.has_value());
+        REQUIRE(entry->rawOffset + entry->size <= archiveData->size());
+        CHECK(std::string(reinterpret_cast<const char*>(archiveData->data() + entry->rawOffset), entry->size) == content);
+    }
+
+    const FileEntry* dup1 = FindEntry(param, "a/dup1");
+    const FileEntry* dup2 = FindEntry(param, "a/dup2");
+    REQUIRE(dup1 && dup2);
+    CHECK(dup1->archiveIndex == dup2->archiveIndex && dup1->rawOffset == dup2->rawOffset);
+
+    // A later run that needs fewer archives removes the ones it no longer writes
+    options.consolidate->maxArchiveSize = 1 << 20;
+    auto again = MergeModIndices(fixture.baseIndex, fixture.mods, fixture.dataRoot, options);
+    REQUIRE(again.has_value());
+    CHECK(again->consolidation->archives.size() == 1);
+    CHECK(std::filesystem::exists(outputDir / "LunarTearMods_000.arc"));
+    CHECK(!std::filesystem::exists(outputDir / "LunarTearMods_001.arc"));
+}
+
+TEST(RemoveConsolidatedArchivesKeepsTheFirstN) {
+    TempDir dir;
+    ConsolidateOptions options{ dir.path() };
+    for (int n = 0; n < 3; ++n) WriteFixture(dir / std::format("LunarTearMods_00{}.arc", n), "frames");
+    WriteFixture(dir / "LunarTear.arc", "index");
+
+    CHECK(RemoveConsolidatedArchives(options, 1) == 2);
+    CHECK(std::filesystem::exists(dir / "LunarTearMods_000.arc"));
+    CHECK(!std::filesystem::exists(dir / "LunarTearMods_001.arc"));
+
+    CHECK(RemoveConsolidatedArchives(options) == 1);
+    CHECK(!std::filesystem::exists(dir / "LunarTearMods_000.arc"));
+    CHECK(std::filesystem::exists(dir / "LunarTear.arc"));
+    CHECK(RemoveConsolidatedArchives(options) == 0);
+}
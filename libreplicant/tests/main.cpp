@@ -0,0 +1,35 @@
+#include "testing.h"
+#include <cstring>
+#include <exception>
+
+// Runs every registered test, or only those whose name contains argv[1]
+int main(int argc, char* argv[]) {
+    using namespace replicant::test;
+
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    size_t run = 0;
+    size_t failedCases = 0;
+
+    for (const auto& testCase : Registry()) {
+        if (filter && !std::strstr(testCase.name, filter)) continue;
+
+        size_t failuresBefore = FailureCount();
+        try {
+            testCase.run();
+        }
+        catch (const RequireFailure&) {
+        }
+        catch (const std::exception& ex) {
+            std::cerr << testCase.name << ": unexpected exception: " << ex.what() << "\n";
+            FailureCount()++;
+        }
+
+        run++;
+        bool passed = FailureCount() == failuresBefore;
+        if (!passed) failedCases++;
+        std::cout << (passed ? "[ PASS ] " : "[ FAIL ] ") << testCase.name << "\n";
+    }
+
+    std::cout << "\n" << run - failedCases << "/" << run << " tests passed.\n";
+    return failedCases == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#include "testing.h"
+#include "replicant/pack.h"
+
+using namespace replicant;
+
+namespace {
+
+    PackFileEntry File(std::string name, uint32_t nameHash) {
+        PackFileEntry file;
+        file.name = std::move(name);
+        file.nameHash = nameHash;
+        return file;
+    }
+}
+
+TEST(PackLookupsUseNamesAndStoredHashes) {
+    Pack pack;
+    pack.files.push_back(File("a.rtex", fnv1_32("a.rtex")));
+    pack.files.push_back(File("unset.rtex", 0));    // Stored hash left unset by some tool
+    pack.files.push_back(File("b.rtex", fnv1_32("b.rtex")));
+    pack.buildLookupIndex();
+
+    CHECK(pack.findFile("unset.rtex") == &pack.files[1]);
+    CHECK(pack.findByHash(fnv1_32("b.rtex")) == &pack.files[2]);
+    CHECK(pack.findByHash(0) == &pack.files[1]);
+    CHECK(pack.findByHash(fnv1_32("unset.rtex")) == nullptr);
+    CHECK(pack.findFile("missing.rtex") == nullptr);
+
+    // Appended entries are picked up by both indices on the next lookup
+    pack.files.push_back(File("c.rtex", fnv1_32("c.rtex")));
+    CHECK(pack.findByHash(fnv1_32("c.rtex")) == &pack.files[3]);
+    CHECK(pack.findFile("c.rtex") == &pack.files[3]);
+
+    // Reordering needs a rebuild, after which the hash index follows the entries again
+    std::swap(pack.files[0], pack.files[3]);
+    pack.buildLookupIndex();
+    CHECK(pack.findByHash(fnv1_32("a.rtex")) == &pack.files[3]);
+    CHECK(pack.findFile("c.rtex") == &pack.files[0]);
+
+    pack.dropLookupIndex();
+    CHECK(pack.findByHash(fnv1_32("c.rtex")) == &pack.files[0]);
+}
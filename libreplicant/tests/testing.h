@@ -0,0 +1,154 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Minimal test harness. TEST(name) registers a test case, CHECK records a failure and carries on, REQUIRE records
+// a failure and ends the current test case
+namespace replicant::test {
+
+    struct TestCase {
+        const char* name;
+        void (*run)();
+    };
+
+    inline std::vector<TestCase>& Registry() {
+        static std::vector<TestCase> registry;
+        return registry;
+    }
+
+    struct Registrar {
+        Registrar(const char* name, void (*run)()) { Registry().push_back({ name, run }); }
+    };
+
+    struct RequireFailure {};
+
+    inline size_t& FailureCount() {
+        static size_t count = 0;
+        return count;
+    }
+
+    inline void Fail(const char* expression, const char* file, int line) {
+        std::cerr << file << ":" << line << ": check failed: " << expression << "\n";
+        FailureCount()++;
+    }
+
+    // A fresh directory under the system temp folder for fixture files, removed with everything in it on destruction
+    class TempDir {
+    public:
+        TempDir() {
+            std::random_device random;
+            path_ = std::filesystem::temp_directory_path() / ("replicant_test_" + std::to_string(random()) + std::to_string(random()));
+            std::filesystem::create_directories(path_);
+        }
+
+        ~TempDir() {
+            std::error_code ec;
+            std::filesystem::remove_all(path_, ec);
+        }
+
+        TempDir(const TempDir&) = delete;
+        TempDir& operator=(const TempDir&) = delete;
+
+        const std::filesystem::path& path() const { return path_; }
+        std::filesystem::path operator/(const std::filesystem::path& relative) const { return path_ / relative; }
+
+    private:
+        std::filesystem::path path_;
+    };
+
+    inline std::vector<std::byte> Bytes(std::string_view text) {
+        auto data = std::as_bytes(std::span(text.data(), text.size()));
+        return { data.begin(), data.end() };
+    }
+
+    // Writes data to path, creating parent folders
+    inline void WriteFixture(const std::filesystem::path& path, std::span<const std::byte> data) {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    }
+
+    inline void WriteFixture(const std::filesystem::path& path, std::string_view text) {
+        WriteFixture(path, Bytes(text));
+    }
+
+    // DDS files of width x height R8G8B8A8 surfaces with one mip. The pixel data following the header is sized by
+    // surfaces rather than by what the header describes, so files too short for their header can be made
+    inline std::vector<std::byte> DDSFixture(uint32_t width, uint32_t height, size_t surfaces, uint8_t fill, bool dx10) {
+        size_t headerSize = dx10 ? 148 : 128;
+        std::vector<std::byte> data(headerSize + surfaces * width * height * 4, std::byte{ fill });
+        std::memset(data.data(), 0, headerSize);
+
+        auto put = [&](size_t offset, uint32_t value) { std::memcpy(data.data() + offset, &value, sizeof(value)); };
+        put(0, 0x20534444);     // "DDS "
+        put(4, 124);
+        put(12, height);
+        put(16, width);
+        put(76, 32);            // Pixel format size
+
+        if (dx10) {
+            put(80, 0x4);       // DDPF_FOURCC
+            std::memcpy(data.data() + 84, "DX10", 4);
+            put(128, 28);       // DXGI_FORMAT_R8G8B8A8_UNORM
+            put(132, 3);        // Texture2D
+            put(140, 1);        // Array size
+        }
+        else {
+            put(80, 0x41);      // DDPF_RGB | DDPF_ALPHAPIXELS
+            put(88, 32);
+            put(92, 0x000000ff);
+            put(96, 0x0000ff00);
+            put(100, 0x00ff0000);
+            put(104, 0xff000000);
+        }
+        return data;
+    }
+
+    // Legacy header, one surface of pixels
+    inline std::vector<std::byte> DDSFixture(uint32_t width, uint32_t height, uint8_t fill) {
+        return DDSFixture(width, height, 1, fill, false);
+    }
+
+    // 4x4 DX10 texture array, or array of cubes with cubeMap
+    inline std::vector<std::byte> DX10DDSFixture(uint32_t arraySize, bool cubeMap, size_t surfaces) {
+        auto data = DDSFixture(4, 4, surfaces, 0, true);
+        uint32_t miscFlag = cubeMap ? 0x4 : 0;    // DDS_RESOURCE_MISC_TEXTURECUBE
+        std::memcpy(data.data() + 136, &miscFlag, sizeof(miscFlag));
+        std::memcpy(data.data() + 140, &arraySize, sizeof(arraySize));
+        return data;
+    }
+
+    // Whole content of a file written by the code under test, empty if it cannot be read
+    inline std::vector<std::byte> ReadFixture(const std::filesystem::path& path) {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        auto bytes = std::as_bytes(std::span(data));
+        return { bytes.begin(), bytes.end() };
+    }
+}
+
+#define TEST(name) \
+    static void name(); \
+    static ::replicant::test::Registrar name##Registrar(#name, name); \
+    static void name()
+
+#define CHECK(expression) \
+    ((expression) ? void() : ::replicant::test::Fail(#expression, __FILE__, __LINE__))
+
+#define REQUIRE(expression) \
+    do { \
+        if (!(expression)) { \
+            ::replicant::test::Fail(#expression, __FILE__, __LINE__); \
+            throw ::replicant::test::RequireFailure{}; \
+        } \
+    } while (0)
@@ -0,0 +1,127 @@
+#include "testing.h"
+#include "replicant/textureCatalog.h"
+
+using namespace replicant;
+using namespace replicant::dds;
+using replicant::test::TempDir;
+using replicant::test::WriteFixture;
+using replicant::test::DDSFixture;
+
+namespace {
+
+    bool RejectedName(const TextureCatalog& catalog, std::string_view name) {
+        for (const auto& rejection : catalog.rejected()) {
+            if (rejection.name == name) return true;
+        }
+        return false;
+    }
+}
+
+TEST(TextureCatalogLaterSourcesOverrideEarlierOnes) {
+    TempDir dir;
+    // The overridden file is never probed, so it being broken does not get it rejected
+    WriteFixture(dir / "base" / "hero.dds", "not a texture");
+    WriteFixture(dir / "mod" / "hero.dds", DDSFixture(8, 4, 0x11));
+    WriteFixture(dir / "base" / "sky.dds", DDSFixture(4, 4, 0x22));
+    WriteFixture(dir / "base" / "broken.dds", "DDS but not really");
+
+    std::vector<TextureSource> sources = {
+        { "hero.dds", dir / "base" / "hero.dds" },
+        { "sky.dds", dir / "base" / "sky.dds" },
+        { "broken.dds", dir / "base" / "broken.dds" },
+        { "missing.dds", dir / "base" / "missing.dds" },
+        { "hero.dds", dir / "mod" / "hero.dds" },
+    };
+
+    TextureCatalog catalog = TextureCatalog::Build(sources, 2);
+    CHECK(catalog.size() == 2);
+    CHECK(!catalog.hasHashNames());
+
+    const CatalogTexture* hero = catalog.find("hero.dds");
+    REQUIRE(hero != nullptr);
+    CHECK(hero->path == dir / "mod" / "hero.dds");
+    CHECK(hero->header.width == 8);
+    CHECK(hero->header.format == TextureFormat::R8G8B8A8_UNORM);
+    CHECK(hero->header.dataSize == 8 * 4 * 4);
+
+    REQUIRE(catalog.find("sky.dds") != nullptr);
+    CHECK(catalog.find("broken.dds") == nullptr);
+    CHECK(catalog.find("missing.dds") == nullptr);
+
+    CHECK(catalog.rejected().size() == 2);
+    CHECK(RejectedName(catalog, "broken.dds"));
+    CHECK(RejectedName(catalog, "missing.dds"));
+}
+
+TEST(TextureCatalogNoticesHashNames) {
+    TempDir dir;
+    WriteFixture(dir / "0123ABCD.dds", DDSFixture(4, 4, 0));
+    WriteFixture(dir / "0123abce.dds", "not a texture");
+
+    // Only names that made it into the catalog count
+    std::vector<TextureSource> rejectedOnly = { { "0123abce.dds", dir / "0123abce.dds" } };
+    CHECK(!TextureCatalog::Build(rejectedOnly).hasHashNames());
+
+    std::vector<TextureSource> sources = { { "0123ABCD.dds", dir / "0123ABCD.dds" } };
+    CHECK(TextureCatalog::Build(sources).hasHashNames());
+    CHECK(TextureCatalog::IsHashName("0123abcd.DDS"));
+    CHECK(!TextureCatalog::IsHashName("0123abcd.png"));
+    CHECK(!TextureCatalog::IsHashName("0123abc.dds"));
+}
+
+TEST(TextureCatalogPixelsRevalidateChangedFiles) {
+    TempDir dir;
+    WriteFixture(dir / "kept.dds", DDSFixture(4, 4, 0x33));
+    WriteFixture(dir / "resized.dds", DDSFixture(4, 4, 0x44));
+    WriteFixture(dir / "repainted.dds", DDSFixture(4, 4, 0x55));
+
+    std::vector<TextureSource> sources = {
+        { "kept.dds", dir / "kept.dds" },
+        { "resized.dds", dir / "resized.dds" },
+        { "repainted.dds", dir / "repainted.dds" },
+    };
+    TextureCatalog catalog = TextureCatalog::Build(sources);
+    REQUIRE(catalog.size() == 3);
+
+    const CatalogTexture& kept = *catalog.find("kept.dds");
+    auto keptPixels = catalog.pixels(kept);
+    REQUIRE(keptPixels.has_value());
+    CHECK(keptPixels->size() == 4 * 4 * 4);
+    CHECK((*keptPixels)[0] == std::byte{ 0x33 });
+
+    // Once read, pixels stay as they were even if the file changes afterwards
+    WriteFixture(dir / "kept.dds", DDSFixture(8, 8, 0x66));
+    auto again = catalog.pixels(kept);
+    REQUIRE(again.has_value());
+    CHECK(again->data() == keptPixels->data());
+    CHECK((*again)[0] == std::byte{ 0x33 });
+
+    // Files swapped before their first read are checked against the header probed while building
+    WriteFixture(dir / "resized.dds", DDSFixture(8, 8, 0x44));
+    auto resized = catalog.pixels(*catalog.find("resized.dds"));
+    REQUIRE(!resized.has_value());
+    CHECK(resized.error().code == ErrorCode::ParseError);
+
+    // Same layout, different content, is still usable
+    WriteFixture(dir / "repainted.dds", DDSFixture(4, 4, 0x77));
+    auto repainted = catalog.pixels(*catalog.find("repainted.dds"));
+    REQUIRE(repainted.has_value());
+    CHECK((*repainted)[0] == std::byte{ 0x77 });
+
+    CatalogTexture foreign = kept;
+    CHECK(!catalog.pixels(foreign).has_value());
+}
+
+TEST(TextureCatalogPixelsFailForDeletedFiles) {
+    TempDir dir;
+    WriteFixture(dir / "gone.dds", DDSFixture(4, 4, 0));
+
+    std::vector<TextureSource> sources = { { "gone.dds", dir / "gone.dds" } };
+    TextureCatalog catalog = TextureCatalog::Build(sources);
+    REQUIRE(catalog.size() == 1);
+
+    std::filesystem::remove(dir / "gone.dds");
+    auto pixels = catalog.pixels(catalog.textures()[0]);
+    REQUIRE(!pixels.has_value());
+    CHECK(pixels.error().code == ErrorCode::IoError);
+}
@@ -0,0 +1,159 @@
+#include "testing.h"
+#include "replicant/textureHashIndex.h"
+#include "replicant/core/crc32c.h"
+#include "replicant/pack.h"
+#include "replicant/bxon.h"
+
+#include <random>
+
+using namespace replicant;
+using replicant::test::TempDir;
+using replicant::test::WriteFixture;
+
+namespace {
+
+    std::vector<std::byte> RandomBytes(size_t size, uint32_t seed) {
+        std::vector<std::byte> data(size);
+        std::mt19937 random(seed);
+        for (auto& b : data) b = std::byte(random());
+        return data;
+    }
+
+    // A 4x4 R8G8B8A8 rtex with two mips, as a pack file entry: the tpGxTexHead BXON and the pixels as resource.
+    // Only the first 64 bytes (LOD0) are hashed
+    PackFileEntry Texture(std::string name, std::vector<std::byte> pixels) {
+        TextureHeader header;
+        header.width = 4;
+        header.height = 4;
+        header.depth = 1;
+        header.mipCount = 2;
+        header.totalPixelSize = 80;
+        header.format = TextureFormat::R8G8B8A8_UNORM;
+        header.mips = { { 0, 16, 64, 4, 4, 1, 4 }, { 64, 8, 16, 2, 2, 1, 2 } };
+
+        auto texHead = SerializeTexHead(header);
+        REQUIRE(texHead.has_value());
+        auto bxon = BuildBxon("tpGxTexHead", 3, 0x2ea74106, *texHead);
+        REQUIRE(bxon.has_value());
+
+        PackFileEntry file;
+        file.name = std::move(name);
+        file.nameHash = fnv1_32(file.name);
+        file.serializedData = std::move(*bxon);
+        file.resourceData = std::move(pixels);
+        return file;
+    }
+
+    void WritePack(const std::filesystem::path& path, std::vector<PackFileEntry> files) {
+        Pack pack;
+        pack.info.version = 1;
+        pack.files = std::move(files);
+        auto data = pack.Serialize();
+        REQUIRE(data.has_value());
+        WriteFixture(path, *data);
+    }
+
+    std::vector<std::string> NamesOf(const std::vector<TextureHashMatch>& matches) {
+        std::vector<std::string> names;
+        for (const auto& match : matches) names.push_back(match.pack->path + ":" + match.texture->name);
+        return names;
+    }
+}
+
+TEST(Crc32cMatchesTheCheckValue) {
+    CHECK(crc32c(test::Bytes("123456789")) == 0xE3069283);
+    CHECK(crc32cSoftware(test::Bytes("123456789")) == 0xE3069283);
+    CHECK(crc32c({}) == 0);
+    CHECK(crc32c(std::vector<std::byte>(32, std::byte{ 0 })) == 0x8A9136AA);
+}
+
+TEST(Crc32cPathsAgreeOnUnalignedAndChainedInput) {
+    auto data = RandomBytes(1024 + 7, 11);
+    std::span<const std::byte> all(data);
+
+    // Every start alignment and every tail length the word loops leave behind
+    for (size_t offset = 0; offset < 8; ++offset) {
+        for (size_t size : { size_t{ 0 }, size_t{ 1 }, size_t{ 3 }, size_t{ 7 }, size_t{ 8 }, size_t{ 13 }, size_t{ 64 }, size_t{ 1000 } }) {
+            auto part = all.subspan(offset, size);
+            CHECK(crc32c(part) == crc32cSoftware(part));
+        }
+    }
+
+    // Continuing a crc over the rest gives the crc of the whole, on either path
+    uint32_t whole = crc32c(all);
+    for (size_t split : { size_t{ 0 }, size_t{ 1 }, size_t{ 5 }, size_t{ 8 }, size_t{ 517 }, all.size() }) {
+        CHECK(crc32c(all.subspan(split), crc32c(all.first(split))) == whole);
+        CHECK(crc32cSoftware(all.subspan(split), crc32cSoftware(all.first(split))) == whole);
+    }
+}
+
+TEST(TextureHashIndexFindsEveryTextureWithAHash) {
+    TempDir dir;
+    auto root = dir / "data";
+    auto shared = RandomBytes(80, 1);
+    auto other = RandomBytes(80, 2);
+
+    WritePack(root / "ui/title.xap", { Texture("logo.rtex", shared), Texture("bg.rtex", other) });
+    WritePack(root / "common/common.xap", { Texture("logo_copy.rtex", shared) });
+    WriteFixture(root / "sound/bgm.bin", "not a pack");
+
+    TextureHashIndex index;
+    auto stats = index.Update(root);
+    REQUIRE(stats.has_value());
+    CHECK(stats->scanned == 3);
+    CHECK(stats->textures == 3);
+
+    // Only LOD0 counts, the second mip differs but is not hashed
+    uint32_t sharedCrc = crc32c(std::span<const std::byte>(shared).first(64));
+    auto changedMip = shared;
+    changedMip[70] ^= std::byte{ 0xFF };
+    WritePack(root / "field/field.xap", { Texture("field_logo.rtex", changedMip) });
+    stats = index.Update(root);
+    REQUIRE(stats.has_value());
+    CHECK(stats->reused == 3);
+    CHECK(stats->scanned == 1);
+
+    std::vector<std::string> expected = { "common/common.xap:logo_copy.rtex", "field/field.xap:field_logo.rtex", "ui/title.xap:logo.rtex" };
+    CHECK(NamesOf(index.find(sharedCrc)) == expected);
+    CHECK(index.find(crc32c(std::span<const std::byte>(other).first(64))).size() == 1);
+    CHECK(index.find(sharedCrc ^ 1).empty());
+
+    auto serialized = index.Serialize();
+    REQUIRE(serialized.has_value());
+    auto loaded = TextureHashIndex::Deserialize(*serialized);
+    REQUIRE(loaded.has_value());
+    REQUIRE(loaded->packs.size() == index.packs.size());
+    for (size_t i = 0; i < index.packs.size(); ++i) {
+        CHECK(loaded->packs[i].path == index.packs[i].path);
+        CHECK(loaded->packs[i].mtime == index.packs[i].mtime);
+        CHECK(loaded->packs[i].textures.size() == index.packs[i].textures.size());
+    }
+    CHECK(NamesOf(loaded->find(sharedCrc)) == expected);
+    CHECK(!TextureHashIndex::Deserialize(test::Bytes("LTTH but truncated")).has_value());
+
+    // A loaded index updates like a fresh one
+    std::filesystem::remove(root / "common/common.xap");
+    stats = loaded->Update(root);
+    REQUIRE(stats.has_value());
+    CHECK(stats->removed == 1);
+    CHECK(stats->scanned == 0);
+    CHECK(loaded->find(sharedCrc).size() == 2);
+}
+
+TEST(TextureHashIndexParsesHashNames) {
+    CHECK(TextureHashIndex::ParseHashName("0123ABCD.dds") == 0x0123ABCDu);
+    CHECK(TextureHashIndex::ParseHashName("0123abcd.DDS") == 0x0123ABCDu);
+    CHECK(TextureHashIndex::ParseHashName("FFFFFFFF.Dds") == 0xFFFFFFFFu);
+    CHECK(TextureHashIndex::ParseHashName("00000000.dds") == 0u);
+
+    CHECK(!TextureHashIndex::ParseHashName(""));
+    CHECK(!TextureHashIndex::ParseHashName("0123abc.dds"));
+    CHECK(!TextureHashIndex::ParseHashName("0123abcde.dds"));
+    CHECK(!TextureHashIndex::ParseHashName("0123abcg.dds"));
+    CHECK(!TextureHashIndex::ParseHashName("0123abc .dds"));
+    CHECK(!TextureHashIndex::ParseHashName("0x23abcd.dds"));
+    CHECK(!TextureHashIndex::ParseHashName("0123abcd.dd"));
+    CHECK(!TextureHashIndex::ParseHashName("0123abcd_dds"));
+    CHECK(!TextureHashIndex::ParseHashName("0123abcd.png"));
+    CHECK(!TextureHashIndex::ParseHashName("0123abcd.dds "));
+}
@@ -72,13 +72,8 @@ if __name__ == "__main__":
         subprocess.run([UNSEALED_VERSES_PATH, "unpack", input_pack_path, EXTRACTED_RTEX_DIR], check=True)
         
         print("\nConverting .rtex files to .dds...")
-        for rtex_filename in os.listdir(EXTRACTED_RTEX_DIR):
-            if rtex_filename.endswith(".rtex"):
-                rtex_path = os.path.join(EXTRACTED_RTEX_DIR, rtex_filename)
-                dds_filename = os.path.splitext(rtex_filename)[0] + ".dds"
-                dds_path = os.path.join(EXTRACTED_DDS_DIR, dds_filename)
-                try:
-                    subprocess.run([UNSEALED_VERSES_PATH, "rtex-to-dds", dds_path, rtex_path], check=True, capture_output=True)
-                except subprocess.CalledProcessError:
-                    print(f"  - Could not convert {rtex_filename}. Skipping.")
+        # One batch call converts every texture in parallel and lists the ones it could not convert
+        result = subprocess.run([UNSEALED_VERSES_PATH, "texture-convert", os.path.join(EXTRACTED_RTEX_DIR, "*.rtex"), EXTRACTED_DDS_DIR])
+        if result.returncode != 0:
+            print("  - Some textures could not be converted. Skipping them.")
         main()
\ No newline at end of file